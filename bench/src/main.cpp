@@ -0,0 +1,476 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "interpreter.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// ============================================
+// WDIV_BENCH
+// ============================================
+// Corre cada script de scripts/bench num Interpreter novo: run() e depois
+// update() ate nao haver processos vivos. Mede tempo total, tempo de cada
+// update(), pico de memoria e instrucoes (contador do run_fiber: o bench liga
+// com a libwdiv_counted, que paga um incremento por instrucao em todas as
+// corridas, por isso os tempos continuam comparaveis entre si).
+//
+//   wdiv_bench [--dir scripts/bench] [--filter nome] [--reps N] [--json out.json]
+//   wdiv_bench --compare base.json novo.json [--threshold 5]
+//
+// O JSON tem um benchmark por linha (o --compare le-o linha a linha).
+
+typedef std::chrono::steady_clock Clock;
+
+static const float FRAME_DT = 0.016f;
+// Um script que nao acaba ate aqui conta como falhado (erro de runtime deixa
+// o processo principal vivo sem fibers)
+static const int MAX_FRAMES = 20000;
+
+struct BenchRun
+{
+    bool ok;
+    uint64_t instructions;
+    double totalMs; // run() + todos os update()
+    double runMs;   // so o run() (codigo de topo)
+    std::vector<double> frameMs;
+    long peakKb;
+};
+
+struct BenchReport
+{
+    std::string name;
+    bool ok;
+    uint64_t instructions;
+    double totalMs;
+    double runMs;
+    int frames;
+    double frameMean;
+    double frameP99;
+    double instrPerSec;
+    double nsPerOp;
+    long peakKb;
+};
+
+// ============================================
+// MEMORIA (pico do processo)
+// ============================================
+// Linux: "5" em clear_refs repoe o VmHWM, entao cada benchmark tem o seu pico.
+// Noutros sistemas o pico e do processo inteiro (so sobe entre benchmarks).
+
+static void resetPeakMemory()
+{
+#if defined(__GLIBC__)
+    malloc_trim(0); // o que o benchmark anterior libertou sai do RSS
+#endif
+#if defined(__linux__)
+    FILE *f = std::fopen("/proc/self/clear_refs", "w");
+    if (f)
+    {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+#endif
+}
+
+static long peakMemoryKb()
+{
+#if defined(__linux__)
+    FILE *f = std::fopen("/proc/self/status", "r");
+    if (f)
+    {
+        char line[256];
+        long kb = -1;
+        while (std::fgets(line, sizeof(line), f))
+        {
+            if (std::strncmp(line, "VmHWM:", 6) == 0)
+            {
+                kb = std::strtol(line + 6, nullptr, 10);
+                break;
+            }
+        }
+        std::fclose(f);
+        if (kb >= 0)
+            return kb;
+    }
+#endif
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (long)(counters.PeakWorkingSetSize / 1024);
+    return -1;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return (long)(usage.ru_maxrss / 1024); // bytes no macOS
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+// ============================================
+// NATIVES
+// ============================================
+// rand com semente fixa por corrida: a mesma fisica em todas as repeticoes
+
+static uint32 randState = 1;
+
+static Value native_rand(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount < 1 || !args[0].isNumber())
+    {
+        vm->runtimeError("rand expects a number");
+        return Value::makeNil();
+    }
+    long range = args[0].asNumber();
+    randState = randState * 1664525u + 1013904223u;
+    return Value::makeInt(range > 0 ? (long)((randState >> 8) % (uint32)range) : 0);
+}
+
+// ============================================
+// CORRER
+// ============================================
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static BenchRun runScript(const std::string &code)
+{
+    BenchRun result;
+    result.ok = false;
+    result.instructions = 0;
+    result.totalMs = 0;
+    result.runMs = 0;
+    result.peakKb = -1;
+
+    resetPeakMemory();
+    randState = 1;
+    {
+        Interpreter vm;
+        vm.registerNative("rand", native_rand, 1);
+
+        Clock::time_point start = Clock::now();
+        result.ok = vm.run(code.c_str(), false);
+        result.runMs = elapsedMs(start);
+
+        int frames = 0;
+        while (result.ok && vm.liveProcess() && frames < MAX_FRAMES)
+        {
+            Clock::time_point frameStart = Clock::now();
+            vm.update(FRAME_DT);
+            result.frameMs.push_back(elapsedMs(frameStart));
+            frames++;
+        }
+
+        result.totalMs = elapsedMs(start);
+        result.ok = result.ok && frames < MAX_FRAMES;
+        result.instructions = vm.getInstructionCount();
+        result.peakKb = peakMemoryKb();
+    }
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)(p * (double)values.size() + 0.999999);
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+// Repeticoes: fica a corrida com o tempo total mediano
+static BenchReport benchmark(const std::string &name, const std::string &code, int reps)
+{
+    std::vector<BenchRun> runs;
+    for (int i = 0; i < reps; i++)
+        runs.push_back(runScript(code));
+
+    std::vector<size_t> order(runs.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+              { return runs[a].totalMs < runs[b].totalMs; });
+    const BenchRun &median = runs[order[order.size() / 2]];
+
+    BenchReport report;
+    report.name = name;
+    report.ok = true;
+    report.peakKb = 0;
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        report.ok = report.ok && runs[i].ok;
+        report.peakKb = std::max(report.peakKb, runs[i].peakKb);
+    }
+    report.instructions = median.instructions;
+    report.totalMs = median.totalMs;
+    report.runMs = median.runMs;
+    report.frames = (int)median.frameMs.size();
+
+    double frameSum = 0.0;
+    for (size_t i = 0; i < median.frameMs.size(); i++)
+        frameSum += median.frameMs[i];
+    report.frameMean = report.frames ? frameSum / report.frames : 0.0;
+    report.frameP99 = percentile(median.frameMs, 0.99);
+
+    double seconds = median.totalMs / 1000.0;
+    report.instrPerSec = seconds > 0.0 ? (double)median.instructions / seconds : 0.0;
+    report.nsPerOp = median.instructions ? median.totalMs * 1e6 / (double)median.instructions : 0.0;
+    return report;
+}
+
+// ============================================
+// JSON
+// ============================================
+
+static bool writeJson(const std::string &path, const std::vector<BenchReport> &reports, int reps)
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+
+    std::fprintf(f, "{\n  \"suite\": \"wdiv_bench\",\n  \"repetitions\": %d,\n  \"benchmarks\": [\n", reps);
+    for (size_t i = 0; i < reports.size(); i++)
+    {
+        const BenchReport &r = reports[i];
+        std::fprintf(f,
+                     "    {\"name\": \"%s\", \"ok\": %s, \"instructions\": %llu, \"total_ms\": %.3f, \"run_ms\": %.3f, "
+                     "\"frames\": %d, \"frame_ms_mean\": %.4f, \"frame_ms_p99\": %.4f, \"instr_per_sec\": %.0f, "
+                     "\"ns_per_op\": %.3f, \"peak_kb\": %ld}%s\n",
+                     r.name.c_str(), r.ok ? "true" : "false", (unsigned long long)r.instructions, r.totalMs, r.runMs,
+                     r.frames, r.frameMean, r.frameP99, r.instrPerSec, r.nsPerOp, r.peakKb,
+                     i + 1 < reports.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    return std::fclose(f) == 0;
+}
+
+// So le o que o writeJson escreve: um objecto por linha
+static bool jsonField(const std::string &line, const char *key, std::string &out)
+{
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t at = line.find(pattern);
+    if (at == std::string::npos)
+        return false;
+    at += pattern.size();
+
+    if (line[at] == '"')
+    {
+        size_t end = line.find('"', at + 1);
+        if (end == std::string::npos)
+            return false;
+        out = line.substr(at + 1, end - at - 1);
+        return true;
+    }
+
+    size_t end = line.find_first_of(",}", at);
+    out = line.substr(at, end == std::string::npos ? std::string::npos : end - at);
+    return true;
+}
+
+static bool readJson(const std::string &path, std::vector<BenchReport> &reports)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string value;
+        if (!jsonField(line, "name", value))
+            continue;
+
+        BenchReport r = BenchReport();
+        r.name = value;
+        r.ok = jsonField(line, "ok", value) && value == "true";
+        if (jsonField(line, "instructions", value))
+            r.instructions = std::strtoull(value.c_str(), nullptr, 10);
+        if (jsonField(line, "total_ms", value))
+            r.totalMs = std::atof(value.c_str());
+        if (jsonField(line, "frame_ms_mean", value))
+            r.frameMean = std::atof(value.c_str());
+        if (jsonField(line, "frame_ms_p99", value))
+            r.frameP99 = std::atof(value.c_str());
+        if (jsonField(line, "ns_per_op", value))
+            r.nsPerOp = std::atof(value.c_str());
+        if (jsonField(line, "peak_kb", value))
+            r.peakKb = std::atol(value.c_str());
+        reports.push_back(r);
+    }
+    return true;
+}
+
+static double percentChange(double before, double after)
+{
+    return before > 0.0 ? (after - before) * 100.0 / before : 0.0;
+}
+
+// Regressao = ns/op (ou ms total, sem contador) ou ms por frame pior que o threshold (%)
+static int compare(const std::string &basePath, const std::string &newPath, double threshold)
+{
+    std::vector<BenchReport> base, current;
+    if (!readJson(basePath, base) || !readJson(newPath, current))
+    {
+        std::fprintf(stderr, "cannot read %s or %s\n", basePath.c_str(), newPath.c_str());
+        return 2;
+    }
+
+    int regressions = 0;
+    std::printf("%-10s %12s %12s %8s %10s %10s %8s %10s\n",
+                "benchmark", "ns/op base", "ns/op new", "delta", "frame base", "frame new", "delta", "peak kb");
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        const BenchReport &now = current[i];
+        const BenchReport *before = nullptr;
+        for (size_t j = 0; j < base.size(); j++)
+        {
+            if (base[j].name == now.name)
+                before = &base[j];
+        }
+        if (!before)
+        {
+            std::printf("%-10s (new)\n", now.name.c_str());
+            continue;
+        }
+
+        // Sem contador de instrucoes num dos lados: compara o tempo total
+        double opDelta = before->nsPerOp > 0.0 && now.nsPerOp > 0.0 ? percentChange(before->nsPerOp, now.nsPerOp)
+                                                                    : percentChange(before->totalMs, now.totalMs);
+        double frameDelta = percentChange(before->frameMean, now.frameMean);
+        bool regressed = opDelta > threshold || frameDelta > threshold || (before->ok && !now.ok);
+        regressions += regressed;
+
+        std::printf("%-10s %12.3f %12.3f %+7.1f%% %10.4f %10.4f %+7.1f%% %+10ld%s\n",
+                    now.name.c_str(), before->nsPerOp, now.nsPerOp, opDelta,
+                    before->frameMean, now.frameMean, frameDelta,
+                    now.peakKb - before->peakKb, regressed ? "  REGRESSION" : "");
+    }
+
+    for (size_t j = 0; j < base.size(); j++)
+    {
+        bool found = false;
+        for (size_t i = 0; i < current.size(); i++)
+            found = found || current[i].name == base[j].name;
+        if (!found)
+            std::printf("%-10s (missing)\n", base[j].name.c_str());
+    }
+
+    std::printf("\n%d regression(s) over %.1f%%\n", regressions, threshold);
+    return regressions ? 1 : 0;
+}
+
+static void usage()
+{
+    std::printf("usage: wdiv_bench [--dir path] [--filter name] [--reps N] [--json file]\n"
+                "       wdiv_bench --compare base.json new.json [--threshold percent]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = "scripts/bench";
+    std::string filter;
+    std::string jsonPath;
+    std::string compareBase, compareNew;
+    double threshold = 5.0;
+    int reps = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--dir") == 0 && hasValue)
+            dir = argv[++i];
+        else if (std::strcmp(arg, "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if (std::strcmp(arg, "--reps") == 0 && hasValue)
+            reps = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--json") == 0 && hasValue)
+            jsonPath = argv[++i];
+        else if (std::strcmp(arg, "--threshold") == 0 && hasValue)
+            threshold = std::atof(argv[++i]);
+        else if (std::strcmp(arg, "--compare") == 0 && i + 2 < argc)
+        {
+            compareBase = argv[++i];
+            compareNew = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if (!compareBase.empty())
+        return compare(compareBase, compareNew, threshold);
+
+    namespace fs = std::filesystem;
+    if (!fs::exists(dir))
+    {
+        std::printf("Error: benchmark directory '%s' does not exist\n", dir.c_str());
+        return 2;
+    }
+
+    // Ordem fixa: o JSON de dois commits fica alinhado
+    std::vector<fs::path> scripts;
+    for (auto &entry : fs::directory_iterator(dir))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".bu")
+            scripts.push_back(entry.path());
+    }
+    std::sort(scripts.begin(), scripts.end());
+
+    std::printf("%-10s %12s %10s %8s %10s %10s %9s %9s\n",
+                "benchmark", "instructions", "total ms", "frames", "frame ms", "frame p99", "ns/op", "peak kb");
+
+    std::vector<BenchReport> reports;
+    bool allOk = true;
+    for (size_t i = 0; i < scripts.size(); i++)
+    {
+        std::string name = scripts[i].stem().string();
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            continue;
+
+        std::ifstream file(scripts[i]);
+        std::string code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        BenchReport r = benchmark(name, code, reps);
+        reports.push_back(r);
+        allOk = allOk && r.ok;
+
+        std::printf("%-10s %12llu %10.2f %8d %10.4f %10.4f %9.3f %9ld%s\n",
+                    r.name.c_str(), (unsigned long long)r.instructions, r.totalMs, r.frames,
+                    r.frameMean, r.frameP99, r.nsPerOp, r.peakKb, r.ok ? "" : "  FAILED");
+    }
+
+    if (!jsonPath.empty())
+    {
+        if (!writeJson(jsonPath, reports, reps))
+        {
+            std::fprintf(stderr, "cannot write %s\n", jsonPath.c_str());
+            return 2;
+        }
+        std::printf("\nresults written to %s\n", jsonPath.c_str());
+    }
+
+    return allOk ? 0 : 1;
+}
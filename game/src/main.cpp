@@ -28,19 +28,25 @@ Value native_write(Interpreter *vm, int argCount, Value *args)
             if (argIndex < argCount)
             {
 
-                char buffer[64];
                 Value v = args[argIndex++];
 
-                if (v.isInt())
-                    snprintf(buffer, 64, "%ld", v.asInt());
-                else if (v.isDouble())
-                    snprintf(buffer, 64, "%.2f", v.asDouble());
-                else if (v.isString())
-                    snprintf(buffer, 64, "%s", v.asString()->chars());
+                if (v.isString())
+                {
+                    // Inteira (o buffer de 64 cortava strings longas)
+                    result.append(v.asString()->chars(), v.asString()->length());
+                }
                 else
-                    snprintf(buffer, 64, "<?>");
-
-                result += buffer;
+                {
+                    char buffer[64];
+                    if (v.isInt())
+                        snprintf(buffer, 64, "%ld", v.asInt());
+                    else if (v.isDouble())
+                        snprintf(buffer, 64, "%.2f", v.asDouble());
+                    else
+                        snprintf(buffer, 64, "<?>");
+
+                    result += buffer;
+                }
             }
             i++;
         }
@@ -74,19 +80,25 @@ Value native_format(Interpreter *vm, int argCount, Value *args)
             if (argIndex < argCount)
             {
                 // Converte Value para string
-                char buffer[64];
                 Value v = args[argIndex++];
 
-                if (v.isInt())
-                    snprintf(buffer, 64, "%ld", v.asInt());
-                else if (v.isDouble())
-                    snprintf(buffer, 64, "%.2f", v.asDouble());
-                else if (v.isString())
-                    snprintf(buffer, 64, "%s", v.asString()->chars());
+                if (v.isString())
+                {
+                    // Inteira (o buffer de 64 cortava strings longas)
+                    result.append(v.asString()->chars(), v.asString()->length());
+                }
                 else
-                    snprintf(buffer, 64, "<?>");
-
-                result += buffer;
+                {
+                    char buffer[64];
+                    if (v.isInt())
+                        snprintf(buffer, 64, "%ld", v.asInt());
+                    else if (v.isDouble())
+                        snprintf(buffer, 64, "%.2f", v.asDouble());
+                    else
+                        snprintf(buffer, 64, "<?>");
+
+                    result += buffer;
+                }
             }
             i++; // salta '}'
         }
@@ -247,8 +259,49 @@ void onRender(Process *proc)
     DrawTexture(bunny, (int)x - bunny.width / 2, (int)y - bunny.height / 2, WHITE);
 }
 
-int main()
+// ===== GRAVAR INPUT =====
+// game --record ficheiro: escreve o input de cada frame no formato que o
+// headless le (--input), para repetir a mesma sessao sem janela
+
+static FILE *recordFile = nullptr;
+
+static void recordInput(int frame)
+{
+    static int lastX = -1, lastY = -1;
+
+    int x = GetMouseX();
+    int y = GetMouseY();
+    if (x != lastX || y != lastY)
+    {
+        fprintf(recordFile, "%d mouse %d %d\n", frame, x, y);
+        lastX = x;
+        lastY = y;
+    }
+
+    for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE; button++)
+    {
+        if (IsMouseButtonPressed(button))
+            fprintf(recordFile, "%d down %d\n", frame, button);
+        if (IsMouseButtonReleased(button))
+            fprintf(recordFile, "%d up %d\n", frame, button);
+    }
+
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed())
+        fprintf(recordFile, "%d key %d\n", frame, key);
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 2 && strcmp(argv[1], "--record") == 0)
+    {
+        recordFile = fopen(argv[2], "w");
+        if (!recordFile)
+        {
+            std::cerr << "Error writing " << argv[2] << "\n";
+            return 1;
+        }
+    }
+
     Interpreter vm;
     vm.registerNative("write", native_write, -1);
     vm.registerNative("format", native_format, -1);
@@ -290,10 +343,15 @@ int main()
         return 1;
     }
 
+    int frame = 0;
     while (!WindowShouldClose())
     {
         float dt = GetFrameTime();
 
+        if (recordFile)
+            recordInput(frame);
+        frame++;
+
         vm.update(dt);
 
         BeginDrawing();
@@ -306,11 +364,24 @@ int main()
         DrawFPS(10, 10);
         DrawText(TextFormat("Processes: %d", vm.getTotalAliveProcesses()), 10, 30, 20, GREEN);
 
+        // Top: ProcessDefs que mais tempo gastaram neste update
+        const ProcessStats *top[5];
+        uint32 topCount = vm.getTopProcessStats(top, 5);
+        for (uint32 i = 0; i < topCount; i++)
+        {
+            DrawText(TextFormat("%-12s x%-5u %6.2f ms %9llu ops", top[i]->name->chars(), top[i]->steps,
+                                top[i]->ns / 1000000.0, (unsigned long long)top[i]->instructions),
+                     10, 55 + (int)i * 18, 16, GREEN);
+        }
+
         EndDrawing();
     }
 
     UnloadTexture(bunny);
 
+    if (recordFile)
+        fclose(recordFile);
+
     CloseWindow();
 
     return 0;
@@ -0,0 +1,677 @@
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "interpreter.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+
+// ============================================
+// HOST SEM JANELA
+// ============================================
+// Os mesmos natives do game, mas sem raylib: teclado e rato vem de um ficheiro
+// de input (escrito a mao ou gravado com `game --record`), rand tem semente
+// fixa e clock() devolve o tempo simulado. Corre update() com dt fixo durante
+// N frames; render() corre com um onRender que so conta.
+//
+//   headless [script] [--frames N] [--dt 0.016] [--seed N] [--input file]
+//            [--csv file] [--quiet] [--opcodes] [--profile file [--rate N]]
+//            [--trace file] [--memory file [--memory-every N]] [--tiering]
+//
+//   --opcodes  no fim, histograma de opcodes/pares/funcoes
+//   --profile  amostra a pilha de ~N em ~N instrucoes (10000 por omissao;
+//              sem contagem de instrucoes, de ~N/8 em ~N/8 loops e calls),
+//              escreve as pilhas no formato do flamegraph.pl e imprime a
+//              tabela self/total por linha:
+//                flamegraph.pl file > profile.svg
+//   (--opcodes e as contagens de instrucoes precisam da lib compilada com
+//    -DWDIV_PROFILE_OPCODES=ON)
+//   --trace    trace-event JSON dos ultimos frames (chrome://tracing, Perfetto)
+//   --memory   CSV com reservado/usado por subsistema de N em N frames (30 por
+//              omissao) e, no fim, o relatorio de memoria com as size classes
+//   --tiering  defs comecam no baseline e os quentes sao optimizados numa
+//              thread (Interpreter::setTiering)
+//
+// Ficheiro de input (uma linha por evento, # comenta):
+//   <frame> mouse <x> <y>     posicao do rato a partir desse frame
+//   <frame> down <botao>      botao carregado ate ao "up"
+//   <frame> up <botao>
+//   <frame> key <codigo>      key(codigo) e true so nesse frame
+
+typedef std::chrono::steady_clock Clock;
+
+// ===== INPUT =====
+
+struct InputEvent
+{
+    int frame;
+    enum Kind
+    {
+        MOUSE,
+        DOWN,
+        UP,
+        KEY
+    } kind;
+    int a;
+    int b;
+};
+
+static const int MAX_BUTTONS = 8;
+static const int MAX_KEYS = 512;
+
+struct InputState
+{
+    int mouseX = 0;
+    int mouseY = 0;
+    bool buttons[MAX_BUTTONS] = {};
+    bool pressed[MAX_KEYS] = {}; // so no frame do evento
+};
+
+static std::vector<InputEvent> inputEvents;
+static size_t nextEvent = 0;
+static InputState input;
+
+static bool loadInput(const char *path)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream in(line);
+        InputEvent event;
+        std::string kind;
+        if (!(in >> event.frame))
+            continue; // linha vazia
+
+        event.a = event.b = 0;
+        in >> kind;
+        bool ok = true;
+        if (kind == "mouse")
+        {
+            event.kind = InputEvent::MOUSE;
+            ok = (bool)(in >> event.a >> event.b);
+        }
+        else if (kind == "down" || kind == "up")
+        {
+            event.kind = kind == "down" ? InputEvent::DOWN : InputEvent::UP;
+            ok = (bool)(in >> event.a) && event.a >= 0 && event.a < MAX_BUTTONS;
+        }
+        else if (kind == "key")
+        {
+            event.kind = InputEvent::KEY;
+            ok = (bool)(in >> event.a) && event.a >= 0 && event.a < MAX_KEYS;
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%d: bad input event\n", path, lineNumber);
+            return false;
+        }
+        inputEvents.push_back(event);
+    }
+
+    std::stable_sort(inputEvents.begin(), inputEvents.end(),
+                     [](const InputEvent &x, const InputEvent &y)
+                     { return x.frame < y.frame; });
+    return true;
+}
+
+static void applyInput(int frame)
+{
+    std::memset(input.pressed, 0, sizeof(input.pressed));
+
+    while (nextEvent < inputEvents.size() && inputEvents[nextEvent].frame <= frame)
+    {
+        const InputEvent &event = inputEvents[nextEvent++];
+        switch (event.kind)
+        {
+        case InputEvent::MOUSE:
+            input.mouseX = event.a;
+            input.mouseY = event.b;
+            break;
+        case InputEvent::DOWN:
+            input.buttons[event.a] = true;
+            break;
+        case InputEvent::UP:
+            input.buttons[event.a] = false;
+            break;
+        case InputEvent::KEY:
+            input.pressed[event.a] = true;
+            break;
+        }
+    }
+}
+
+// ===== RNG / TEMPO =====
+// xorshift32: GetRandomValue(min, max) inclui o max
+
+static uint32 rngState = 1;
+static double simulatedTime = 0.0;
+
+static void seedRandom(uint32 seed)
+{
+    rngState = seed ? seed : 1;
+}
+
+static int randomValue(int min, int max)
+{
+    if (min > max)
+        std::swap(min, max);
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    uint32 range = (uint32)(max - min) + 1;
+    return min + (int)(rngState % range);
+}
+
+// ============================================
+// NATIVES (mesmo conjunto do game)
+// ============================================
+
+static void formatInto(std::string &result, int argCount, Value *args)
+{
+    const char *fmt = args[0].asString()->chars();
+    int argIndex = 1;
+
+    for (int i = 0; fmt[i] != '\0'; i++)
+    {
+        if (fmt[i] == '{' && fmt[i + 1] == '}')
+        {
+            if (argIndex < argCount)
+            {
+                Value v = args[argIndex++];
+
+                if (v.isString())
+                {
+                    result.append(v.asString()->chars(), v.asString()->length());
+                }
+                else
+                {
+                    char buffer[64];
+                    if (v.isInt())
+                        snprintf(buffer, 64, "%ld", v.asInt());
+                    else if (v.isDouble())
+                        snprintf(buffer, 64, "%.2f", v.asDouble());
+                    else
+                        snprintf(buffer, 64, "<?>");
+
+                    result += buffer;
+                }
+            }
+            i++; // salta '}'
+        }
+        else
+        {
+            result += fmt[i];
+        }
+    }
+}
+
+static bool quiet = false;
+
+Value native_write(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount < 1 || !args[0].isString())
+    {
+        vm->runtimeError("write expects string as first argument");
+        return Value::makeNil();
+    }
+
+    std::string result;
+    formatInto(result, argCount, args);
+    if (!quiet)
+        printf("%s", result.c_str());
+    return Value::makeNil();
+}
+
+Value native_format(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount < 1 || !args[0].isString())
+    {
+        vm->runtimeError("format expects string as first argument");
+        return Value::makeNil();
+    }
+
+    std::string result;
+    formatInto(result, argCount, args);
+    return Value::makeString(result.c_str());
+}
+
+Value native_sqrt(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount != 1)
+    {
+        vm->runtimeError("sqrt expects 1 argument");
+        return Value::makeNil();
+    }
+
+    double value;
+    if (args[0].isInt())
+        value = (double)args[0].asInt();
+    else if (args[0].isDouble())
+        value = args[0].asDouble();
+    else
+    {
+        vm->runtimeError("sqrt expects a number");
+        return Value::makeNil();
+    }
+
+    if (value < 0)
+    {
+        vm->runtimeError("sqrt of negative number");
+        return Value::makeNil();
+    }
+
+    return Value::makeDouble(std::sqrt(value));
+}
+
+Value native_sin(Interpreter *vm, int argCount, Value *args)
+{
+    double x = args[0].isInt() ? (double)args[0].asInt() : args[0].asDouble();
+    return Value::makeDouble(std::sin(x));
+}
+
+Value native_cos(Interpreter *vm, int argCount, Value *args)
+{
+    double x = args[0].isInt() ? (double)args[0].asInt() : args[0].asDouble();
+    return Value::makeDouble(std::cos(x));
+}
+
+Value native_abs(Interpreter *vm, int argCount, Value *args)
+{
+    if (args[0].isInt())
+        return Value::makeInt(std::abs(args[0].asInt()));
+    else
+        return Value::makeDouble(std::fabs(args[0].asDouble()));
+}
+
+// Tempo simulado: o mesmo resultado em todas as corridas
+Value native_clock(Interpreter *vm, int argCount, Value *args)
+{
+    return Value::makeDouble(simulatedTime);
+}
+
+Value native_key(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount != 1 || !args[0].isInt())
+    {
+        vm->runtimeError("key expects 1 integer argument");
+        return Value::makeNil();
+    }
+
+    long key = args[0].asInt();
+    return Value::makeBool(key >= 0 && key < MAX_KEYS && input.pressed[key]);
+}
+
+Value native_mouseX(Interpreter *vm, int argCount, Value *args)
+{
+    return Value::makeInt(input.mouseX);
+}
+
+Value native_mouseY(Interpreter *vm, int argCount, Value *args)
+{
+    return Value::makeInt(input.mouseY);
+}
+
+Value native_mouse_down(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount != 1 || !args[0].isInt())
+    {
+        vm->runtimeError("mouse_down expects 1 integer argument");
+        return Value::makeNil();
+    }
+
+    long button = args[0].asInt();
+    return Value::makeBool(button >= 0 && button < MAX_BUTTONS && input.buttons[button]);
+}
+
+Value native_rand(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount != 1 || !args[0].isInt())
+    {
+        vm->runtimeError("rand expects 1 integer argument");
+        return Value::makeNil();
+    }
+
+    return Value::makeInt(randomValue(0, (int)args[0].asInt()));
+}
+
+Value native_rand_range(Interpreter *vm, int argCount, Value *args)
+{
+    if (argCount != 2 || !args[0].isInt() || !args[1].isInt())
+    {
+        vm->runtimeError("rand_range expects 2 integer arguments");
+        return Value::makeNil();
+    }
+    return Value::makeInt(randomValue((int)args[0].asInt(), (int)args[1].asInt()));
+}
+
+// onRender so conta (o custo que fica e o do ciclo do render())
+static uint64_t renderCalls = 0;
+
+void onRender(Process *proc)
+{
+    renderCalls++;
+}
+
+// ============================================
+// ESTATISTICAS
+// ============================================
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = (size_t)std::ceil(p * (double)sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printTimes(const char *label, std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < times.size(); i++)
+        sum += times[i];
+    double mean = times.empty() ? 0.0 : sum / (double)times.size();
+
+    printf("%-10s p50 %8.4f  p90 %8.4f  p99 %8.4f  max %8.4f  mean %8.4f  total %9.2f\n",
+           label, percentile(times, 0.50), percentile(times, 0.90), percentile(times, 0.99),
+           times.empty() ? 0.0 : times.back(), mean, sum);
+}
+
+// ===== MEMORIA =====
+
+static FILE *memoryCsv = nullptr;
+static int currentFrame = 0;
+
+static void onMemorySample(Interpreter *, const MemoryReport &report)
+{
+    fprintf(memoryCsv, "%d", currentFrame);
+    for (int i = 0; i < MEM_COUNT; i++)
+        fprintf(memoryCsv, ",%zu,%zu", report.subsystems[i].reserved, report.subsystems[i].used);
+    fprintf(memoryCsv, ",%zu,%zu\n", report.total.reserved, report.total.used);
+}
+
+static double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void usage()
+{
+    printf("usage: headless [script] [--frames N] [--dt seconds] [--seed N] [--input file]\n"
+           "                [--csv file] [--quiet] [--opcodes] [--profile file [--rate N]]\n"
+           "                [--trace file] [--memory file [--memory-every N]] [--tiering]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *scriptPath = "bunny.cc";
+    const char *inputPath = nullptr;
+    const char *csvPath = nullptr;
+    int frames = 600;
+    float dt = 0.016f;
+    uint32 seed = 1;
+    bool dumpOpcodes = false;
+    const char *profilePath = nullptr;
+    uint32 profileRate = 10000;
+    const char *tracePath = nullptr;
+    const char *memoryPath = nullptr;
+    uint32 memoryEvery = 30;
+    bool tiering = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--frames") == 0 && hasValue)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(arg, "--dt") == 0 && hasValue)
+            dt = (float)atof(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue)
+            seed = (uint32)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--input") == 0 && hasValue)
+            inputPath = argv[++i];
+        else if (strcmp(arg, "--csv") == 0 && hasValue)
+            csvPath = argv[++i];
+        else if (strcmp(arg, "--quiet") == 0)
+            quiet = true;
+        else if (strcmp(arg, "--opcodes") == 0)
+            dumpOpcodes = true;
+        else if (strcmp(arg, "--profile") == 0 && hasValue)
+            profilePath = argv[++i];
+        else if (strcmp(arg, "--trace") == 0 && hasValue)
+            tracePath = argv[++i];
+        else if (strcmp(arg, "--memory") == 0 && hasValue)
+            memoryPath = argv[++i];
+        else if (strcmp(arg, "--memory-every") == 0 && hasValue)
+            memoryEvery = (uint32)std::max(1, atoi(argv[++i]));
+        else if (strcmp(arg, "--rate") == 0 && hasValue)
+            profileRate = (uint32)std::max(1, atoi(argv[++i]));
+        else if (strcmp(arg, "--tiering") == 0)
+            tiering = true;
+        else if (arg[0] != '-')
+            scriptPath = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if (inputPath && !loadInput(inputPath))
+    {
+        std::cerr << "Error reading input " << inputPath << "\n";
+        return 1;
+    }
+    seedRandom(seed);
+
+    std::ifstream file(scriptPath);
+    if (!file)
+    {
+        std::cerr << "Error opening " << scriptPath << "\n";
+        return 1;
+    }
+    std::string code((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+
+    Interpreter vm;
+    vm.registerNative("write", native_write, -1);
+    vm.registerNative("format", native_format, -1);
+    vm.registerNative("sqrt", native_sqrt, 1);
+    vm.registerNative("clock", native_clock, 0);
+    vm.registerNative("sin", native_sin, 1);
+    vm.registerNative("cos", native_cos, 1);
+    vm.registerNative("abs", native_abs, 1);
+    vm.registerNative("key", native_key, 1);
+    vm.registerNative("mouseX", native_mouseX, 0);
+    vm.registerNative("mouseY", native_mouseY, 0);
+    vm.registerNative("mouse_down", native_mouse_down, 1);
+    vm.registerNative("rand", native_rand, 1);
+    vm.registerNative("rand_range", native_rand_range, 2);
+
+    if (memoryPath)
+    {
+        memoryCsv = fopen(memoryPath, "w");
+        if (!memoryCsv)
+        {
+            std::cerr << "Error writing " << memoryPath << "\n";
+            return 1;
+        }
+        fprintf(memoryCsv, "frame");
+        for (int i = 0; i < MEM_COUNT; i++)
+            fprintf(memoryCsv, ",%s_reserved,%s_used", Interpreter::memorySubsystemName(i),
+                    Interpreter::memorySubsystemName(i));
+        fprintf(memoryCsv, ",total_reserved,total_used\n");
+    }
+
+    VMHooks hooks;
+    hooks.onRender = onRender;
+    if (memoryCsv)
+        hooks.onMemorySample = onMemorySample;
+    vm.setHooks(hooks);
+    if (memoryCsv)
+        vm.setMemorySampling(memoryEvery);
+    if (tiering)
+        vm.setTiering(true);
+
+    // O input do frame 0 ja conta para o codigo de topo
+    applyInput(0);
+
+    if (profilePath)
+        vm.startProfiler(profileRate);
+    if (tracePath)
+        vm.startTrace();
+
+    Clock::time_point start = Clock::now();
+    if (!vm.run(code.c_str()))
+    {
+        std::cerr << "Error running code.\n";
+        return 1;
+    }
+    double runMs = elapsedMs(start);
+
+    FILE *csv = nullptr;
+    if (csvPath)
+    {
+        csv = fopen(csvPath, "w");
+        if (!csv)
+        {
+            std::cerr << "Error writing " << csvPath << "\n";
+            return 1;
+        }
+        fprintf(csv, "frame,update_ms,render_ms,processes,instructions\n");
+    }
+
+    std::vector<double> updateTimes;
+    std::vector<double> renderTimes;
+    updateTimes.reserve(frames);
+    renderTimes.reserve(frames);
+
+    uint32 minLive = vm.getTotalAliveProcesses();
+    uint32 maxLive = minLive;
+    double liveSum = 0.0;
+    uint64_t lastInstructions = vm.getInstructionCount();
+
+    int frame = 0;
+    for (; frame < frames && vm.liveProcess(); frame++)
+    {
+        if (frame > 0)
+            applyInput(frame);
+        simulatedTime += dt;
+        currentFrame = frame;
+
+        Clock::time_point frameStart = Clock::now();
+        vm.update(dt);
+        updateTimes.push_back(elapsedMs(frameStart));
+
+        frameStart = Clock::now();
+        vm.render();
+        renderTimes.push_back(elapsedMs(frameStart));
+
+        uint32 live = vm.getTotalAliveProcesses();
+        minLive = std::min(minLive, live);
+        maxLive = std::max(maxLive, live);
+        liveSum += live;
+
+        if (csv)
+        {
+            uint64_t instructions = vm.getInstructionCount();
+            fprintf(csv, "%d,%.4f,%.4f,%u,%llu\n", frame, updateTimes.back(), renderTimes.back(), live,
+                    (unsigned long long)(instructions - lastInstructions));
+            lastInstructions = instructions;
+        }
+    }
+
+    if (csv)
+        fclose(csv);
+
+    printf("\n");
+    printf("script     %s (seed %u, dt %.4f)\n", scriptPath, seed, dt);
+    printf("frames     %d of %d%s\n", frame, frames, frame < frames ? " (no live processes left)" : "");
+    printf("run()      %.2f ms\n", runMs);
+    printTimes("update ms", updateTimes);
+    printTimes("render ms", renderTimes);
+    printf("processes  min %u  mean %.1f  max %u  end %u\n",
+           minLive, frame ? liveSum / frame : 0.0, maxLive, vm.getTotalAliveProcesses());
+    printf("renders    %llu\n", (unsigned long long)renderCalls);
+    if (vm.isInstructionCountEnabled())
+        printf("instr      %llu\n", (unsigned long long)vm.getInstructionCount());
+    else
+        printf("instr      (libwdiv built without WDIV_COUNT_INSTRUCTIONS)\n");
+
+    // Acumulado por ProcessDef (update() apenas; o codigo de topo fica de fora)
+    printf("\n%-20s %12s %10s %14s\n", "process", "total ms", "ns/step", "instructions");
+    const Vector<ProcessStats> &stats = vm.getProcessStats();
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        if (!stats[i].totalSteps)
+            continue;
+        printf("%-20s %12.3f %10.0f %14llu\n", stats[i].name->chars(), stats[i].totalNs / 1000000.0,
+               (double)stats[i].totalNs / (double)stats[i].totalSteps,
+               (unsigned long long)stats[i].totalInstructions);
+    }
+
+    if (dumpOpcodes)
+    {
+        printf("\n");
+        vm.dumpOpcodeProfile(stdout);
+    }
+
+    if (profilePath)
+    {
+        vm.stopProfiler();
+        Profiler *profiler = vm.getProfiler();
+        printf("\n");
+        profiler->dumpLines(stdout);
+        if (!profiler->writeCollapsed(profilePath))
+        {
+            std::cerr << "Error writing " << profilePath << "\n";
+            return 1;
+        }
+        printf("stacks written to %s\n", profilePath);
+    }
+
+    if (tracePath)
+    {
+        vm.stopTrace();
+        Tracer *tracer = vm.getTracer();
+        if (!tracer->writeJson(tracePath))
+        {
+            std::cerr << "Error writing " << tracePath << "\n";
+            return 1;
+        }
+        printf("%zu trace events written to %s (%llu overwritten)\n", tracer->count(), tracePath,
+               (unsigned long long)tracer->overwritten());
+    }
+
+    if (memoryCsv)
+    {
+        fclose(memoryCsv);
+        printf("\n");
+        vm.dumpMemoryReport(stdout);
+        printf("memory samples written to %s\n", memoryPath);
+    }
+
+    return 0;
+}
@@ -69,7 +69,7 @@ public:
             Function *func = frame->func;
 
             size_t instruction = frame->ip - func->chunk.code - 1;
-            int line = func->chunk.lines[instruction];
+            int line = func->chunk.getLine(instruction);
 
             printf("  [%d] %s() at line %d\n",
                    i,
@@ -273,7 +273,7 @@ public:
 
         CallFrame *frame = &fiber->frames[fiber->frameCount - 1];
         size_t instruction = frame->ip - frame->func->chunk.code;
-        int line = frame->func->chunk.lines[instruction];
+        int line = frame->func->chunk.getLine(instruction);
 
         // Update watches
         updateWatches();
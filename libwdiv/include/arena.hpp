@@ -18,8 +18,10 @@ struct AllocationStats
 	size_t chunkCount;			// Número de chunks alocados
 	size_t largeAllocations;	// Número de alocações > maxBlockSize
 	size_t largeAllocatedBytes; // Bytes em alocações grandes
+	size_t peakAllocated;		// Maximo de totalAllocated desde o inicio (ou Clear)
 
-	size_t blockStats[blockSizes]; // Alocações ativas por tamanho
+	size_t blockStats[blockSizes];	  // Alocações ativas por tamanho
+	size_t blockReserved[blockSizes]; // Bytes de chunks por tamanho
 };
 
 struct StackEntry
@@ -63,6 +65,11 @@ public:
 	void GetStats(AllocationStats &stats) const;
 	size_t GetTotalAllocated() const { return m_totalAllocated; }
 	size_t GetTotalReserved() const { return m_totalReserved; }
+	size_t GetLargeAllocatedBytes() const { return m_largeAllocatedBytes; }
+	size_t GetPeakAllocated() const { return m_peakAllocated; }
+
+	// Tamanho do bloco da classe index (0 fora do intervalo)
+	static size_t GetBlockSize(size_t index);
 
 private:
 	Heap *m_chunks;
@@ -73,6 +80,7 @@ private:
 	size_t m_totalReserved;				   // Bytes reservados em chunks
 	size_t m_largeAllocations;			   // Count de malloc direto
 	size_t m_largeAllocatedBytes;		   // Bytes em malloc direto
+	size_t m_peakAllocated;				   // Maximo de m_totalAllocated
 	size_t m_blockAllocations[blockSizes]; // Count por block size
 
 	Block *m_freeLists[blockSizes];
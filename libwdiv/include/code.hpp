@@ -7,6 +7,14 @@
 
 struct Value;
 
+// Tabela de linhas: uma entrada por cada sequencia de bytes emitidos na mesma
+// linha (em vez de um int por byte). So e consultada em erros e no debugger.
+struct LineRun
+{
+    uint32 start; // offset do primeiro byte da sequencia
+    int line;
+};
+
 
 class Code
 {
@@ -25,8 +33,18 @@ class Code
 
     void write(uint8 instruction, int line);
     void writeShort(uint16 value, int line);
+
+    // Descarta o bytecode a partir de newCount (e as linhas dele)
+    void truncate(size_t newCount);
+
+    // Liberta a folga do buffer de bytecode e da tabela de linhas
+    void shrink();
+
+    // Linha do byte em offset (pesquisa binaria nas sequencias)
+    int getLine(size_t offset) const;
     
     size_t capacity() const { return m_capacity; }
+    size_t lineRunCount() const { return lineCount; }
 
     uint8 operator[](size_t index);
     
@@ -37,7 +55,9 @@ class Code
     
     
     uint8 *code;
-    int *lines;
     size_t count;
+    LineRun *lineRuns;
+    size_t lineCount;
+    size_t lineCapacity;
     Array constants;
 };
\ No newline at end of file
@@ -4,12 +4,15 @@
 #include "lexer.hpp"
 #include "token.hpp"
 #include "vector.hpp"
+#include "value.hpp"
+#include "optimizer.hpp"
 #include <vector>
 #include <cstring>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 class Code;
-struct Value;
 class Compiler;
 struct Function;
 struct CallFrame;
@@ -17,6 +20,7 @@ struct Fiber;
 struct Process;
 struct String;
 struct ProcessDef;
+struct StructDef;
 class Interpreter;
 
 typedef void (Compiler::*ParseFn)(bool canAssign);
@@ -116,6 +120,46 @@ struct GotoJump {
     int jumpOffset;
 };
 
+// Constante emitida no fim do chunk (candidata a constant folding)
+struct FoldConstant
+{
+    int offset; // inicio da instrucao no chunk
+    int length; // 1 (OP_TRUE/OP_FALSE/OP_NIL), 2 (OP_CONSTANT) ou 4 (OP_CONSTANT_LONG)
+    Value value;
+    bool fresh; // a constante entrou na pool com esta instrucao (pode sair no folding)
+};
+
+#define MAX_FOLD_CONSTANTS 16
+
+// const NOME = expr; / enum { A, B }: valor conhecido no compilador, emitido
+// como literal em cada uso. Strings guardam o texto (cada chunk cria a sua).
+struct NamedConstant
+{
+    Value value; // nil/bool/int/double
+    bool isString;
+    std::string text;
+};
+
+// Corpo maximo (bytes) de um def para ser copiado para o call site
+#define INLINE_MAX_BYTES 48
+
+// def pequeno, sem recursao nem suspensao, candidato a inlining
+struct InlineFunction
+{
+    std::string name;
+    Function *func;
+    bool sideEffects; // chama funcoes ou escreve globals/propriedades
+};
+
+// switch com labels constantes: a partir de quantos cases usa OP_SWITCH_TABLE,
+// e ate que amplitude (max - min + 1) a tabela de ints fica densa
+#define SWITCH_MIN_CASES 4
+#define SWITCH_MAX_RANGE 1024
+
+// Operandos _LONG (24 bits): indices de constantes e offsets de saltos
+#define MAX_CONSTANTS 0xFFFFFF
+#define MAX_JUMP 0xFFFFFF
+
 #define MAX_LOCALS 256
 class Compiler
 {
@@ -128,6 +172,12 @@ public:
 
     void clear();
 
+    // Liga/desliga o inlining de defs pequenos (ligado por defeito)
+    void setInlining(bool enable);
+
+    // Defs saem sem optimize/specialize e ficam a espera de aquecer (desligado por defeito)
+    void setTiering(bool enable);
+
 private:
     Interpreter *vm_;
     Lexer *lexer;
@@ -159,6 +209,27 @@ private:
     std::vector<GotoJump> pendingGotos;
     std::vector<GotoJump> pendingGosubs;
 
+    // Constant folding: ultimas constantes no fim do chunk e o ultimo alvo de salto
+    FoldConstant foldConstants_[MAX_FOLD_CONSTANTS];
+    int foldCount_;
+    int foldBarrier_;
+
+    // Inlining
+    bool inlining_;
+    std::vector<InlineFunction> inlineFunctions_;
+    std::unordered_set<std::string> storedNames_; // nomes escritos algures no script: nao sao inlined
+    int calleeOffset_; // OP_GET_GLOBAL do callee quando o nome e seguido de '('
+    int lastCall_;     // ultimo OP_CALL emitido (return f(...) vira OP_TAIL_CALL)
+    bool tiering_;     // defs ficam no baseline; o Interpreter optimiza os quentes
+
+    // Pool de constantes do chunk actual: int/double/string -> indice (sem repetidos)
+    std::unordered_map<std::string, int> constantSlots_;
+    // Saltos para a frente que nao couberam em 16 bits (widenJumps no fim do chunk)
+    std::vector<FarJump> farJumps_;
+
+    // const/enum declarados ate aqui (valem ate ao fim da compilacao)
+    std::unordered_map<std::string, NamedConstant> namedConstants_;
+
     // Token management
     void advance();
     Token peek(int offset = 0);
@@ -189,12 +260,26 @@ private:
     void emitBytes(uint8 byte1, uint8 byte2);
     void emitReturn();
     void emitConstant(Value value);
-    uint8 makeConstant(Value value);
+    int makeConstant(Value value);
+    int stringConstant(const char *chars, size_t length);
+    void forgetConstant(const Value &value);
+    void emitOperand(uint8 op, int operand);
+    void emitOperand(uint8 op, int operand, int line);
 
     int emitJump(uint8 instruction);
     void patchJump(int offset);
  
     void emitLoop(int loopStart);
+    void widenFarJumps();
+
+    // Constant folding
+    void resetFolding();
+    void trackConstant(int offset, Value value, bool fresh);
+    bool peekConstants(int n, Value *out);
+    void dropConstants(int n);
+    void emitFolded(Value value);
+    bool foldUnary(TokenType op);
+    bool foldBinary(TokenType op);
 
     // Pratt parser
     void expression();
@@ -203,7 +288,11 @@ private:
 
     // Parse functions (prefix)
     void number(bool canAssign);
+    Value numberLiteral(Token &token);
     void string(bool canAssign);
+    void emitString(const char *chars, size_t length);
+    void interpolation(Token &text);
+    bool interpolatedExpression(const std::string &source, int line);
     void literal(bool canAssign);
     void grouping(bool canAssign);
     void unary(bool canAssign);
@@ -219,6 +308,16 @@ private:
     void declaration();
     void statement();
     void varDeclaration();
+    void constDeclaration();
+    void enumDeclaration();
+    bool constantExpression(Value &out, std::string &text);
+    void defineConstant(Token &name, const Value &value, const std::string &text);
+    const NamedConstant *lookupConstant(Token &name);
+    void emitNamedConstant(const NamedConstant &constant);
+    bool caseKey(Token &label, bool negative, Value &key);
+    void typeDeclaration();
+    void newStruct(StructDef *def);
+    void emitField(uint8 op, int slot, int field);
     void funDeclaration();
     void processDeclaration();
     void expressionStatement();
@@ -228,7 +327,10 @@ private:
     void doWhileStatement();
     void loopStatement();
     void switchStatement();
+    bool switchTable();
     void forStatement();
+    bool numericForStatement(Token &counter);
+    bool loopBodyAssigns(const std::string &name, int from);
     void returnStatement();
     void block();
     void yieldStatement();
@@ -250,15 +352,21 @@ private:
     void prefixDecrement(bool canAssign);
 
     // Variables
-    uint8 identifierConstant(Token &name);
+    int identifierConstant(Token &name);
     void namedVariable(Token &name, bool canAssign);
-    void defineVariable(uint8 global);
+    void defineVariable(int global);
     void declareVariable();
     void addLocal(Token &name);
     int resolveLocal(Token &name);
     void markInitialized();
 
-    uint8 argumentList();
+    uint8 argumentList(std::vector<int> *argStarts = nullptr);
+
+    // Inlining
+    void collectStoredNames();
+    void registerInline(Token &name, Function *func);
+    void forgetInline(const std::string &name);
+    bool tryInline(int calleeStart, const std::vector<int> &argStarts);
 
     void compileFunction(Function *func, bool isProcess);
     void compileProcess(const std::string &name);
@@ -16,6 +16,9 @@ public:
     // Disassemble uma única instrução
     static size_t disassembleInstruction(const Code& chunk, size_t offset);
 
+    // Nome do opcode ("OP_ADD"), "OP_?" se nao existe
+    static const char* opcodeName(uint8 op);
+
 private:
     // Helpers por tipo de instrução
     static size_t simpleInstruction(const char* name, size_t offset);
@@ -41,4 +44,16 @@ private:
         int sign,
         const Code& chunk,
         size_t offset);
+
+    // Versoes _LONG: operando de 24 bits
+    static size_t constantLongInstruction(
+        const char* name,
+        const Code& chunk,
+        size_t offset);
+
+    static size_t jumpLongInstruction(
+        const char* name,
+        int sign,
+        const Code& chunk,
+        size_t offset);
 };
\ No newline at end of file
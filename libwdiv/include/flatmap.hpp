@@ -0,0 +1,355 @@
+#pragma once
+#include "config.hpp"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLATMAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define FLATMAP_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// ============================================
+// FLATMAP (SwissTable)
+// ============================================
+// Mesma API que o HashMap (set/get/exist/forEach/destroy) mais erase.
+// Cada slot tem um byte de controlo num array a parte:
+//   EMPTY (0x80), DELETED (0xFE) ou 0..127 = 7 bits do hash (H2)
+// A procura compara 16 bytes de controlo de uma vez (SSE2) e so olha para as
+// chaves cujo H2 bate. Os 16 primeiros bytes repetem-se no fim, para um grupo
+// poder comecar em qualquer slot sem dar a volta.
+// Sem hash por entrada: K e V sao copiados com memcpy (como no HashMap).
+
+#define FLATMAP_GROUP 16
+#define FLATMAP_MIN_CAPACITY 16
+
+template <typename K, typename V, typename Hasher, typename Eq>
+struct FlatMap
+{
+  static constexpr int8 EMPTY = -128;
+  static constexpr int8 DELETED = -2;
+
+  struct Slot
+  {
+    K key;
+    V value;
+  };
+
+  int8 *ctrl = nullptr;
+  Slot *slots = nullptr;
+  size_t capacity = 0;   // potencia de 2 (ou 0)
+  size_t count = 0;
+  size_t growthLeft = 0; // inserts em slots EMPTY ate crescer (carga maxima 7/8)
+
+  FlatMap() {}
+  ~FlatMap() { destroy(); }
+
+  FlatMap(const FlatMap &) = delete;
+  FlatMap &operator=(const FlatMap &) = delete;
+
+  void destroy()
+  {
+    if (!ctrl)
+      return;
+    aFree(ctrl);
+    aFree(slots);
+    ctrl = nullptr;
+    slots = nullptr;
+    capacity = count = growthLeft = 0;
+  }
+
+  // ===== HASH =====
+  // H1 escolhe o slot inicial, H2 vai para o controlo. O multiply espalha os
+  // bits de hashes fracos (FNV de 32 bits, ponteiros).
+
+  static uint64_t mix(size_t hash) { return (uint64_t)hash * 0x9E3779B97F4A7C15ULL; }
+  static size_t H1(uint64_t h) { return (size_t)(h >> 7); }
+  static int8 H2(uint64_t h) { return (int8)(h >> 57); }
+
+  size_t mask() const { return capacity - 1; }
+
+  static size_t maxGrowth(size_t cap) { return cap - cap / 8; }
+
+  // ===== GRUPO DE 16 CONTROLOS =====
+
+  struct Group
+  {
+#if FLATMAP_SSE2
+    __m128i bytes;
+    explicit Group(const int8 *at) : bytes(_mm_loadu_si128((const __m128i *)at)) {}
+
+    uint32 match(int8 h2) const
+    {
+      return (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2)));
+    }
+    uint32 matchEmpty() const { return match(EMPTY); }
+    // EMPTY e DELETED sao os unicos negativos
+    uint32 matchFree() const { return (uint32)_mm_movemask_epi8(bytes); }
+#else
+    int8 bytes[FLATMAP_GROUP];
+    explicit Group(const int8 *at) { std::memcpy(bytes, at, FLATMAP_GROUP); }
+
+    uint32 match(int8 h2) const
+    {
+      uint32 bits = 0;
+      for (int i = 0; i < FLATMAP_GROUP; i++)
+        bits |= (uint32)(bytes[i] == h2) << i;
+      return bits;
+    }
+    uint32 matchEmpty() const { return match(EMPTY); }
+    uint32 matchFree() const
+    {
+      uint32 bits = 0;
+      for (int i = 0; i < FLATMAP_GROUP; i++)
+        bits |= (uint32)(bytes[i] < 0) << i;
+      return bits;
+    }
+#endif
+  };
+
+  static int lowestBit(uint32 bits)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctz(bits);
+#endif
+  }
+
+  static int highestBit(uint32 bits)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, bits);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(bits);
+#endif
+  }
+
+  void setCtrl(size_t index, int8 value)
+  {
+    ctrl[index] = value;
+    if (index < FLATMAP_GROUP)
+      ctrl[capacity + index] = value; // copia do inicio
+  }
+
+  // ===== PROCURA =====
+  // Grupos em passos triangulares (16, 32, 48, ...): com capacity potencia de 2
+  // passa por todos os slots. Um EMPTY no grupo acaba a procura.
+
+  Slot *findSlot(const K &key, uint64_t h) const
+  {
+    if (count == 0)
+      return nullptr;
+
+    const int8 h2 = H2(h);
+    size_t pos = H1(h) & mask();
+    size_t step = 0;
+    for (;;)
+    {
+      Group group(ctrl + pos);
+      for (uint32 bits = group.match(h2); bits; bits &= bits - 1)
+      {
+        Slot *slot = &slots[(pos + lowestBit(bits)) & mask()];
+        if (Eq{}(slot->key, key))
+          return slot;
+      }
+      if (group.matchEmpty())
+        return nullptr;
+
+      step += FLATMAP_GROUP;
+      pos = (pos + step) & mask();
+    }
+  }
+
+  // Primeiro slot EMPTY ou DELETED na sequencia de H1
+  size_t findFree(uint64_t h) const
+  {
+    size_t pos = H1(h) & mask();
+    size_t step = 0;
+    for (;;)
+    {
+      uint32 bits = Group(ctrl + pos).matchFree();
+      if (bits)
+        return (pos + lowestBit(bits)) & mask();
+
+      step += FLATMAP_GROUP;
+      pos = (pos + step) & mask();
+    }
+  }
+
+  // ===== API =====
+
+  bool set(const K &key, const V &value)
+  {
+    uint64_t h = mix(Hasher{}(key));
+    Slot *found = findSlot(key, h);
+    if (found)
+    {
+      found->value = value;
+      return false;
+    }
+
+    if (growthLeft == 0)
+    {
+      reserveOne();
+    }
+
+    size_t index = findFree(h);
+    if (ctrl[index] == EMPTY)
+      growthLeft--;
+    setCtrl(index, H2(h));
+    slots[index].key = key;
+    slots[index].value = value;
+    count++;
+    return true;
+  }
+
+  bool get(const K &key, V *out) const
+  {
+    Slot *slot = findSlot(key, mix(Hasher{}(key)));
+    if (!slot)
+      return false;
+    *out = slot->value;
+    return true;
+  }
+
+  bool exist(const K &key) const
+  {
+    return findSlot(key, mix(Hasher{}(key))) != nullptr;
+  }
+
+  // Tira a chave. O slot volta a EMPTY se nenhuma procura pode ter passado
+  // por ele com o grupo cheio; senao fica DELETED. Abaixo de 1/4 de carga a
+  // tabela encolhe para metade.
+  bool erase(const K &key)
+  {
+    Slot *slot = findSlot(key, mix(Hasher{}(key)));
+    if (!slot)
+      return false;
+
+    size_t index = (size_t)(slot - slots);
+    uint32 emptyAfter = Group(ctrl + index).matchEmpty();
+    uint32 emptyBefore = Group(ctrl + ((index - FLATMAP_GROUP) & mask())).matchEmpty();
+
+    // Distancia ao EMPTY mais proximo de cada lado: se cabem num grupo,
+    // nenhuma janela de 16 que inclua este slot esteve sem EMPTY
+    bool neverFull = emptyBefore && emptyAfter &&
+                     (size_t)((FLATMAP_GROUP - 1 - highestBit(emptyBefore)) + lowestBit(emptyAfter)) < FLATMAP_GROUP;
+
+    setCtrl(index, neverFull ? EMPTY : DELETED);
+    if (neverFull)
+      growthLeft++;
+    count--;
+
+    if (capacity > FLATMAP_MIN_CAPACITY && count < capacity / 4)
+      resize(capacity / 2);
+    return true;
+  }
+
+  template <typename Fn>
+  void forEach(Fn fn) const
+  {
+    for (size_t i = 0; i < capacity; i++)
+    {
+      if (ctrl[i] >= 0)
+        fn(slots[i].key, slots[i].value);
+    }
+  }
+
+  // ===== CRESCER / LIMPAR =====
+
+  // Sem slots EMPTY livres: se metade da carga sao DELETED limpa-os no sitio,
+  // senao duplica
+  void reserveOne()
+  {
+    if (capacity == 0)
+      resize(FLATMAP_MIN_CAPACITY);
+    else if (count <= maxGrowth(capacity) / 2)
+      dropDeletes();
+    else
+      resize(capacity * 2);
+  }
+
+  void resize(size_t newCap)
+  {
+    int8 *oldCtrl = ctrl;
+    Slot *oldSlots = slots;
+    size_t oldCap = capacity;
+
+    ctrl = (int8 *)aAlloc(newCap + FLATMAP_GROUP);
+    slots = (Slot *)aAlloc(newCap * sizeof(Slot));
+    std::memset(ctrl, (uint8)EMPTY, newCap + FLATMAP_GROUP);
+    capacity = newCap;
+    growthLeft = maxGrowth(newCap) - count;
+
+    for (size_t i = 0; i < oldCap; i++)
+    {
+      if (oldCtrl[i] < 0)
+        continue;
+      uint64_t h = mix(Hasher{}(oldSlots[i].key));
+      size_t index = findFree(h);
+      setCtrl(index, H2(h));
+      std::memcpy((void *)&slots[index], (const void *)&oldSlots[i], sizeof(Slot));
+    }
+
+    if (oldCtrl)
+    {
+      aFree(oldCtrl);
+      aFree(oldSlots);
+    }
+  }
+
+  // Rehash sem alocar: DELETED -> EMPTY, cheios -> DELETED (= "por mover"),
+  // depois cada um vai para o primeiro livre da sua sequencia. Se o destino
+  // ainda e um "por mover", trocam e repete-se o slot actual.
+  void dropDeletes()
+  {
+    for (size_t i = 0; i < capacity; i++)
+      ctrl[i] = (ctrl[i] < 0) ? EMPTY : DELETED;
+    std::memcpy(ctrl + capacity, ctrl, FLATMAP_GROUP);
+
+    alignas(Slot) unsigned char temp[sizeof(Slot)];
+    for (size_t i = 0; i < capacity; i++)
+    {
+      if (ctrl[i] != DELETED)
+        continue;
+
+      uint64_t h = mix(Hasher{}(slots[i].key));
+      size_t target = findFree(h);
+      size_t probe = H1(h) & mask();
+
+      // Mesmo grupo da sequencia: fica onde esta
+      if ((((target - probe) & mask()) / FLATMAP_GROUP) == (((i - probe) & mask()) / FLATMAP_GROUP))
+      {
+        setCtrl(i, H2(h));
+        continue;
+      }
+
+      if (ctrl[target] == EMPTY)
+      {
+        setCtrl(target, H2(h));
+        std::memcpy((void *)&slots[target], (const void *)&slots[i], sizeof(Slot));
+        setCtrl(i, EMPTY);
+      }
+      else
+      {
+        // Outro "por mover": troca e processa o que veio para aqui
+        setCtrl(target, H2(h));
+        std::memcpy(temp, (const void *)&slots[i], sizeof(Slot));
+        std::memcpy((void *)&slots[i], (const void *)&slots[target], sizeof(Slot));
+        std::memcpy((void *)&slots[target], temp, sizeof(Slot));
+        i--;
+      }
+    }
+
+    growthLeft = maxGrowth(capacity) - count;
+  }
+};
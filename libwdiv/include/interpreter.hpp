@@ -5,6 +5,8 @@
 #include "string.hpp"
 #include "arena.hpp"
 #include "code.hpp"
+#include "structs.hpp"
+#include <atomic>
 
 static constexpr int MAX_PRIVATES = 16;
 static constexpr int MAX_FIBERS = 8;
@@ -12,6 +14,9 @@ static constexpr int STACK_MAX = 256;
 static constexpr int FRAMES_MAX = 32;
 static constexpr int GOSUB_MAX = 16;
 
+// Chamadas + saltos para tras ate um def ser re-optimizado (com tiering ligado)
+static constexpr uint32 TIER_HOT_THRESHOLD = 1000;
+
 enum class InterpretResult : uint8
 {
     OK,
@@ -32,6 +37,9 @@ struct Fiber;
 struct Process;
 class Interpreter;
 class Compiler;
+class TierCompiler;
+class Profiler;
+class Tracer;
 typedef Value (*NativeFunction)(Interpreter *vm, int argCount, Value *args);
 
 struct NativeDef
@@ -42,12 +50,32 @@ struct NativeDef
     uint32 index{0};
 };
 
+enum FunctionTier : uint8
+{
+    TIER_BASELINE,  // so folding/inlining do compilador, a contar hotness
+    TIER_QUEUED,    // copia do chunk a ser optimizada em background
+    TIER_OPTIMIZED, // optimize + specialize (ou tiering desligado)
+};
+
 struct Function
 {
     int arity{-1};
     Code *chunk{nullptr};
     String *name{nullptr};
     bool hasReturn{false};
+
+    // Optimizer::verify: pilha maxima do frame; -1 corre com verificacoes
+    int maxStack{-1};
+
+    // Tiering
+    uint8 tier{TIER_OPTIMIZED};
+    uint32 hotness{0};
+    std::atomic<Code *> optimized{nullptr}; // publicado pela thread de optimizacao
+    int optimizedMaxStack{-1};              // escrito antes de publicar optimized
+    Code *baseline{nullptr};                // chunk antigo, frames activos ainda o usam
+
+    // Instrucoes executadas nesta funcao (so com WDIV_PROFILE_OPCODES)
+    uint64_t profiledInstructions{0};
     ~Function();
 };
 
@@ -58,12 +86,58 @@ struct CallFrame
     Value *slots{nullptr};
 };
 
+// ===== MEMORIA (getMemoryReport) =====
+
+enum MemorySubsystem : uint8
+{
+    MEM_STRINGS,   // StringPool: headers + buffers
+    MEM_ARENA,     // Interpreter::arena: instancias de types
+    MEM_PROCESSES, // ProcessPool + ProcessDef; slots de stack vazios contam como livres
+    MEM_CODE,      // Function + Code: bytecode, linhas, constantes
+    MEM_TABLES,    // HashMaps e Vectors do Interpreter
+    MEM_PROFILING, // histograma de opcodes, profiler e ring do tracer
+    MEM_COUNT
+};
+
+struct MemoryUsage
+{
+    size_t reserved{0}; // pedido ao sistema
+    size_t used{0};     // em uso
+    size_t free{0};     // reserved - used: livre para reutilizar
+    size_t peak{0};     // maximo de used
+};
+
+struct MemoryReport
+{
+    MemoryUsage subsystems[MEM_COUNT];
+    MemoryUsage total;
+    float fragmentation{0}; // total.free / total.reserved
+
+    // Parte de MEM_PROCESSES: stacks das fibers (processos vivos e blueprints)
+    MemoryUsage fiberStacks;
+
+    // So com detailed: percorre os chunks dos allocators
+    bool detailed{false};
+    AllocationStats strings{}; // classes de tamanho e alocacoes grandes
+    AllocationStats arena{};
+};
+
 struct VMHooks
 {
     void (*onStart)(Process *p) = nullptr;
     void (*onUpdate)(Process *p, float dt) = nullptr;
     void (*onRender)(Process *p) = nullptr;
     void (*onDestroy)(Process *p, int exitCode) = nullptr;
+
+    // De setMemorySampling em setMemorySampling frames (relatorio barato)
+    void (*onMemorySample)(Interpreter *vm, const MemoryReport &report) = nullptr;
+};
+
+// Histograma do dispatch (so com WDIV_PROFILE_OPCODES)
+struct OpcodeProfile
+{
+    uint64_t opcodes[256];
+    uint64_t pairs[256 * 256]; // [anterior * 256 + actual]
 };
 
 struct FiberResult
@@ -77,11 +151,21 @@ struct FiberResult
     };
 
     Reason reason;
-    int instructionsRun;
+    uint64_t instructionsRun;
     float yieldMs;    // Se FIBER_YIELD
     int framePercent; // Se PROCESS_FRAME
 };
 
+// Pilhas de uma fiber (~5 KB): fora do Process, pedidas ao ProcessPool quando
+// a fiber arranca e devolvidas quando o processo morre. Um processo so com a
+// fiber principal nao paga as outras MAX_FIBERS - 1.
+struct FiberStack
+{
+    Value stack[STACK_MAX];
+    CallFrame frames[FRAMES_MAX];
+    uint8 *gosubStack[GOSUB_MAX];
+};
+
 struct Fiber
 {
 
@@ -89,15 +173,17 @@ struct Fiber
     float resumeTime; // Quando acorda (yield)
 
     uint8 *ip;
-    Value stack[STACK_MAX];
+    FiberStack *storage; // nullptr enquanto a fiber nunca arrancou
+    Value *stack;
     Value *stackTop;
-    CallFrame frames[FRAMES_MAX];
+    CallFrame *frames;
     int frameCount;
-    uint8_t* gosubStack[GOSUB_MAX]; 
+    uint8_t **gosubStack;
     int gosubTop{0};
 
     Fiber()
-        : state(FiberState::DEAD), resumeTime(0), ip(nullptr), stackTop(stack), frameCount(0)
+        : state(FiberState::DEAD), resumeTime(0), ip(nullptr), storage(nullptr), stack(nullptr),
+          stackTop(nullptr), frames(nullptr), frameCount(0), gosubStack(nullptr)
     {
     }
 };
@@ -119,6 +205,7 @@ struct ProcessDef
 {
     Vector<uint8> argsNames;
     String *name{nullptr};
+    uint32 index{0}; // em Interpreter::processes (e getProcessStats)
     Fiber fibers[MAX_FIBERS];
     Fiber *current;
     Value privates[MAX_PRIVATES];
@@ -147,10 +234,28 @@ struct Process
 
     bool initialized = false;
 
+    // Desde o spawn: instrucoes (so com WDIV_COUNT_INSTRUCTIONS) e ns (0 com
+    // setProcessTiming(false)) em run_process_step
+    uint32 defIndex = 0;
+    uint64_t instructions = 0;
+    uint64_t cpuNs = 0;
+
     void release();
     void finalize();
 };
 
+// Contas de um ProcessDef: ultimo update e acumulado desde o arranque
+struct ProcessStats
+{
+    String *name{nullptr};
+    uint32 steps{0};          // run_process_step no ultimo update
+    uint64_t instructions{0}; // ultimo update
+    uint64_t ns{0};           // ultimo update (0 com setProcessTiming(false))
+    uint64_t totalSteps{0};
+    uint64_t totalInstructions{0};
+    uint64_t totalNs{0};
+};
+
 struct IntEq
 {
     bool operator()(int a, int b) const { return a == b; }
@@ -164,13 +269,13 @@ struct StringEq
             return true;
         if (a->length() != b->length())
             return false;
-        return memcmp(a->chars(), b->chars(), a->length()) == 0;
+        return memcmp(a->bytes(), b->bytes(), a->length()) == 0;
     }
 };
 
 struct StringHasher
 {
-    size_t operator()(String *x) const { return x->hash; }
+    size_t operator()(String *x) const { return x->hashCode(); }
 };
 
 struct CStringHash
@@ -207,11 +312,20 @@ class Interpreter
 
     Vector<Function *> functions;
     Vector<ProcessDef *> processes;
+    Vector<ProcessStats> processStats_; // paralelo a processes
+    bool processTiming_{true};
     Vector<NativeDef> natives;
     Vector<Value> globalList;
 
     HashMap<String *, Value, StringHasher, StringEq> globals;
 
+    // type Nome { campos }: defs por nome/indice e ids globais dos nomes de campos
+    HashMap<const char *, int, CStringHash, CStringEq> structsMap;
+    Vector<StructDef *> structs;
+    HashMap<const char *, int, CStringHash, CStringEq> fieldsMap;
+    Vector<String *> fieldNames;
+    Vector<uint8> fieldSlots; // slot inicial dos sites: o do primeiro type que o declarou
+
     HeapAllocator arena;
 
     Vector<Process *> aliveProcesses;
@@ -227,11 +341,51 @@ class Interpreter
     Process *mainProcess;
     bool hasFatalError_;
 
+    // Instrucoes executadas desde a criacao (todas as fibers)
+    uint64_t instructionsExecuted_{0};
+
+    // nullptr se a lib foi compilada sem WDIV_PROFILE_OPCODES
+    OpcodeProfile *opcodeProfile_{nullptr};
+
+    // Profiler por amostragem: instrucoes ate a proxima amostra, contadas a
+    // partir do inicio da fatia do dispatch actual; sem
+    // WDIV_COUNT_INSTRUCTIONS, backedges e calls que faltam (UINT64_MAX =
+    // desligado)
+    Profiler *profiler_{nullptr};
+    bool profiling_{false};
+    uint64_t sampleCountdown_{UINT64_MAX};
+    uint32 takeSample(Fiber *fiber, const uint8 *ip);
+
+    // Tracer de eventos (startTrace); tracing_ e o teste nos pontos quentes
+    Tracer *tracer_{nullptr};
+    bool tracing_{false};
+    Value callNativeTraced(const NativeDef &native, int argCount, Value *args);
+
+    // Memoria: maximos vistos nos relatorios e amostragem no update
+    size_t memoryPeaks_[MEM_COUNT]{};
+    size_t memoryTotalPeak_{0};
+    size_t fiberStackPeak_{0};
+    uint32 memorySampleEvery_{0};
+    uint32 memorySampleFrame_{0};
+
     bool isTruthy(const Value &value);
     bool isFalsey(Value value);
 
     Compiler *compiler;
 
+    // Tiering: defs quentes sao re-optimizados numa thread e trocados na
+    // entrada da funcao ou no inicio do update
+    TierCompiler *tierCompiler_{nullptr};
+    Vector<Function *> tierPending_;
+    void tierUp(Function *func);
+    bool promote(Function *func);
+    void promoteTiered();
+
+    // Corpo do run_fiber. Checked = frame com codigo nao verificado: PUSH e
+    // slots de locals sao verificados instrucao a instrucao.
+    template <bool Checked>
+    FiberResult dispatch(Fiber *fiber);
+
     VMHooks hooks;
 
     // const Value &peek(int distance = 0);
@@ -240,6 +394,10 @@ class Interpreter
     void resetFiber();
     void initFiber(Fiber *fiber, Function *func);
     void setPrivateTable();
+
+    // obj.nome fora do caminho rapido de OP_GET_FIELD/OP_SET_FIELD (types, processos, strings)
+    bool getProperty(const Value &object, String *name, Value &out);
+    bool setProperty(const Value &object, String *name, const Value &value);
 public:
     Interpreter();
     ~Interpreter();
@@ -256,11 +414,28 @@ public:
     uint32 getTotalProcesses() const;
     uint32 getTotalAliveProcesses() const;
 
+    // Contas por ProcessDef (indice = ProcessDef::index). Steps e tempo
+    // contam sempre (o relogio e lido antes e depois de cada
+    // run_process_step; setProcessTiming(false) desliga-o); as instrucoes so
+    // com WDIV_COUNT_INSTRUCTIONS.
+    void setProcessTiming(bool enable);
+    const Vector<ProcessStats> &getProcessStats() const;
+    // Os ProcessDefs mais pesados no ultimo update (por ns; sem tempo por
+    // instrucoes, ou por steps se nao sao contadas); devolve quantos
+    // escreveu em out
+    uint32 getTopProcessStats(const ProcessStats **out, uint32 count) const;
+
     void destroyFunction(Function *func);
     void addFiber(Process *proc, Function *func);
 
     int registerNative(const char *name, NativeFunction func, int arity);
 
+    StructDef *addStruct(const char *name); // nullptr se ja existe
+    StructDef *findStruct(const char *name);
+    int addStructField(StructDef *def, const char *name); // slot, -1 se repetido
+    bool findField(const char *name, int *id, int *slot);
+    Value newStruct(StructDef *def, const Value *args, int argCount);
+
     void print(Value value);
 
     Function *addFunction(const char *name, int arity = 0);
@@ -272,6 +447,42 @@ public:
     FiberResult run_fiber(Fiber *fiber);
 
     float getCurrentTime() const;
+    // Instrucoes executadas: so com a lib compilada com WDIV_COUNT_INSTRUCTIONS
+    // (ou WDIV_PROFILE_OPCODES), como a libwdiv_counted do wdiv_bench; sem
+    // isso getInstructionCount e as instrucoes por processo ficam a 0
+    bool isInstructionCountEnabled() const;
+    uint64_t getInstructionCount() const;
+
+    // Histograma de opcodes, pares de opcodes e instrucoes por funcao.
+    // So conta com a lib compilada com WDIV_PROFILE_OPCODES (cmake
+    // -DWDIV_PROFILE_OPCODES=ON); sem isso o dispatch nao tem custo nenhum.
+    bool isOpcodeProfileEnabled() const;
+    void dumpOpcodeProfile(FILE *out = stdout, int maxRows = 30);
+    void resetOpcodeProfile();
+
+    // Profiler por amostragem (pilha de funcao:linha + processo de ~interval
+    // em ~interval instrucoes). Sem WDIV_COUNT_INSTRUCTIONS conta backedges
+    // e calls, com o interval convertido a ~8 instrucoes cada. stop mantem
+    // as amostras; getProfiler e nullptr antes do primeiro start.
+    void startProfiler(uint32 interval = 10000);
+    void stopProfiler();
+    Profiler *getProfiler();
+
+    // Trace de update/scheduling/steps/natives lentos/spawn/destroy/cleanup/
+    // render para chrome://tracing. capacity = eventos no ring buffer, que e
+    // alocado aqui; stop mantem os eventos para Tracer::writeJson.
+    void startTrace(size_t capacity = 1 << 16);
+    void stopTrace();
+    Tracer *getTracer();
+
+    // Memoria reservada/usada/livre por subsistema. O modo barato le
+    // contadores e percorre functions e as fibers dos processos vivos;
+    // detailed tambem percorre as classes de tamanho dos allocators.
+    void getMemoryReport(MemoryReport &report, bool detailed = false);
+    void dumpMemoryReport(FILE *out = stdout);
+    static const char *memorySubsystemName(int subsystem);
+    // hooks.onMemorySample de everyFrames em everyFrames updates (0 desliga)
+    void setMemorySampling(uint32 everyFrames);
 
     void runtimeError(const char *format, ...);
 
@@ -279,6 +490,15 @@ public:
 
     Function *compile(const char *source);
     Function *compileExpression(const char *source);
+    void setInlining(bool enable);
+    // Defs compilados depois disto ficam no baseline e sao optimizados numa
+    // thread quando passam TIER_HOT_THRESHOLD chamadas/saltos para tras
+    void setTiering(bool enable);
+    // Espera pela thread de tiering e troca ja os chunks prontos (testes,
+    // hosts que querem medir so o codigo optimizado)
+    void waitTiering();
+    // TIER_* do def em value, -1 se nao e um def
+    int getFunctionTier(Value value) const;
     bool run(const char *source, bool dump = false);
 
     void reset();
@@ -0,0 +1,22 @@
+#pragma once
+#include "config.hpp"
+
+// ============================================
+// NUMEROS <-> TEXTO
+// ============================================
+// Sem snprintf/strtod no caminho normal e sem buffers estaticos: escrevem
+// no buffer do chamador e nao poem '\0'.
+//
+// formatDouble da o texto mais curto (Grisu2) que volta a dar o mesmo
+// double: 0.1 -> "0.1", 3.0 -> "3", 1e21 -> "1e+21", 1.5e-7 -> "1.5e-7".
+//
+// parseLong/parseDouble seguem o std::from_chars: leem [first, last) e
+// devolvem o fim do numero, ou nullptr se nao ha numero (ou nao cabe num long).
+
+#define NUMBER_BUFFER_SIZE 32
+
+int formatLong(char *buffer, long value);
+int formatDouble(char *buffer, double value);
+
+const char *parseLong(const char *first, const char *last, long &out);
+const char *parseDouble(const char *first, const char *last, double &out);
@@ -5,6 +5,7 @@ enum Opcode : uint8
 {
     // Literals
     OP_CONSTANT,
+    OP_CONSTANT_LONG, // indice de 24 bits (chunks com mais de 256 constantes)
     OP_NIL,
     OP_TRUE,
     OP_FALSE,
@@ -39,12 +40,33 @@ enum Opcode : uint8
     OP_LESS,
     OP_LESS_EQUAL,
 
+    // Typed: so emitidos pelo Optimizer::specialize quando os dois operandos
+    // sao de certeza int (_II) ou double (_DD); nao testam tags
+    OP_ADD_II,
+    OP_SUB_II,
+    OP_MUL_II,
+    OP_LT_II,
+    OP_LE_II,
+    OP_GT_II,
+    OP_GE_II,
+    OP_ADD_DD,
+    OP_SUB_DD,
+    OP_MUL_DD,
+    OP_DIV_DD,
+    OP_LT_DD,
+    OP_LE_DD,
+    OP_GT_DD,
+    OP_GE_DD,
+
     // Variables
     OP_GET_LOCAL,
     OP_SET_LOCAL,
     OP_GET_GLOBAL,
     OP_SET_GLOBAL,
     OP_DEFINE_GLOBAL,
+    OP_GET_GLOBAL_LONG, // nome com indice de 24 bits
+    OP_SET_GLOBAL_LONG,
+    OP_DEFINE_GLOBAL_LONG,
     OP_GET_PRIVATE,
     OP_SET_PRIVATE,
 
@@ -52,11 +74,22 @@ enum Opcode : uint8
     OP_JUMP,
     OP_JUMP_IF_FALSE,
     OP_LOOP,
+    OP_JUMP_LONG, // offset de 24 bits: saltos por cima de mais de 64KB de codigo
+    OP_JUMP_IF_FALSE_LONG,
+    OP_LOOP_LONG,
     OP_GOSUB, 
     OP_RETURN_SUB  ,
 
+    // Numeric for: slot, mode, limite (+ step em FOR_STEP), offset 16 bits
+    OP_FOR_PREP,
+    OP_FOR_STEP,
+
+    // switch: kind, constante, count 16 bits; seguido de count+1 OP_JUMP (o ultimo e o default)
+    OP_SWITCH_TABLE,
+
     // Functions
     OP_CALL,
+    OP_TAIL_CALL, // como OP_CALL, mas reutiliza o frame actual; seguido de OP_RETURN
     OP_CALL_NATIVE,
     OP_RETURN,
     OP_RETURN_NIL,
@@ -74,7 +107,39 @@ enum Opcode : uint8
     OP_GET_INDEX,
     OP_SET_INDEX,
     OP_INVOKE,    
+    OP_GET_PROPERTY_LONG, // nome com indice de 24 bits
+    OP_SET_PROPERTY_LONG,
+    OP_INVOKE_LONG,
+    OP_NEW_STRUCT, // type (16 bits) + argc: campos pela ordem, o resto fica nil
+    OP_GET_FIELD,  // slot esperado + id do campo (16 bits)
+    OP_SET_FIELD,
+    OP_FORMAT,     // n partes -> uma string ("x={x}")
 
     // I/O
     OP_PRINT,
-};
\ No newline at end of file
+};
+
+// Operando "mode" de OP_FOR_PREP/OP_FOR_STEP: comparacao | (origem do limite << 2)
+enum ForCompare : uint8
+{
+    FOR_LESS,
+    FOR_LESS_EQUAL,
+    FOR_GREATER,
+    FOR_GREATER_EQUAL,
+};
+
+enum ForLimit : uint8
+{
+    FOR_LIMIT_CONSTANT,
+    FOR_LIMIT_LOCAL,
+    FOR_LIMIT_GLOBAL,
+    FOR_LIMIT_PRIVATE,
+};
+
+// Operando "kind" de OP_SWITCH_TABLE
+enum SwitchKind : uint8
+{
+    SWITCH_DENSE,  // constante = valor mais baixo, entrada = valor - base
+    SWITCH_SPARSE, // count constantes int ordenadas, pesquisa binaria
+    SWITCH_STRING, // count strings ordenadas por hash, compara o conteudo
+};
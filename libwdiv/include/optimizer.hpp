@@ -0,0 +1,49 @@
+#pragma once
+#include "config.hpp"
+#include <vector>
+
+class Code;
+
+// Salto para a frente que nao coube em 16 bits: o compilador deixa o operando
+// a 0 e guarda aqui o destino ate o chunk estar completo
+struct FarJump
+{
+    int operand; // offset do operando de 16 bits
+    int target;  // offset de destino
+};
+
+// Passes sobre bytecode ja emitido. Corre depois de resolveGotos/resolveGosubs,
+// quando todos os saltos (incluindo goto/gosub) ja tem offsets finais.
+class Optimizer
+{
+public:
+    // Jump threading, remocao de codigo morto e peephole (push/POP, condicoes
+    // constantes, saltos para a instrucao seguinte, comparacao tipada + NOT).
+    // Reescreve o chunk no lugar
+    // (o buffer nunca cresce). Devolve false se o chunk ficou igual.
+    static bool optimize(Code &chunk);
+
+    // Tamanho da instrucao em bytes (opcode + operandos); 0 se desconhecido
+    static int instructionLength(uint8 op);
+
+    // Valores consumidos/empilhados pela instrucao em offset; false se desconhecido
+    static bool stackEffect(const Code &chunk, size_t offset, int &pops, int &pushes);
+
+    // Inferencia de tipos dos slots da pilha (locals incluidos) ao longo do
+    // fluxo; troca ADD/LESS/... pelas versoes _II/_DD quando os dois operandos
+    // sao de certeza int ou double. arity = parametros (tipo desconhecido).
+    // <= e >= (GREATER/LESS + NOT) acabam em LE/GE_II/DD: se ha pares destes
+    // volta a correr optimize(). Corre depois de optimize(); devolve false se
+    // nada mudou.
+    static bool specialize(Code &chunk, int arity);
+
+    // Verificador: saltos, indices de constantes/locals/privates e pilha
+    // equilibrada em todos os caminhos. Devolve a profundidade maxima da pilha
+    // do frame (parametros incluidos) ou -1 se o chunk nao passa.
+    static int verify(const Code &chunk, int arity);
+
+    // Refaz o layout com OP_JUMP_LONG/OP_JUMP_IF_FALSE_LONG/OP_LOOP_LONG onde
+    // 16 bits nao chegam (os far incluidos). O chunk cresce; corre antes do
+    // optimize. false se FOR_*, GOSUB ou uma entrada de switch ficou longe demais.
+    static bool widenJumps(Code &chunk, const std::vector<FarJump> &far);
+};
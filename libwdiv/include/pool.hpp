@@ -6,7 +6,19 @@
 
 struct Value;
 struct Process;
+struct Fiber;
+struct FiberStack;
 struct HeapAllocator;
+
+// Interpolacao: maximo de partes por string, espaco de texto por numero e
+// quantos numeros o format() escreve na stack (acima disso vai ao heap)
+#define FORMAT_MAX_PARTS 255
+#define FORMAT_NUMBER_SIZE 32
+#define FORMAT_INLINE_NUMBERS 8
+
+// substring/trim partilham o buffer do pai (slice) a partir de SMALL_THRESHOLD;
+// uma slice menor que 1/SLICE_PIN_RATIO do dono e copiada (nao prende o dono)
+#define SLICE_PIN_RATIO 64
  
 
 class StringPool
@@ -14,6 +26,13 @@ class StringPool
 private:
     HeapAllocator allocator;
 
+    // "" e as strings de um caracter (at/sub) sao partilhadas, criadas a pedido
+    String *empty{nullptr};
+    String *singles[256]{};
+
+    String *single(unsigned char c);
+    String *slice(String *src, size_t start, size_t length);
+
 public:
     StringPool() = default;
     ~StringPool() = default;
@@ -42,10 +61,19 @@ public:
     String *at(String *str, int index);
     String *repeat(String *str, int count);
 
+    // Partes (strings, numeros, ...) juntas numa String nova do tamanho exacto
+    String *format(const Value *parts, int count);
+
     void destroy(String *s);
 
+    // Slice -> buffer proprio terminado em '\0' (no sitio; devolve chars())
+    const char *flatten(String *s);
+
     void clear();
 
+    // Headers + buffers das strings (Interpreter::getMemoryReport)
+    const HeapAllocator &getAllocator() const { return allocator; }
+
 
     static StringPool &instance()
     {
@@ -59,6 +87,9 @@ class ProcessPool
 {
 
     Vector<Process*> pool;
+    size_t allocated = 0; // Process vivos + reciclaveis (cada um sizeof(Process))
+    Vector<FiberStack*> stacks;
+    size_t stacksAllocated = 0; // em fibers + reciclaveis (cada um sizeof(FiberStack))
 public:
     ProcessPool();
     ~ProcessPool() = default;
@@ -74,6 +105,16 @@ public:
     void destory(Process *proc);
     void clear();
 
+    size_t allocatedCount() const { return allocated; }
+    size_t freeCount() const { return pool.size(); }
+
+    // Pilhas das fibers: attach antes de a fiber correr, detach devolve-as
+    void attachStack(Fiber *fiber);
+    void detachStack(Fiber *fiber);
+    void detachStacks(Process *proc);
+    size_t stackCount() const { return stacksAllocated; }
+    size_t freeStackCount() const { return stacks.size(); }
+
 };
  
 
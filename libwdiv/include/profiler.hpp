@@ -0,0 +1,64 @@
+#pragma once
+#include "config.hpp"
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+struct Function;
+struct Fiber;
+struct Process;
+struct String;
+
+// Profiler por amostragem: o dispatch chama sample() de ~interval em
+// ~interval instrucoes (com jitter, para nao entrar em fase com os loops),
+// ou, sem WDIV_COUNT_INSTRUCTIONS, backedges e calls. Cada amostra guarda o
+// processo e a pilha de CallFrames da fiber actual como funcao:linha. Os
+// pesos sao instrucoes (ou loops e calls), nao ns: um native lento conta
+// como uma instrucao.
+class Profiler
+{
+public:
+    explicit Profiler(uint32 interval);
+
+    // Instrucoes (ou backedges e calls) ate a proxima amostra
+    uint32 nextInterval();
+
+    // ip = instrucao actual da frame de topo
+    void sample(const Process *proc, const Fiber *fiber, const uint8 *ip);
+
+    void reset();
+    uint64_t sampleCount() const { return samples_; }
+
+    // Bytes nos vectors e maps (aproximado: overhead dos nos do std::map estimado)
+    size_t memoryUsed() const;
+
+    // Uma linha por pilha: "processo;funcao:linha;... N" (flamegraph.pl)
+    bool writeCollapsed(const char *path) const;
+
+    // Tabela por linha: self (no topo da pilha) e total (em qualquer frame)
+    void dumpLines(FILE *out = stdout, int maxRows = 30) const;
+
+private:
+    struct Site
+    {
+        const Function *func;
+        int line; // -1 se o ip nao esta em nenhum chunk da funcao
+    };
+
+    uint32 interval_;
+    uint32 random_;
+    uint64_t samples_;
+
+    std::vector<Site> sites_;
+    std::map<std::pair<const Function *, int>, uint32> siteIds_;
+
+    // Chave: processo (indice em processNames_) seguido dos sites, da base para o topo
+    std::map<std::vector<uint32>, uint64_t> stacks_;
+    std::vector<const String *> processNames_; // do ProcessDef, vivem com o Interpreter
+    std::vector<uint32> scratch_;
+
+    uint32 siteId(const Function *func, const uint8 *ip);
+    uint32 processId(const Process *proc);
+    void writeSite(FILE *out, uint32 id) const;
+};
@@ -1,10 +1,20 @@
 #pragma once
 #include "arena.hpp"
+#include <cstdint>
+
+struct String;
+
+// Copia uma slice para um buffer proprio terminado em '\0' (pool.cpp)
+const char *flattenString(String *s);
 
 struct String
 {
   static constexpr size_t SMALL_THRESHOLD = 23;
   static constexpr size_t IS_LONG_FLAG = 0x80000000u;
+  static constexpr size_t IS_SLICE_FLAG = 0x40000000u;    // ptr aponta para dentro do buffer de outra String
+  static constexpr size_t IS_PINNED_FLAG = 0x20000000u;   // ha slices no buffer: o destroy nao o liberta
+  static constexpr size_t HASH_PENDING_FLAG = 0x10000000u; // hash ainda por calcular (slices)
+  static constexpr size_t LENGTH_MASK = 0x0FFFFFFFu;
 
   size_t hash;
   size_t length_and_flag;
@@ -13,18 +23,32 @@ struct String
   {
     char *ptr;
     char data[24];
+    struct
+    {
+      char *bytes;   // == ptr
+      String *owner; // dono do buffer (nunca e ele proprio uma slice)
+    } slice;
   };
 
   bool isLong() const { return length_and_flag & IS_LONG_FLAG; }
-  size_t length() const { return length_and_flag & ~IS_LONG_FLAG; }
+  bool isSlice() const { return length_and_flag & IS_SLICE_FLAG; }
+  size_t length() const { return length_and_flag & LENGTH_MASK; }
 
-  const char *chars() const { return isLong() ? ptr : data; }
-  char *chars() { return isLong() ? ptr : data; }
+  // Texto terminado em '\0'. Nao e const: uma slice a meio do dono e copiada
+  // aqui (uma vez, flattenString). Quem ja usa length() deve ler bytes().
+  char *chars()
+  {
+    if (isSlice() && ptr[length()] != '\0')
+      return const_cast<char *>(flattenString(this));
+    return isLong() ? ptr : data;
+  }
 
+  // Os length() bytes, sem garantia de '\0' no fim
+  const char *bytes() const { return isLong() ? ptr : data; }
 
+  size_t hashCode();
 };
 
-
 // inline size_t_t hashString(const char *s, int len)
 // {
 //   size_t_t h = 2166136261u;
@@ -75,16 +99,53 @@ struct String
 //     return h;
 // }
 
+// A partir daqui o hash le 8 bytes de cada vez
+#define HASH_WORD_THRESHOLD 16
+
 inline size_t hashString(const char* s, uint32 len) {
-    size_t h = 2166136261u;
     const uint8* p = (const uint8*)s;
-    const uint8* end = p + len;
 
+    if (len < HASH_WORD_THRESHOLD) {
+        size_t h = 2166136261u;
+        const uint8* end = p + len;
+        while (p != end) {
+            h ^= *p++;
+            h *= 16777619u; // troca por 709607, 127, 131, 16777619, etc.
+        }
+        return h;
+    }
+
+    // Strings longas: uma multiplicacao por palavra em vez de uma por byte.
+    // O fim vem de uma leitura de 8 bytes sobreposta (len >= 16).
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    const uint8* end = p + (len & ~7u);
+    uint64_t w;
     while (p != end) {
-        h ^= *p++;
-        h *= 16777619u; // troca por 709607, 127, 131, 16777619, etc.
+        std::memcpy(&w, p, 8);
+        h ^= w * 0x87C37B91114253D5ULL;
+        h = ((h << 31) | (h >> 33)) * 0x4CF5AD432745937FULL;
+        p += 8;
     }
-    return h;
+    std::memcpy(&w, s + len - 8, 8);
+    h ^= w * 0x87C37B91114253D5ULL;
+
+    // Mistura final (murmur3 fmix64)
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
+inline size_t String::hashCode()
+{
+  if (length_and_flag & HASH_PENDING_FLAG)
+  {
+    hash = hashString(bytes(), (uint32)length());
+    length_and_flag &= ~HASH_PENDING_FLAG;
+  }
+  return hash;
 }
 
 
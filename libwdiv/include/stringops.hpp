@@ -0,0 +1,20 @@
+#pragma once
+#include "config.hpp"
+
+// ============================================
+// KERNELS DE TEXTO (StringPool)
+// ============================================
+// Procura e maiusculas/minusculas em blocos de 16 (SSE2) ou 32 (AVX2) bytes.
+// A versao e escolhida uma vez pelo CPUID; fora de x86 fica a escalar.
+// Trabalham com tamanhos explicitos: nao precisam (nem olham) do '\0'.
+// Maiusculas/minusculas so mexem em ASCII, como o toupper no locale "C".
+
+// Primeira ocorrencia de pattern em text, ou nullptr
+const char *findText(const char *text, size_t length, const char *pattern, size_t patternLength);
+
+// dest pode ser igual a src
+void upperText(char *dest, const char *src, size_t length);
+void lowerText(char *dest, const char *src, size_t length);
+
+// "avx2", "sse2" ou "scalar"
+const char *textKernelName();
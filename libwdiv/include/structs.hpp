@@ -0,0 +1,43 @@
+#pragma once
+#include "config.hpp"
+#include "value.hpp"
+
+// ============================================
+// TYPES (structs de layout fixo)
+// ============================================
+// type Enemy { hp, damage, speed }
+// Cada campo tem um slot fixo na instancia. O nome do campo e um id global
+// (o mesmo nome em types diferentes partilha o id); OP_GET_FIELD leva o slot
+// esperado e o id, e so procura o slot quando o type do objecto nao bate. O
+// slot encontrado e escrito no operando: cada site fica com o do ultimo type.
+
+// Instancia: StructInstance + fieldCount Values (<= 640 bytes, vem das size
+// classes do HeapAllocator)
+#define MAX_STRUCT_FIELDS 32
+#define MAX_STRUCT_TYPES 0xFFFF
+#define MAX_FIELD_IDS 0xFFFF
+
+struct StructDef
+{
+    String *name{nullptr};
+    int index;
+    uint8 fieldCount;
+    uint16 fieldIds[MAX_STRUCT_FIELDS];
+
+    int slotOf(int fieldId) const
+    {
+        for (int i = 0; i < fieldCount; i++)
+        {
+            if (fieldIds[i] == fieldId)
+                return i;
+        }
+        return -1;
+    }
+};
+
+struct StructInstance
+{
+    StructDef *def;
+
+    Value *fields() { return reinterpret_cast<Value *>(this + 1); }
+};
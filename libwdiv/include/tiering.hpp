@@ -0,0 +1,45 @@
+#pragma once
+#include "config.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+class Code;
+struct Function;
+
+// Thread de optimizacao: recebe copias de chunks de defs quentes, corre
+// Optimizer::optimize + specialize e publica o resultado em Function::optimized.
+// A troca do chunk e feita pelo Interpreter, num ponto seguro. O inlining
+// nao e um passo daqui: o compilador ja o faz no baseline.
+class TierCompiler
+{
+public:
+    TierCompiler();
+    ~TierCompiler(); // para a thread; copias por optimizar sao libertadas
+
+    // Chamado na thread da VM: copia o chunk e enfileira
+    void submit(Function *func);
+
+    // Bloqueia ate a fila estar vazia e o ultimo job publicado
+    void wait();
+
+    static Code *cloneChunk(const Code &chunk);
+
+private:
+    struct Job
+    {
+        Function *func;
+        Code *code;
+    };
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Job> jobs_;
+    bool stopping_;
+    bool running_; // job fora da fila a ser optimizado
+
+    void run();
+};
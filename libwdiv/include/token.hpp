@@ -17,6 +17,8 @@ enum TokenType
     // Keywords
     TOKEN_VAR,
     TOKEN_DEF,
+    TOKEN_CONST,
+    TOKEN_ENUM,
     TOKEN_IF,
     TOKEN_ELIF,
     TOKEN_ELSE,
@@ -0,0 +1,87 @@
+#pragma once
+#include "config.hpp"
+#include <chrono>
+#include <cstdint>
+
+// O que cada evento marca (categoria no JSON)
+enum TraceKind : uint8
+{
+    TRACE_UPDATE,   // Interpreter::update inteiro
+    TRACE_SCHEDULE, // varrimento de aliveProcesses (contem os steps)
+    TRACE_STEP,     // run_process_step, com o nome do ProcessDef
+    TRACE_NATIVE,   // native acima do limite
+    TRACE_SPAWN,    // instantaneo
+    TRACE_DESTROY,  // instantaneo
+    TRACE_CLEANUP,  // libertacao de cleanProcesses
+    TRACE_RENDER,   // ciclo de onRender
+};
+
+struct TraceEvent
+{
+    const char *name; // estatico ou String de ProcessDef/NativeDef (vivem com o Interpreter)
+    uint64_t start;   // ns (Tracer::now)
+    uint64_t end;     // == start nos instantaneos
+    uint32 id;        // id do processo (step, spawn, destroy)
+    uint8 kind;
+};
+
+// Tracer para chrome://tracing / Perfetto: ring buffer alocado no construtor,
+// gravar um evento so copia para la (os mais antigos sao escritos por cima).
+// Cada evento guarda inicio e fim e sai como evento completo ("ph":"X").
+class Tracer
+{
+public:
+    explicit Tracer(size_t capacity);
+    ~Tracer();
+
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    static uint64_t now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void complete(TraceKind kind, const char *name, uint64_t start, uint64_t end, uint32 id = 0)
+    {
+        TraceEvent &event = events_[head_];
+        event.name = name;
+        event.start = start;
+        event.end = end;
+        event.id = id;
+        event.kind = kind;
+        head_ = head_ + 1 == capacity_ ? 0 : head_ + 1;
+        if (count_ < capacity_)
+            count_++;
+        else
+            overwritten_++;
+    }
+
+    void instant(TraceKind kind, const char *name, uint32 id = 0)
+    {
+        uint64_t t = now();
+        complete(kind, name, t, t, id);
+    }
+
+    // Natives mais rapidos que isto nao sao gravados
+    uint64_t nativeThresholdNs() const { return nativeThresholdNs_; }
+    void setNativeThresholdNs(uint64_t ns) { nativeThresholdNs_ = ns; }
+
+    size_t capacity() const { return capacity_; }
+    size_t count() const { return count_; }
+    uint64_t overwritten() const { return overwritten_; }
+    void clear();
+
+    // Trace-event JSON (do mais antigo para o mais recente)
+    bool writeJson(const char *path) const;
+
+private:
+    TraceEvent *events_;
+    size_t capacity_;
+    size_t head_;
+    size_t count_;
+    uint64_t overwritten_;
+    uint64_t nativeThresholdNs_;
+};
@@ -2,6 +2,8 @@
 #include "config.hpp"
 #include "string.hpp"
 
+struct StructInstance;
+
 enum class ValueType : uint8
 {
   NIL,
@@ -13,7 +15,8 @@ enum class ValueType : uint8
   MAP,
   FUNCTION,
   NATIVE,
-  PROCESS
+  PROCESS,
+  STRUCT
 };
 
 struct Value
@@ -28,6 +31,7 @@ struct Value
     int functionId;
     int nativeId;
     int processId;
+    StructInstance *instance;
   } as;
 
   Value();
@@ -49,6 +53,7 @@ struct Value
   static Value makeFunction(int idx);
   static Value makeNative(int idx);
   static Value makeProcess(int idx);
+  static Value makeStruct(StructInstance *instance);
 
   // Type checks
   bool isNumber() const ;
@@ -60,6 +65,7 @@ struct Value
   bool isFunction() const { return type == ValueType::FUNCTION; }
   bool isNative() const { return type == ValueType::NATIVE; }
   bool isProcess() const { return type == ValueType::PROCESS; }
+  bool isStruct() const { return type == ValueType::STRUCT; }
 
   // Conversions
   bool asBool() const;
@@ -71,6 +77,7 @@ struct Value
   int asFunctionId() const;
   int asNativeId() const;
   int asProcessId() const;
+  StructInstance *asStruct() const;
 
 long asNumber() const;
 
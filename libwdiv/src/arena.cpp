@@ -42,6 +42,7 @@ HeapAllocator::HeapAllocator()
 	m_totalReserved = 0;
 	m_largeAllocations = 0;
 	m_largeAllocatedBytes = 0;
+	m_peakAllocated = 0;
 
 	m_chunkSpace = chunkArrayIncrement;
 	m_chunkCount = 0;
@@ -98,6 +99,8 @@ void *HeapAllocator::Allocate(size_t size)
 		m_totalAllocated += size;
 		m_largeAllocations++;
 		m_largeAllocatedBytes += size;
+		if (m_totalAllocated > m_peakAllocated)
+			m_peakAllocated = m_totalAllocated;
 		   Info("Large allocation: %zu bytes (bypassing arena!)", size);
 		return aAlloc(size);
 	}
@@ -112,6 +115,8 @@ void *HeapAllocator::Allocate(size_t size)
 		m_freeLists[index] = block->next;
 		m_totalAllocated += blockSize;
 		m_blockAllocations[index]++;
+		if (m_totalAllocated > m_peakAllocated)
+			m_peakAllocated = m_totalAllocated;
 		return block;
 	}
 	else
@@ -150,6 +155,8 @@ void *HeapAllocator::Allocate(size_t size)
 		m_totalReserved += chunkSize;
 		m_totalAllocated += blockSize;
 		m_blockAllocations[index]++;
+		if (m_totalAllocated > m_peakAllocated)
+			m_peakAllocated = m_totalAllocated;
 
 		return chunk->blocks;
 	}
@@ -213,6 +220,7 @@ void HeapAllocator::Free(void *p, size_t size)
 void HeapAllocator::Clear()
 {
 	m_totalAllocated = 0;
+	m_peakAllocated = 0;
 	m_totalReserved = 0;
 	m_largeAllocations = 0;
 	m_largeAllocatedBytes = 0;
@@ -248,6 +256,16 @@ void HeapAllocator::GetStats(AllocationStats &stats) const
     stats.largeAllocatedBytes = m_largeAllocatedBytes;
 
     std::memcpy(stats.blockStats, m_blockAllocations, sizeof(m_blockAllocations));
+
+    stats.peakAllocated = m_peakAllocated;
+    std::memset(stats.blockReserved, 0, sizeof(stats.blockReserved));
+    for (size_t i = 0; i < m_chunkCount; i++)
+        stats.blockReserved[s_blockSizeLookup[m_chunks[i].blockSize]] += chunkSize;
+}
+
+size_t HeapAllocator::GetBlockSize(size_t index)
+{
+    return index < blockSizes ? s_blockSizes[index] : 0;
 }
 
 void HeapAllocator::Stats()
@@ -5,10 +5,9 @@
  
 
 Code::Code(size_t capacity)
-    :  m_capacity(capacity), count(0)
+    :  m_capacity(capacity), count(0), lineRuns(nullptr), lineCount(0), lineCapacity(0)
 {
     code  = (uint8*) aAlloc(capacity * sizeof(uint8));
-    lines = (int*)aAlloc(capacity * sizeof(int));
 
     constants.reserve(8);
     m_frozen=false;
@@ -36,14 +35,16 @@ void Code::clear()
     aFree(code);
     code=nullptr;
     }
-    if(lines)
+    if(lineRuns)
     {
-    aFree(lines);
-    lines=nullptr;
+    aFree(lineRuns);
+    lineRuns=nullptr;
     }
     constants.destroy();
     m_capacity=0;
     count=0;
+    lineCount=0;
+    lineCapacity=0;
 
 }
 
@@ -65,20 +66,64 @@ void Code::reserve(size_t capacity)
         uint8 *newCode = (uint8*)aRealloc(code, capacity * sizeof(uint8));
         if (!newCode) return;  
         
-        int *newLine = (int*)aRealloc(lines, capacity * sizeof(int));
-        if (!newLine)
-        {
-            code = newCode;   
-            DEBUG_BREAK_IF(true);
-            return;
-        }
-        
         code = newCode;
-        lines = newLine;
         m_capacity = capacity;
     }
 }
 
+void Code::truncate(size_t newCount)
+{
+    if (newCount >= count)
+        return;
+
+    count = newCount;
+    while (lineCount > 0 && lineRuns[lineCount - 1].start >= newCount)
+        lineCount--;
+}
+
+void Code::shrink()
+{
+    size_t capacity = count > 0 ? count : 1;
+    if (capacity < m_capacity)
+    {
+        uint8 *newCode = (uint8*)aRealloc(code, capacity * sizeof(uint8));
+        if (newCode)
+        {
+            code = newCode;
+            m_capacity = capacity;
+        }
+    }
+
+    if (lineCount > 0 && lineCount < lineCapacity)
+    {
+        LineRun *newRuns = (LineRun*)aRealloc(lineRuns, lineCount * sizeof(LineRun));
+        if (newRuns)
+        {
+            lineRuns = newRuns;
+            lineCapacity = lineCount;
+        }
+    }
+}
+
+int Code::getLine(size_t offset) const
+{
+    if (lineCount == 0)
+        return 0;
+
+    // Ultima sequencia com start <= offset
+    size_t lo = 0;
+    size_t hi = lineCount;
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (lineRuns[mid].start <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lineRuns[lo].line;
+}
+
 
 
 void Code::write(uint8 instruction, int line)
@@ -91,7 +136,22 @@ void Code::write(uint8 instruction, int line)
     }
     
     code[count] = instruction;
-    lines[count] = line;
+
+    if (lineCount == 0 || lineRuns[lineCount - 1].line != line)
+    {
+        if (lineCapacity < lineCount + 1)
+        {
+            size_t newCapacity = GROW_CAPACITY(lineCapacity);
+            LineRun *newRuns = (LineRun*)aRealloc(lineRuns, newCapacity * sizeof(LineRun));
+            DEBUG_BREAK_IF(!newRuns);
+            lineRuns = newRuns;
+            lineCapacity = newCapacity;
+        }
+        lineRuns[lineCount].start = (uint32)count;
+        lineRuns[lineCount].line = line;
+        lineCount++;
+    }
+
     count++;
 }
 
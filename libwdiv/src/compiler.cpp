@@ -5,8 +5,13 @@
 #include "code.hpp"
 #include "value.hpp"
 #include "opcode.hpp"
+#include "optimizer.hpp"
+#include "numconv.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <climits>
+#include <cctype>
+#include <algorithm>
 #include <stdarg.h>
 #include <stdarg.h>
 
@@ -26,7 +31,8 @@ ParseRule Compiler::rules[TOKEN_COUNT];
 
 Compiler::Compiler(Interpreter *vm)
     : vm_(vm), lexer(nullptr), function(nullptr), currentChunk(nullptr), currentFiber(nullptr), currentProcess(nullptr),
-      hadError(false), panicMode(false), scopeDepth(0), localCount_(0), loopDepth_(0), isProcess_(false)
+      hadError(false), panicMode(false), scopeDepth(0), localCount_(0), loopDepth_(0), isProcess_(false),
+      foldCount_(0), foldBarrier_(0), inlining_(true), calleeOffset_(-1), lastCall_(-1), tiering_(false)
 {
 
     initRules();
@@ -108,46 +114,18 @@ void Compiler::initRules()
 // MAIN ENTRY POINT
 // ============================================
 
-Function *Compiler::compile(const std::string &source, Interpreter *vm)
+ProcessDef *Compiler::compile(const std::string &source)
 {
     clear();
-    vm_ = vm;
-    lexer = new Lexer(source);
-
-    function = vm->addFunction("__main__", 0);
-    currentProcess = vm->addProcess("__main_process__", function);
-    currentChunk = &function->chunk;
-    currentFiber = &currentProcess->fibers[0];
-
-    advance();
-
-    while (!match(TOKEN_EOF))
-    {
-        declaration();
-    }
-
-    emitReturn();
-
-    Function *result = function;
-    function = nullptr;
 
-    if (hadError)
-    {
-        return nullptr;
-    }
-
-    return result;
-}
-
-Process *Compiler::compile(const std::string &source )
-{
-    clear();
- 
     lexer = new Lexer(source);
 
+    tokens = lexer->scanAll();
+    collectStoredNames();
+
     function = vm_->addFunction("__main__", 0);
     currentProcess = vm_->addProcess("__main_process__", function);
-    currentChunk = &function->chunk;
+    currentChunk = function->chunk;
     currentFiber = &currentProcess->fibers[0];
 
     advance();
@@ -157,6 +135,9 @@ Process *Compiler::compile(const std::string &source )
         declaration();
     }
 
+    resolveGotos();
+    resolveGosubs();
+
     emitReturn();
 
     if (hadError)
@@ -164,6 +145,12 @@ Process *Compiler::compile(const std::string &source )
         return nullptr;
     }
 
+    widenFarJumps();
+    Optimizer::optimize(*currentChunk);
+    Optimizer::specialize(*currentChunk, 0);
+    function->maxStack = Optimizer::verify(*currentChunk, 0);
+    currentChunk->shrink();
+
     currentProcess->finalize();
 
     return currentProcess;
@@ -200,6 +187,11 @@ ProcessDef *Compiler::compileExpression(const std::string &source)
     {
         return nullptr;
     }
+    widenFarJumps();
+    Optimizer::optimize(*currentChunk);
+    Optimizer::specialize(*currentChunk, 0);
+    function->maxStack = Optimizer::verify(*currentChunk, 0);
+    currentChunk->shrink();
     currentProcess->finalize();
 
     return currentProcess;
@@ -220,6 +212,17 @@ void Compiler::clear()
     localCount_ = 0;
     loopDepth_ = 0;
     cursor = 0;
+    labels.clear();
+    pendingGotos.clear();
+    pendingGosubs.clear();
+    resetFolding();
+    inlineFunctions_.clear();
+    storedNames_.clear();
+    calleeOffset_ = -1;
+    lastCall_ = -1;
+    constantSlots_.clear();
+    farJumps_.clear();
+    namedConstants_.clear();
 }
 
 // ============================================
@@ -341,6 +344,9 @@ void Compiler::synchronize()
         {
         case TOKEN_DEF:
         case TOKEN_VAR:
+        case TOKEN_CONST:
+        case TOKEN_ENUM:
+        case TOKEN_TYPE:
         case TOKEN_FOR:
         case TOKEN_IF:
         case TOKEN_WHILE:
@@ -378,19 +384,144 @@ void Compiler::emitReturn()
 
 void Compiler::emitConstant(Value value)
 {
-    emitBytes(OP_CONSTANT, makeConstant(value));
+    int offset = (int)currentChunk->count;
+    size_t before = currentChunk->constants.size();
+    int constant = makeConstant(value);
+    emitOperand(OP_CONSTANT, constant);
+
+    // O valor da pool (um repetido ja foi libertado pelo makeConstant)
+    trackConstant(offset, currentChunk->constants[constant], currentChunk->constants.size() > before);
+}
+
+// ============================================
+// CONSTANT POOL
+// ============================================
+// Ints, doubles e strings entram uma so vez por chunk: a chave e o tipo mais
+// os bits do valor (doubles pelos bits, 0.0 e -0.0 ficam separados) ou o
+// conteudo da string. Com mais de 256 constantes os operandos passam a 24 bits.
+
+static bool constantKey(const Value &value, std::string &key)
+{
+    key.assign(1, (char)value.type);
+    if (value.isInt())
+    {
+        long v = value.asInt();
+        key.append((const char *)&v, sizeof(v));
+        return true;
+    }
+    if (value.isDouble())
+    {
+        double v = value.asDouble();
+        key.append((const char *)&v, sizeof(v));
+        return true;
+    }
+    if (value.isString())
+    {
+        key.append(value.asStringChars(), value.asString()->length());
+        return true;
+    }
+    return false;
 }
 
-uint8 Compiler::makeConstant(Value value)
+int Compiler::makeConstant(Value value)
 {
+    std::string key;
+    bool pooled = constantKey(value, key);
+
+    if (pooled)
+    {
+        auto it = constantSlots_.find(key);
+        if (it != constantSlots_.end())
+        {
+            const Value &existing = currentChunk->constants[it->second];
+            if (value.isString() && existing.asString() != value.asString())
+                destroyString(value.asString());
+            return it->second;
+        }
+    }
+
     int constant = currentChunk->addConstant(value);
-    if (constant > UINT8_MAX)
+    if (constant > MAX_CONSTANTS)
     {
         error("Too many constants in one chunk");
         return 0;
     }
 
-    return (uint8)constant;
+    if (pooled)
+        constantSlots_[key] = constant;
+    return constant;
+}
+
+// Nomes e literais: procura antes de criar a String
+int Compiler::stringConstant(const char *chars, size_t length)
+{
+    std::string key(1, (char)ValueType::STRING);
+    key.append(chars, length);
+
+    auto it = constantSlots_.find(key);
+    if (it != constantSlots_.end())
+        return it->second;
+
+    return makeConstant(Value::makeString(createString(chars, (uint32)length)));
+}
+
+// A constante saiu da pool (folding)
+void Compiler::forgetConstant(const Value &value)
+{
+    std::string key;
+    if (constantKey(value, key))
+        constantSlots_.erase(key);
+}
+
+// op com indice de constante; acima de 255 usa a versao _LONG (24 bits)
+void Compiler::emitOperand(uint8 op, int operand)
+{
+    emitOperand(op, operand, previous.line);
+}
+
+// line: a do codigo copiado (inlining), nao a do token actual
+void Compiler::emitOperand(uint8 op, int operand, int line)
+{
+    if (operand <= UINT8_MAX)
+    {
+        currentChunk->write(op, line);
+        currentChunk->write((uint8)operand, line);
+        return;
+    }
+
+    uint8 wide;
+    switch (op)
+    {
+    case OP_CONSTANT:
+        wide = OP_CONSTANT_LONG;
+        break;
+    case OP_GET_GLOBAL:
+        wide = OP_GET_GLOBAL_LONG;
+        break;
+    case OP_SET_GLOBAL:
+        wide = OP_SET_GLOBAL_LONG;
+        break;
+    case OP_DEFINE_GLOBAL:
+        wide = OP_DEFINE_GLOBAL_LONG;
+        break;
+    case OP_GET_PROPERTY:
+        wide = OP_GET_PROPERTY_LONG;
+        break;
+    case OP_SET_PROPERTY:
+        wide = OP_SET_PROPERTY_LONG;
+        break;
+    case OP_INVOKE:
+        wide = OP_INVOKE_LONG;
+        break;
+    default:
+        error("Operand too large");
+        return;
+    }
+
+    currentChunk->write(wide, line);
+    currentChunk->write((uint8)((operand >> 16) & 0xff), line);
+    currentChunk->write((uint8)((operand >> 8) & 0xff), line);
+    currentChunk->write((uint8)(operand & 0xff), line);
 }
 
 // ============================================
@@ -410,29 +541,465 @@ void Compiler::patchJump(int offset)
 {
     int jump = currentChunk->count - offset - 2;
 
+    // Longe demais: widenFarJumps trata dele quando o chunk estiver completo
     if (jump > UINT16_MAX)
     {
-        error("Too much code to jump over");
+        FarJump far;
+        far.operand = offset;
+        far.target = (int)currentChunk->count;
+        farJumps_.push_back(far);
+        jump = 0;
     }
 
     currentChunk->code[offset] = (jump >> 8) & 0xff;
     currentChunk->code[offset + 1] = jump & 0xff;
+
+    // O destino do salto passa a ser um ponto de entrada: nao dobrar por cima dele
+    foldBarrier_ = (int)currentChunk->count;
 }
 
 void Compiler::emitLoop(int loopStart)
 {
-    emitByte(OP_LOOP);
-
-    int offset = currentChunk->count - loopStart + 2;
+    int offset = currentChunk->count - loopStart + 3;
     if (offset > UINT16_MAX)
     {
-        error("Loop body too large");
+        // Para tras a distancia ja se sabe: sai logo com 24 bits
+        offset++;
+        if (offset > MAX_JUMP)
+        {
+            error("Loop body too large");
+        }
+
+        emitByte(OP_LOOP_LONG);
+        emitByte((offset >> 16) & 0xff);
+        emitByte((offset >> 8) & 0xff);
+        emitByte(offset & 0xff);
+        return;
     }
 
+    emitByte(OP_LOOP);
     emitByte((offset >> 8) & 0xff);
     emitByte(offset & 0xff);
 }
 
+void Compiler::widenFarJumps()
+{
+    if (farJumps_.empty())
+        return;
+
+    if (!hadError && !Optimizer::widenJumps(*currentChunk, farJumps_))
+    {
+        error("Too much code to jump over");
+    }
+    farJumps_.clear();
+}
+
+// ============================================
+// LABELS / GOTO / GOSUB
+// ============================================
+// Os saltos para labels so sao resolvidos no fim da funcao (o label pode vir
+// depois). goto vira OP_JUMP ou OP_LOOP consoante a direcao; gosub leva um
+// offset com sinal de 16 bits.
+
+void Compiler::labelStatement()
+{
+    consume(TOKEN_IDENTIFIER, "Expect label name");
+    Token name = previous;
+    consume(TOKEN_COLON, "Expect ':' after label");
+
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        if (labels[i].name == name.lexeme)
+        {
+            fail("Duplicate label '%s'", name.lexeme.c_str());
+            return;
+        }
+    }
+
+    labels.push_back({name.lexeme, (int)currentChunk->count});
+
+    // Ponto de entrada de saltos: nao dobrar constantes por cima
+    foldBarrier_ = (int)currentChunk->count;
+}
+
+void Compiler::gotoStatement()
+{
+    consume(TOKEN_IDENTIFIER, "Expect label name after 'goto'");
+    Token name = previous;
+    consume(TOKEN_SEMICOLON, "Expect ';' after goto");
+    pendingGotos.push_back({name.lexeme, emitJump(OP_JUMP)});
+}
+
+void Compiler::gosubStatement()
+{
+    consume(TOKEN_IDENTIFIER, "Expect label name after 'gosub'");
+    Token name = previous;
+    consume(TOKEN_SEMICOLON, "Expect ';' after gosub");
+    pendingGosubs.push_back({name.lexeme, emitJump(OP_GOSUB)});
+}
+
+static int findLabel(const std::vector<Label> &labels, const std::string &name)
+{
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        if (labels[i].name == name)
+            return labels[i].offset;
+    }
+    return -1;
+}
+
+void Compiler::resolveGotos()
+{
+    for (size_t i = 0; i < pendingGotos.size(); i++)
+    {
+        const GotoJump &jump = pendingGotos[i];
+        int target = findLabel(labels, jump.target);
+        if (target < 0)
+        {
+            fail("Undefined label '%s'", jump.target.c_str());
+            continue;
+        }
+
+        int from = jump.jumpOffset + 2;
+        int offset = target - from;
+        if (offset < 0)
+        {
+            offset = -offset;
+            if (offset > UINT16_MAX)
+            {
+                fail("Label '%s' too far back", jump.target.c_str());
+                continue;
+            }
+            currentChunk->code[jump.jumpOffset - 1] = OP_LOOP;
+        }
+        else if (offset > UINT16_MAX)
+        {
+            // Como no patchJump: widenFarJumps alarga no fim
+            FarJump far;
+            far.operand = jump.jumpOffset;
+            far.target = target;
+            farJumps_.push_back(far);
+            offset = 0;
+        }
+
+        currentChunk->code[jump.jumpOffset] = (offset >> 8) & 0xff;
+        currentChunk->code[jump.jumpOffset + 1] = offset & 0xff;
+    }
+}
+
+void Compiler::resolveGosubs()
+{
+    for (size_t i = 0; i < pendingGosubs.size(); i++)
+    {
+        const GotoJump &jump = pendingGosubs[i];
+        int target = findLabel(labels, jump.target);
+        if (target < 0)
+        {
+            fail("Undefined label '%s'", jump.target.c_str());
+            continue;
+        }
+
+        int offset = target - (jump.jumpOffset + 2);
+        if (offset < INT16_MIN || offset > INT16_MAX)
+        {
+            fail("Label '%s' too far for gosub", jump.target.c_str());
+            continue;
+        }
+
+        uint16 bits = (uint16)(int16)offset;
+        currentChunk->code[jump.jumpOffset] = (bits >> 8) & 0xff;
+        currentChunk->code[jump.jumpOffset + 1] = bits & 0xff;
+    }
+}
+
+// ============================================
+// CONSTANT FOLDING
+// ============================================
+// Regista as ultimas constantes emitidas; quando um operador encontra os
+// operandos todos constantes no fim do chunk, recua o chunk e emite o
+// resultado. A semantica segue a do run_fiber (int op int -> int, misto ->
+// double, erros de runtime ficam para o runtime).
+
+void Compiler::resetFolding()
+{
+    foldCount_ = 0;
+    foldBarrier_ = 0;
+}
+
+void Compiler::trackConstant(int offset, Value value, bool fresh)
+{
+    FoldConstant c;
+    c.offset = offset;
+    c.length = (int)currentChunk->count - offset;
+    c.value = value;
+    c.fresh = fresh;
+
+    // Cheio: esquece a mais antiga
+    if (foldCount_ == MAX_FOLD_CONSTANTS)
+    {
+        for (int i = 1; i < MAX_FOLD_CONSTANTS; i++)
+            foldConstants_[i - 1] = foldConstants_[i];
+        foldCount_--;
+    }
+    foldConstants_[foldCount_++] = c;
+}
+
+bool Compiler::peekConstants(int n, Value *out)
+{
+    if (foldCount_ < n)
+        return false;
+
+    // As n constantes tem de estar seguidas e a terminar no fim do chunk
+    int end = (int)currentChunk->count;
+    for (int i = 0; i < n; i++)
+    {
+        FoldConstant &c = foldConstants_[foldCount_ - 1 - i];
+        if (c.offset + c.length != end)
+            return false;
+        end = c.offset;
+        out[n - 1 - i] = c.value;
+    }
+
+    // Algum salto ja aterra no meio delas
+    return end >= foldBarrier_;
+}
+
+void Compiler::dropConstants(int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        FoldConstant &c = foldConstants_[--foldCount_];
+
+        // So sai da pool se foi esta instrucao que a meteu la (as repetidas sao partilhadas)
+        if (c.fresh)
+        {
+            const uint8 *operand = currentChunk->code + c.offset + 1;
+            int index = (c.length == 2) ? operand[0] : (operand[0] << 16) | (operand[1] << 8) | operand[2];
+            if (index + 1 == (int)currentChunk->constants.size())
+            {
+                forgetConstant(currentChunk->constants[index]);
+                currentChunk->constants.pop();
+            }
+        }
+        currentChunk->truncate(c.offset);
+    }
+}
+
+void Compiler::emitFolded(Value value)
+{
+    int offset = (int)currentChunk->count;
+
+    switch (value.type)
+    {
+    case ValueType::NIL:
+        emitByte(OP_NIL);
+        break;
+    case ValueType::BOOL:
+        emitByte(value.asBool() ? OP_TRUE : OP_FALSE);
+        break;
+    default:
+        emitConstant(value);
+        return;
+    }
+    trackConstant(offset, value, false);
+}
+
+static bool foldTruthy(const Value &v)
+{
+    switch (v.type)
+    {
+    case ValueType::NIL:
+        return false;
+    case ValueType::BOOL:
+        return v.asBool();
+    case ValueType::INT:
+        return v.asInt() != 0;
+    case ValueType::DOUBLE:
+        return v.asDouble() != 0.0;
+    default:
+        return true;
+    }
+}
+
+static bool foldNumbers(const Value &a, const Value &b, double &da, double &db)
+{
+    if (!(a.isInt() || a.isDouble()) || !(b.isInt() || b.isDouble()))
+        return false;
+    da = a.isInt() ? (double)a.asInt() : a.asDouble();
+    db = b.isInt() ? (double)b.asInt() : b.asDouble();
+    return true;
+}
+
+// Tipos que o valuesEqual compara por valor (strings pelo conteudo)
+static bool foldComparable(const Value &v)
+{
+    return v.isNil() || v.isBool() || v.isInt() || v.isDouble() || v.isString();
+}
+
+bool Compiler::foldUnary(TokenType op)
+{
+    Value v;
+    if (!peekConstants(1, &v))
+        return false;
+
+    Value result;
+    switch (op)
+    {
+    case TOKEN_MINUS:
+        if (v.isInt())
+            result = Value::makeInt((long)(0UL - (unsigned long)v.asInt()));
+        else if (v.isDouble())
+            result = Value::makeDouble(-v.asDouble());
+        else
+            return false;
+        break;
+    case TOKEN_BANG:
+        result = Value::makeBool(!foldTruthy(v));
+        break;
+    case TOKEN_TILDE:
+        if (!v.isInt())
+            return false;
+        result = Value::makeInt(~v.asInt());
+        break;
+    default:
+        return false;
+    }
+
+    dropConstants(1);
+    emitFolded(result);
+    return true;
+}
+
+bool Compiler::foldBinary(TokenType op)
+{
+    Value operands[2];
+    if (!peekConstants(2, operands))
+        return false;
+
+    const Value &a = operands[0];
+    const Value &b = operands[1];
+    bool ints = a.isInt() && b.isInt();
+    double da = 0, db = 0;
+    bool nums = foldNumbers(a, b, da, db);
+    unsigned long ua = ints ? (unsigned long)a.asInt() : 0;
+    unsigned long ub = ints ? (unsigned long)b.asInt() : 0;
+
+    Value result;
+    switch (op)
+    {
+    case TOKEN_PLUS:
+        if (a.isString() && b.isString())
+            result = Value::makeString(StringPool::instance().concat(a.asString(), b.asString()));
+        else if (ints)
+            result = Value::makeInt((long)(ua + ub));
+        else if (nums)
+            result = Value::makeDouble(da + db);
+        else
+            return false;
+        break;
+    case TOKEN_MINUS:
+        if (ints)
+            result = Value::makeInt((long)(ua - ub));
+        else if (nums)
+            result = Value::makeDouble(da - db);
+        else
+            return false;
+        break;
+    case TOKEN_STAR:
+        if (ints)
+            result = Value::makeInt((long)(ua * ub));
+        else if (nums)
+            result = Value::makeDouble(da * db);
+        else
+            return false;
+        break;
+    case TOKEN_SLASH:
+        // Divisao por zero fica para o runtime reportar
+        if (ints)
+        {
+            if (b.asInt() == 0 || (b.asInt() == -1 && a.asInt() == LONG_MIN))
+                return false;
+            result = Value::makeInt(a.asInt() / b.asInt());
+        }
+        else if (nums && db != 0.0)
+            result = Value::makeDouble(da / db);
+        else
+            return false;
+        break;
+    case TOKEN_PERCENT:
+        if (ints)
+        {
+            if (b.asInt() == 0 || b.asInt() == -1)
+                return false;
+            result = Value::makeInt(a.asInt() % b.asInt());
+        }
+        else if (nums && db != 0.0)
+            result = Value::makeDouble(std::fmod(da, db));
+        else
+            return false;
+        break;
+    case TOKEN_EQUAL_EQUAL:
+    case TOKEN_BANG_EQUAL:
+    {
+        if (!foldComparable(a) || !foldComparable(b) || (a.isString() && b.isString()))
+            return false;
+        bool equal = valuesEqual(a, b);
+        result = Value::makeBool(op == TOKEN_EQUAL_EQUAL ? equal : !equal);
+        break;
+    }
+    case TOKEN_LESS:
+        if (!nums)
+            return false;
+        result = Value::makeBool(da < db);
+        break;
+    case TOKEN_LESS_EQUAL:
+        if (!nums)
+            return false;
+        result = Value::makeBool(!(da > db));
+        break;
+    case TOKEN_GREATER:
+        if (!nums)
+            return false;
+        result = Value::makeBool(da > db);
+        break;
+    case TOKEN_GREATER_EQUAL:
+        if (!nums)
+            return false;
+        result = Value::makeBool(!(da < db));
+        break;
+    case TOKEN_PIPE:
+        if (!ints)
+            return false;
+        result = Value::makeInt(a.asInt() | b.asInt());
+        break;
+    case TOKEN_AMPERSAND:
+        if (!ints)
+            return false;
+        result = Value::makeInt(a.asInt() & b.asInt());
+        break;
+    case TOKEN_CARET:
+        if (!ints)
+            return false;
+        result = Value::makeInt(a.asInt() ^ b.asInt());
+        break;
+    case TOKEN_LEFT_SHIFT:
+    case TOKEN_RIGHT_SHIFT:
+        if (!ints || b.asInt() < 0 || b.asInt() >= (long)(sizeof(long) * 8))
+            return false;
+        if (op == TOKEN_LEFT_SHIFT)
+            result = Value::makeInt((long)(ua << b.asInt()));
+        else
+            result = Value::makeInt(a.asInt() >> b.asInt());
+        break;
+    default:
+        return false;
+    }
+
+    dropConstants(2);
+    emitFolded(result);
+    return true;
+}
+
 // ============================================
 // PRATT PARSER - CORE
 // ============================================
@@ -486,22 +1053,165 @@ ParseRule *Compiler::getRule(TokenType type)
 void Compiler::number(bool canAssign)
 {
     (void)canAssign;
-    if (previous.type == TOKEN_INT)
-    {
-        int value = std::atoi(previous.lexeme.c_str());
-        emitConstant(Value::makeInt(value));
-    }
-    else
+    emitConstant(numberLiteral(previous));
+}
+
+// Valor de um token TOKEN_INT/TOKEN_FLOAT (o lexer ja validou os digitos)
+Value Compiler::numberLiteral(Token &token)
+{
+    const char *first = token.lexeme.c_str();
+    const char *last = first + token.lexeme.size();
+    if (token.type == TOKEN_INT)
     {
-        double value = std::atof(previous.lexeme.c_str());
-        emitConstant(Value::makeDouble(value));
+        long value = 0;
+        if (!parseLong(first, last, value))
+            errorAt(token, "Integer literal too large");
+        return Value::makeInt(value);
     }
+    double value = 0.0;
+    parseDouble(first, last, value);
+    return Value::makeDouble(value);
 }
 
 void Compiler::string(bool canAssign)
 {
     (void)canAssign;
-    emitConstant(Value::makeString(previous.lexeme.c_str()));
+    if (previous.lexeme.find('{') != std::string::npos)
+    {
+        Token text = previous;
+        interpolation(text);
+        return;
+    }
+    emitString(previous.lexeme.c_str(), previous.lexeme.size());
+}
+
+void Compiler::emitString(const char *chars, size_t length)
+{
+    int offset = (int)currentChunk->count;
+    size_t before = currentChunk->constants.size();
+    int constant = stringConstant(chars, length);
+    emitOperand(OP_CONSTANT, constant);
+    trackConstant(offset, currentChunk->constants[constant], currentChunk->constants.size() > before);
+}
+
+// ============================================
+// INTERPOLACAO
+// ============================================
+// "x={x} y={y + 1}": o texto e partido aqui, cada {expr} e compilado no
+// sitio e OP_FORMAT junta as partes numa so String do tamanho exacto.
+// "{{" e um '{' literal. Um '{' so abre expressao se vier logo seguido de
+// algo que nao seja espaco nem '}' e tiver um '}' a fechar; de resto fica
+// literal ("{}" dos templates do format() dos hosts, "{ a }", "{" sozinho).
+// A expressao nao pode ter aspas: fechavam a string no lexer.
+
+static bool opensInterpolation(const std::string &chars, size_t i)
+{
+    if (i + 1 >= chars.size())
+        return false;
+    char next = chars[i + 1];
+    if (next == '}' || isspace((unsigned char)next))
+        return false;
+    return chars.find('}', i + 1) != std::string::npos;
+}
+
+void Compiler::interpolation(Token &text)
+{
+    const std::string &chars = text.lexeme;
+    std::string literal;
+    int parts = 0;
+    bool interpolated = false;
+
+    for (size_t i = 0; i < chars.size(); i++)
+    {
+        char c = chars[i];
+        if (c == '{' && i + 1 < chars.size() && chars[i + 1] == '{')
+        {
+            literal += '{';
+            i++;
+            continue;
+        }
+        if (c != '{' || !opensInterpolation(chars, i))
+        {
+            literal += c;
+            continue;
+        }
+
+        size_t close = chars.find('}', i + 1);
+        if (parts + 2 > FORMAT_MAX_PARTS)
+        {
+            errorAt(text, "Too many parts in interpolated string");
+            return;
+        }
+
+        if (!literal.empty())
+        {
+            emitString(literal.c_str(), literal.size());
+            literal.clear();
+            parts++;
+        }
+        if (!interpolatedExpression(chars.substr(i + 1, close - i - 1), text.line))
+            return;
+        parts++;
+        interpolated = true;
+        i = close;
+    }
+
+    if (!literal.empty() || parts == 0)
+    {
+        emitString(literal.c_str(), literal.size());
+        parts++;
+    }
+    if (!interpolated)
+        return;
+
+    // Tudo constante (literais, const): junta ja aqui
+    Value values[MAX_FOLD_CONSTANTS];
+    if (parts <= MAX_FOLD_CONSTANTS && peekConstants(parts, values))
+    {
+        String *folded = StringPool::instance().format(values, parts);
+        std::string result(folded->chars(), folded->length());
+        if (parts > 1 || !values[0].isString())
+            destroyString(folded);
+
+        dropConstants(parts);
+        emitString(result.c_str(), result.size());
+        return;
+    }
+
+    emitBytes(OP_FORMAT, (uint8)parts);
+}
+
+// Compila source (o que esta entre as chavetas) como uma expressao, com os
+// tokens do programa postos de lado
+bool Compiler::interpolatedExpression(const std::string &source, int line)
+{
+    Lexer sub(source);
+    std::vector<Token> subTokens = sub.scanAll();
+    for (size_t i = 0; i < subTokens.size(); i++)
+        subTokens[i].line = line;
+
+    std::vector<Token> savedTokens;
+    savedTokens.swap(tokens);
+    tokens.swap(subTokens);
+    int savedCursor = cursor;
+    Token savedCurrent = current;
+    Token savedPrevious = previous;
+
+    cursor = 0;
+    advance();
+    if (check(TOKEN_EOF))
+        errorAtCurrent("Expect expression inside '{}'");
+    else
+        expression();
+    if (!check(TOKEN_EOF))
+        errorAtCurrent("Expect '}' after interpolated expression");
+    bool ok = !hadError;
+
+    tokens.swap(savedTokens);
+    cursor = savedCursor;
+    current = savedCurrent;
+    previous = savedPrevious;
+    return ok;
 }
 
 void Compiler::literal(bool canAssign)
@@ -510,13 +1220,13 @@ void Compiler::literal(bool canAssign)
     switch (previous.type)
     {
     case TOKEN_TRUE:
-        emitByte(OP_TRUE);
+        emitFolded(Value::makeBool(true));
         break;
     case TOKEN_FALSE:
-        emitByte(OP_FALSE);
+        emitFolded(Value::makeBool(false));
         break;
     case TOKEN_NIL:
-        emitByte(OP_NIL);
+        emitFolded(Value::makeNil());
         break;
     default:
         return;
@@ -537,6 +1247,9 @@ void Compiler::unary(bool canAssign)
 
     parsePrecedence(PREC_UNARY);
 
+    if (foldUnary(operatorType))
+        return;
+
     switch (operatorType)
     {
     case TOKEN_MINUS:
@@ -560,6 +1273,9 @@ void Compiler::binary(bool canAssign)
 
     parsePrecedence((Precedence)(rule->prec + 1));
 
+    if (foldBinary(operatorType))
+        return;
+
     switch (operatorType)
     {
     case TOKEN_PLUS:
@@ -638,6 +1354,18 @@ void Compiler::declaration()
     {
         varDeclaration();
     }
+    else if (match(TOKEN_CONST))
+    {
+        constDeclaration();
+    }
+    else if (match(TOKEN_ENUM))
+    {
+        enumDeclaration();
+    }
+    else if (match(TOKEN_TYPE))
+    {
+        typeDeclaration();
+    }
     else
     {
         statement();
@@ -701,86 +1429,394 @@ void Compiler::statement()
     {
         doWhileStatement();
     }
-    else if (match(TOKEN_LOOP))
+    else if (match(TOKEN_LOOP))
+    {
+        loopStatement();
+    }
+    else if (match(TOKEN_FOR))
+    {
+        forStatement();
+    }
+    else if (match(TOKEN_BREAK))
+    {
+        breakStatement();
+    }
+    else if (match(TOKEN_SWITCH))
+    {
+        switchStatement();
+    }
+    else if (match(TOKEN_CONTINUE))
+    {
+        continueStatement();
+    }
+    else if (match(TOKEN_LBRACE))
+    {
+        beginScope();
+        block();
+        endScope();
+    }
+    else if (match(TOKEN_RETURN))
+    {
+        returnStatement();
+    }
+    else
+    {
+        expressionStatement();
+    }
+}
+
+void Compiler::printStatement()
+{
+    expression();
+    consume(TOKEN_SEMICOLON, "Expect ';' after value");
+    emitByte(OP_PRINT);
+}
+
+void Compiler::expressionStatement()
+{
+
+    // Expressão normal
+    expression();
+    consume(TOKEN_SEMICOLON, "Expresion statemnt Expect ';'");
+    emitByte(OP_POP);
+}
+
+// ============================================
+// VARIABLES
+// ============================================
+
+void Compiler::varDeclaration()
+{
+    consume(TOKEN_IDENTIFIER, "Expect variable name");
+    Token nameToken = previous;
+
+    int global = identifierConstant(nameToken);
+
+    if (scopeDepth > 0)
+    {
+        declareVariable();
+    }
+    else
+    {
+        if (namedConstants_.count(nameToken.lexeme))
+        {
+            error("Already a constant with this name");
+        }
+        if (vm_->findStruct(nameToken.lexeme.c_str()))
+        {
+            error("Already a type with this name");
+        }
+        forgetInline(nameToken.lexeme);
+    }
+
+    if (match(TOKEN_EQUAL))
+    {
+        expression();
+    }
+    else
+    {
+        emitByte(OP_NIL);
+    }
+
+    consume(TOKEN_SEMICOLON, "Expect ';' after variable declaration");
+
+    defineVariable(global);
+}
+
+// ============================================
+// CONST / ENUM
+// ============================================
+// const MAX = 10 * 4;  enum { IDLE, RUN, JUMP = 10 }
+// O valor e calculado pelo constant folding na declaracao (o codigo emitido
+// e depois descartado) e cada uso emite o literal: entra no folding, nas
+// tabelas de switch e no limite dos for numericos. Locals e privates com o
+// mesmo nome escondem a constante, como escondem um global.
+
+void Compiler::constDeclaration()
+{
+    consume(TOKEN_IDENTIFIER, "Expect constant name");
+    Token name = previous;
+    consume(TOKEN_EQUAL, "Expect '=' after constant name");
+
+    Value value;
+    std::string text;
+    if (!constantExpression(value, text))
+        return;
+
+    defineConstant(name, value, text);
+    consume(TOKEN_SEMICOLON, "Expect ';' after constant declaration");
+}
+
+void Compiler::enumDeclaration()
+{
+    // enum Nome { ... }: o nome e opcional e os membros ficam no mesmo espaco das constantes
+    match(TOKEN_IDENTIFIER);
+    consume(TOKEN_LBRACE, "Expect '{' after 'enum'");
+
+    long next = 0;
+    while (!check(TOKEN_RBRACE) && !check(TOKEN_EOF))
+    {
+        consume(TOKEN_IDENTIFIER, "Expect enum member name");
+        Token name = previous;
+
+        if (match(TOKEN_EQUAL))
+        {
+            Value value;
+            std::string text;
+            if (!constantExpression(value, text))
+                return;
+            if (!value.isInt())
+            {
+                error("Enum value must be an integer");
+                return;
+            }
+            next = value.asInt();
+        }
+
+        defineConstant(name, Value::makeInt(next), std::string());
+        next++;
+
+        if (!match(TOKEN_COMMA))
+            break;
+    }
+
+    consume(TOKEN_RBRACE, "Expect '}' after enum members");
+    match(TOKEN_SEMICOLON);
+}
+
+// Compila a expressao e exige que o folding a tenha reduzido a um literal
+bool Compiler::constantExpression(Value &out, std::string &text)
+{
+    int start = (int)currentChunk->count;
+    expression();
+    if (hadError)
+        return false;
+
+    Value value;
+    if (!peekConstants(1, &value) || foldConstants_[foldCount_ - 1].offset != start)
+    {
+        error("Expect constant expression");
+        return false;
+    }
+
+    if (value.isString())
+        text.assign(value.asStringChars(), value.asString()->length());
+
+    // A string so e libertada se saiu da pool (era desta expressao)
+    size_t before = currentChunk->constants.size();
+    dropConstants(1);
+    if (value.isString() && currentChunk->constants.size() < before)
+        destroyString(value.asString());
+
+    out = value;
+    return true;
+}
+
+void Compiler::defineConstant(Token &name, const Value &value, const std::string &text)
+{
+    if (scopeDepth > 0)
+    {
+        errorAt(name, "Constants must be declared at top level");
+        return;
+    }
+    if (namedConstants_.count(name.lexeme))
     {
-        loopStatement();
+        errorAt(name, "Constant already defined");
+        return;
     }
-    else if (match(TOKEN_FOR))
+
+    NamedConstant constant;
+    constant.isString = value.isString();
+    constant.value = constant.isString ? Value::makeNil() : value;
+    constant.text = text;
+    namedConstants_[name.lexeme] = constant;
+}
+
+const NamedConstant *Compiler::lookupConstant(Token &name)
+{
+    if (namedConstants_.empty())
+        return nullptr;
+
+    if (isProcess_ && vm_->getProcessPrivateIndex(name.lexeme.c_str()) != -1)
+        return nullptr;
+    if (resolveLocal(name) != -1)
+        return nullptr;
+
+    auto it = namedConstants_.find(name.lexeme);
+    return (it != namedConstants_.end()) ? &it->second : nullptr;
+}
+
+void Compiler::emitNamedConstant(const NamedConstant &constant)
+{
+    if (constant.isString)
+        emitString(constant.text.c_str(), constant.text.size());
+    else
+        emitFolded(constant.value);
+}
+
+// ============================================
+// TYPES
+// ============================================
+// type Enemy { hp, damage, speed }  var e = Enemy(100, 5);  e.hp -= 10;
+// O type e registado no Interpreter durante a compilacao: o construtor vira
+// OP_NEW_STRUCT e obj.campo (nome de campo de algum type) vira OP_GET_FIELD/
+// OP_SET_FIELD com o slot esperado. Redeclarar com os mesmos campos e valido
+// (cada script compilado no mesmo Interpreter volta a declarar os seus).
+
+void Compiler::typeDeclaration()
+{
+    consume(TOKEN_IDENTIFIER, "Expect type name");
+    Token name = previous;
+    consume(TOKEN_LBRACE, "Expect '{' after type name");
+
+    std::vector<std::string> fields;
+    while (!check(TOKEN_RBRACE) && !check(TOKEN_EOF))
     {
-        forStatement();
+        consume(TOKEN_IDENTIFIER, "Expect field name");
+        for (size_t i = 0; i < fields.size(); i++)
+        {
+            if (fields[i] == previous.lexeme)
+            {
+                error("Duplicate field name");
+                return;
+            }
+        }
+        fields.push_back(previous.lexeme);
+
+        if (!match(TOKEN_COMMA))
+            break;
     }
-    else if (match(TOKEN_BREAK))
+
+    consume(TOKEN_RBRACE, "Expect '}' after type fields");
+    match(TOKEN_SEMICOLON);
+
+    if (scopeDepth > 0)
     {
-        breakStatement();
+        errorAt(name, "Types must be declared at top level");
+        return;
     }
-    else if (match(TOKEN_SWITCH))
+    if (fields.size() > MAX_STRUCT_FIELDS)
     {
-        switchStatement();
+        errorAt(name, "Too many fields in type");
+        return;
     }
-    else if (match(TOKEN_CONTINUE))
+    if (namedConstants_.count(name.lexeme))
     {
-        continueStatement();
+        errorAt(name, "Already a constant with this name");
+        return;
     }
-    else if (match(TOKEN_LBRACE))
+
+    if (StructDef *existing = vm_->findStruct(name.lexeme.c_str()))
     {
-        beginScope();
-        block();
-        endScope();
+        bool same = existing->fieldCount == fields.size();
+        for (size_t i = 0; same && i < fields.size(); i++)
+        {
+            int id, slot;
+            same = vm_->findField(fields[i].c_str(), &id, &slot) && existing->fieldIds[i] == id;
+        }
+        if (!same)
+            errorAt(name, "Type already defined with other fields");
+        return;
     }
-    else if (match(TOKEN_RETURN))
+
+    StructDef *def = vm_->addStruct(name.lexeme.c_str());
+    if (!def)
     {
-        returnStatement();
+        errorAt(name, "Too many types");
+        return;
     }
-    else
+    for (size_t i = 0; i < fields.size(); i++)
     {
-        expressionStatement();
+        if (vm_->addStructField(def, fields[i].c_str()) == -1)
+        {
+            errorAt(name, "Too many field names");
+            return;
+        }
     }
 }
 
-void Compiler::printStatement()
+void Compiler::newStruct(StructDef *def)
 {
-    expression();
-    consume(TOKEN_SEMICOLON, "Expect ';' after value");
-    emitByte(OP_PRINT);
+    consume(TOKEN_LPAREN, "Expect '(' after type name");
+    uint8 argCount = argumentList();
+    if (argCount > def->fieldCount)
+    {
+        fail("Type '%s' has %d fields", def->name->chars(), (int)def->fieldCount);
+        return;
+    }
+
+    emitByte(OP_NEW_STRUCT);
+    emitByte((uint8)((def->index >> 8) & 0xff));
+    emitByte((uint8)(def->index & 0xff));
+    emitByte(argCount);
 }
 
-void Compiler::expressionStatement()
+void Compiler::emitField(uint8 op, int slot, int field)
 {
-
-    // Expressão normal
-    expression();
-    consume(TOKEN_SEMICOLON, "Expresion statemnt Expect ';'");
-    emitByte(OP_POP);
+    emitByte(op);
+    emitByte((uint8)slot);
+    emitByte((uint8)((field >> 8) & 0xff));
+    emitByte((uint8)(field & 0xff));
 }
 
-// ============================================
-// VARIABLES
-// ============================================
-
-void Compiler::varDeclaration()
+void Compiler::dot(bool canAssign)
 {
-    consume(TOKEN_IDENTIFIER, "Expect variable name");
-    Token nameToken = previous;
-
-    uint8 global = identifierConstant(nameToken);
+    consume(TOKEN_IDENTIFIER, "Expect property name after '.'");
+    Token name = previous;
 
-    if (scopeDepth > 0)
+    // Campo de algum type: acesso por slot (os outros objectos vao pelo nome)
+    int field, slot;
+    if (!check(TOKEN_LPAREN) && vm_->findField(name.lexeme.c_str(), &field, &slot))
     {
-        declareVariable();
+        uint8 op = 0;
+        if (canAssign && match(TOKEN_EQUAL))
+        {
+            expression();
+            emitField(OP_SET_FIELD, slot, field);
+            return;
+        }
+        else if (canAssign && match(TOKEN_PLUS_EQUAL))
+            op = OP_ADD;
+        else if (canAssign && match(TOKEN_MINUS_EQUAL))
+            op = OP_SUBTRACT;
+        else if (canAssign && match(TOKEN_STAR_EQUAL))
+            op = OP_MULTIPLY;
+        else if (canAssign && match(TOKEN_SLASH_EQUAL))
+            op = OP_DIVIDE;
+        else if (canAssign && match(TOKEN_PERCENT_EQUAL))
+            op = OP_MODULO;
+
+        if (op == 0)
+        {
+            emitField(OP_GET_FIELD, slot, field);
+            return;
+        }
+
+        // obj.campo op= expr: [obj] -> [obj obj] -> [obj valor] -> [obj novo] -> [novo]
+        emitByte(OP_DUP);
+        emitField(OP_GET_FIELD, slot, field);
+        expression();
+        emitByte(op);
+        emitField(OP_SET_FIELD, slot, field);
+        return;
     }
 
-    if (match(TOKEN_EQUAL))
+    int nameConstant = identifierConstant(name);
+    if (canAssign && match(TOKEN_EQUAL))
     {
         expression();
+        emitOperand(OP_SET_PROPERTY, nameConstant);
+    }
+    else if (match(TOKEN_LPAREN))
+    {
+        uint8 argCount = argumentList();
+        emitOperand(OP_INVOKE, nameConstant);
+        emitByte(argCount);
     }
     else
     {
-        emitByte(OP_NIL);
+        emitOperand(OP_GET_PROPERTY, nameConstant);
     }
-
-    consume(TOKEN_SEMICOLON, "Expect ';' after variable declaration");
-
-    defineVariable(global);
 }
 
 void Compiler::variable(bool canAssign)
@@ -811,10 +1847,9 @@ void Compiler::or_(bool canAssign)
     patchJump(endJump);
 }
 
-uint8 Compiler::identifierConstant(Token &name)
+int Compiler::identifierConstant(Token &name)
 {
-
-    return makeConstant(Value::makeString(name.lexeme.c_str()));
+    return stringConstant(name.lexeme.c_str(), name.lexeme.size());
 }
 
 void Compiler::handle_assignment(uint8 getOp, uint8 setOp, int arg, bool canAssign)
@@ -823,66 +1858,66 @@ void Compiler::handle_assignment(uint8 getOp, uint8 setOp, int arg, bool canAssi
     if (match(TOKEN_PLUS_PLUS))
     {
         // i++ (postfix)
-        emitBytes(getOp, (uint8)arg);
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
+        emitOperand(getOp, arg);
         emitConstant(Value::makeInt(1));
         emitByte(OP_ADD);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
         emitByte(OP_POP);
     }
     else if (match(TOKEN_MINUS_MINUS))
     {
         // i-- (postfix)
-        emitBytes(getOp, (uint8)arg);
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
+        emitOperand(getOp, arg);
         emitConstant(Value::makeInt(1));
         emitByte(OP_SUBTRACT);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
         emitByte(OP_POP);
     }
     else if (canAssign && match(TOKEN_EQUAL))
     {
         expression();
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else if (canAssign && match(TOKEN_PLUS_EQUAL))
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
         expression();
         emitByte(OP_ADD);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else if (canAssign && match(TOKEN_MINUS_EQUAL))
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
         expression();
         emitByte(OP_SUBTRACT);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else if (canAssign && match(TOKEN_STAR_EQUAL))
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
         expression();
         emitByte(OP_MULTIPLY);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else if (canAssign && match(TOKEN_SLASH_EQUAL))
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
         expression();
         emitByte(OP_DIVIDE);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else if (canAssign && match(TOKEN_PERCENT_EQUAL))
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
         expression();
         emitByte(OP_MODULO);
-        emitBytes(setOp, (uint8)arg);
+        emitOperand(setOp, arg);
     }
     else
     {
-        emitBytes(getOp, (uint8)arg);
+        emitOperand(getOp, arg);
     }
 }
 void Compiler::namedVariable(Token &name, bool canAssign)
@@ -913,15 +1948,46 @@ void Compiler::namedVariable(Token &name, bool canAssign)
         return;
     }
 
-    // === 3. É GLOBAL ===
+    // === 3. const/enum: literal no sitio ===
+    if (const NamedConstant *constant = lookupConstant(name))
+    {
+        if ((canAssign && (check(TOKEN_EQUAL) || check(TOKEN_PLUS_EQUAL) || check(TOKEN_MINUS_EQUAL) ||
+                           check(TOKEN_STAR_EQUAL) || check(TOKEN_SLASH_EQUAL) || check(TOKEN_PERCENT_EQUAL))) ||
+            check(TOKEN_PLUS_PLUS) || check(TOKEN_MINUS_MINUS))
+        {
+            error("Can't assign to a constant");
+            return;
+        }
+        emitNamedConstant(*constant);
+        return;
+    }
+
+    // === 4. type: Nome(campos...) ===
+    if (StructDef *def = vm_->findStruct(name.lexeme.c_str()))
+    {
+        newStruct(def);
+        return;
+    }
+
+    // === 5. É GLOBAL ===
     arg = identifierConstant(name);
     getOp = OP_GET_GLOBAL;
     setOp = OP_SET_GLOBAL;
 
+    // So chamadas directas podem ser inlined; se o nome escapa ou e reatribuido, deixa de ser
+    if (check(TOKEN_LPAREN))
+    {
+        calleeOffset_ = (int)currentChunk->count;
+    }
+    else
+    {
+        forgetInline(name.lexeme);
+    }
+
     handle_assignment(getOp, setOp, arg, canAssign);
 }
 
-void Compiler::defineVariable(uint8 global)
+void Compiler::defineVariable(int global)
 {
     if (scopeDepth > 0)
     {
@@ -930,7 +1996,7 @@ void Compiler::defineVariable(uint8 global)
         return;
     }
 
-    emitBytes(OP_DEFINE_GLOBAL, global);
+    emitOperand(OP_DEFINE_GLOBAL, global);
 }
 
 void Compiler::declareVariable()
@@ -1195,78 +2261,309 @@ void Compiler::doWhileStatement()
     // do
     consume(TOKEN_LBRACE, "Expect '{' after 'do'");
 
-    int loopStart = currentChunk->count;
+    int loopStart = currentChunk->count;
+
+    beginLoop(loopStart);
+
+    // BODY (executa primeiro)
+    beginScope();
+    block();
+    endScope();
+
+    // while (condition)
+    consume(TOKEN_WHILE, "Expect 'while' after do body");
+    consume(TOKEN_LPAREN, "Expect '(' after 'while'");
+    expression(); // Condição
+    consume(TOKEN_RPAREN, "Expect ')' after condition");
+    consume(TOKEN_SEMICOLON, "Expect ';' after do-while");
+
+    // Se condição for TRUE, volta ao início
+    int exitJump = emitJump(OP_JUMP_IF_FALSE);
+    emitByte(OP_POP); // Pop se true
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    emitByte(OP_POP); // Pop se false
+
+    endLoop();
+}
+
+void Compiler::loopStatement()
+{
+    // loop { ... }
+
+    int loopStart = currentChunk->count;
+
+    beginLoop(loopStart);
+
+    // Body
+    consume(TOKEN_LBRACE, "Expect '{' after 'loop'");
+    beginScope();
+    block();
+    endScope();
+
+    // Volta sempre ao início (loop infinito)
+    emitLoop(loopStart);
+
+    // Patch dos breaks (única forma de sair!)
+    endLoop();
+}
+
+void Compiler::switchStatement()
+{
+    consume(TOKEN_LPAREN, "Expect '(' after 'switch'");
+    expression(); // [value]
+    consume(TOKEN_RPAREN, "Expect ')' after switch expression");
+    consume(TOKEN_LBRACE, "Expect '{' before switch body");
+
+    // Todos os labels sao ints ou strings literais -> tabela de saltos
+    if (switchTable())
+        return;
+
+    std::vector<int> endJumps;
+    std::vector<int> caseFailJumps;
+
+    // Parse cases
+    while (match(TOKEN_CASE))
+    {
+        emitByte(OP_DUP); // [value, value]
+        expression();     // [value, value, case_val]
+        consume(TOKEN_COLON, "Expect ':' after case value");
+        emitByte(OP_EQUAL); // [value, bool]
+
+        int caseJump = emitJump(OP_JUMP_IF_FALSE);
+        emitByte(OP_POP); // [value] - Pop comparison result
+
+        emitByte(OP_POP); // []
+
+        // Case body
+        while (!check(TOKEN_CASE) && !check(TOKEN_DEFAULT) &&
+               !check(TOKEN_RBRACE) && !check(TOKEN_EOF))
+        {
+            statement();
+        }
+
+        endJumps.push_back(emitJump(OP_JUMP));
+
+        patchJump(caseJump);
+        emitByte(OP_POP); // [value] - Pop comparison result
+
+        // ← switch value ainda no stack para próximo case
+    }
+
+    // Default (opcional)
+    if (match(TOKEN_DEFAULT))
+    {
+        consume(TOKEN_COLON, "Expect ':' after 'default'");
+
+        emitByte(OP_POP); // []
+
+        while (!check(TOKEN_CASE) && !check(TOKEN_RBRACE) && !check(TOKEN_EOF))
+        {
+            statement();
+        }
+    }
+    else
+    {
+
+        emitByte(OP_POP); // []
+    }
+
+    consume(TOKEN_RBRACE, "Expect '}' after switch body");
+
+    for (int jump : endJumps)
+    {
+        patchJump(jump);
+    }
+}
+
+// ============================================
+// SWITCH TABLE
+// ============================================
+// switch (v) { case 1: ... case 7: ... default: ... } com labels literais
+// (todos int ou todos string) compila para:
+//   <v> OP_SWITCH_TABLE kind constante count
+//   OP_JUMP case_0 ... OP_JUMP case_count-1, OP_JUMP default
+// Os cases nao caem para o seguinte e o primeiro label repetido ganha,
+// como na cadeia DUP/EQUAL. As strings nao sao internadas pela StringPool,
+// por isso as chaves comparam-se pelo conteudo (hash primeiro).
+
+static bool switchKeyLess(const Value &a, const Value &b)
+{
+    if (a.isString())
+    {
+        if (a.asString()->hashCode() != b.asString()->hashCode())
+            return a.asString()->hashCode() < b.asString()->hashCode();
+        return a.asString() < b.asString();
+    }
+    return a.asInt() < b.asInt();
+}
+
+static int findSwitchKey(const std::vector<Value> &keys, const Value &key)
+{
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (key.isString() ? StringEq()(keys[i].asString(), key.asString()) : valuesEqual(keys[i], key))
+            return (int)i;
+    }
+    return -1;
+}
+
+// Label de case literal: int (com '-' opcional), string ou const/enum
+bool Compiler::caseKey(Token &label, bool negative, Value &key)
+{
+    if (label.type == TOKEN_INT)
+    {
+        long value = numberLiteral(label).asInt();
+        key = Value::makeInt(negative ? -value : value);
+        return true;
+    }
+    if (label.type == TOKEN_STRING && !negative)
+    {
+        key = Value::makeString(label.lexeme.c_str());
+        return true;
+    }
+    if (label.type != TOKEN_IDENTIFIER)
+        return false;
+
+    const NamedConstant *constant = lookupConstant(label);
+    if (!constant)
+        return false;
+    if (constant->isString && !negative)
+    {
+        key = Value::makeString(constant->text.c_str());
+        return true;
+    }
+    if (constant->value.isInt())
+    {
+        key = Value::makeInt(negative ? -constant->value.asInt() : constant->value.asInt());
+        return true;
+    }
+    return false;
+}
 
-    beginLoop(loopStart);
+bool Compiler::switchTable()
+{
+    if (hadError)
+        return false;
 
-    // BODY (executa primeiro)
-    beginScope();
-    block();
-    endScope();
+    // Labels de cada case (current e tokens[cursor - 1])
+    std::vector<Value> labels;
+    bool strings = false;
+    int depth = 0;
 
-    // while (condition)
-    consume(TOKEN_WHILE, "Expect 'while' after do body");
-    consume(TOKEN_LPAREN, "Expect '(' after 'while'");
-    expression(); // Condição
-    consume(TOKEN_RPAREN, "Expect ')' after condition");
-    consume(TOKEN_SEMICOLON, "Expect ';' after do-while");
+    for (size_t i = cursor - 1; i < tokens.size(); i++)
+    {
+        const Token &t = tokens[i];
+        if (t.type == TOKEN_EOF)
+            return false;
+        if (t.type == TOKEN_LBRACE)
+            depth++;
+        else if (t.type == TOKEN_RBRACE && depth-- == 0)
+            break;
 
-    // Se condição for TRUE, volta ao início
-    int exitJump = emitJump(OP_JUMP_IF_FALSE);
-    emitByte(OP_POP); // Pop se true
-    emitLoop(loopStart);
+        if (depth != 0 || t.type != TOKEN_CASE || i + 3 >= tokens.size())
+            continue;
 
-    patchJump(exitJump);
-    emitByte(OP_POP); // Pop se false
+        bool negative = tokens[i + 1].type == TOKEN_MINUS;
+        Token label = tokens[negative ? i + 2 : i + 1];
+        Value key;
+        if (tokens[negative ? i + 3 : i + 2].type != TOKEN_COLON || !caseKey(label, negative, key))
+            return false;
 
-    endLoop();
-}
+        if (!labels.empty() && key.isString() != strings)
+            return false;
+        strings = key.isString();
+        labels.push_back(key);
+    }
 
-void Compiler::loopStatement()
-{
-    // loop { ... }
+    if ((int)labels.size() < SWITCH_MIN_CASES)
+        return false;
 
-    int loopStart = currentChunk->count;
+    std::vector<Value> keys;
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        if (findSwitchKey(keys, labels[i]) == -1)
+            keys.push_back(labels[i]);
+    }
+    std::sort(keys.begin(), keys.end(), switchKeyLess);
 
-    beginLoop(loopStart);
+    uint8 kind;
+    long low = 0;
+    int count;
+    if (strings)
+    {
+        kind = SWITCH_STRING;
+        count = (int)keys.size();
+    }
+    else
+    {
+        low = keys.front().asInt();
+        long range = keys.back().asInt() - low + 1;
+        if (range <= (long)keys.size() * 2 && range <= SWITCH_MAX_RANGE)
+        {
+            kind = SWITCH_DENSE;
+            count = (int)range;
+        }
+        else
+        {
+            kind = SWITCH_SPARSE;
+            count = (int)keys.size();
+        }
+    }
 
-    // Body
-    consume(TOKEN_LBRACE, "Expect '{' after 'loop'");
-    beginScope();
-    block();
-    endScope();
+    int needed = (kind == SWITCH_DENSE) ? 1 : count;
+    if ((int)currentChunk->constants.size() + needed > UINT8_MAX + 1)
+        return false;
 
-    // Volta sempre ao início (loop infinito)
-    emitLoop(loopStart);
+    // Chaves consecutivas na pool (sem passar pelo makeConstant, que reaproveita)
+    uint8 first;
+    if (kind == SWITCH_DENSE)
+    {
+        first = (uint8)makeConstant(Value::makeInt(low));
+    }
+    else
+    {
+        first = (uint8)currentChunk->constants.size();
+        for (size_t i = 0; i < keys.size(); i++)
+            currentChunk->addConstant(keys[i]);
+    }
 
-    // Patch dos breaks (única forma de sair!)
-    endLoop();
-}
+    emitByte(OP_SWITCH_TABLE);
+    emitBytes(kind, first);
+    emitBytes((uint8)((count >> 8) & 0xff), (uint8)(count & 0xff));
 
-void Compiler::switchStatement()
-{
-    consume(TOKEN_LPAREN, "Expect '(' after 'switch'");
-    expression(); // [value]
-    consume(TOKEN_RPAREN, "Expect ')' after switch expression");
-    consume(TOKEN_LBRACE, "Expect '{' before switch body");
+    std::vector<int> entries(count + 1);
+    std::vector<bool> patched(count + 1, false);
+    for (int i = 0; i <= count; i++)
+        entries[i] = emitJump(OP_JUMP);
 
     std::vector<int> endJumps;
-    std::vector<int> caseFailJumps;
 
-    // Parse cases
     while (match(TOKEN_CASE))
     {
-        emitByte(OP_DUP); // [value, value]
-        expression();     // [value, value, case_val]
+        bool negative = match(TOKEN_MINUS);
+        advance();
+        Token label = previous;
         consume(TOKEN_COLON, "Expect ':' after case value");
-        emitByte(OP_EQUAL); // [value, bool]
 
-        int caseJump = emitJump(OP_JUMP_IF_FALSE);
-        emitByte(OP_POP); // [value] - Pop comparison result
+        // Ja validado na procura dos labels
+        Value key;
+        caseKey(label, negative, key);
 
-        emitByte(OP_POP); // []
+        int entry;
+        if (kind == SWITCH_DENSE)
+            entry = (int)(key.asInt() - low);
+        else
+            entry = findSwitchKey(keys, key);
+
+        // Label repetido: corpo inalcancavel, o optimizer remove-o
+        if (!patched[entry])
+        {
+            patchJump(entries[entry]);
+            patched[entry] = true;
+        }
 
-        // Case body
         while (!check(TOKEN_CASE) && !check(TOKEN_DEFAULT) &&
                !check(TOKEN_RBRACE) && !check(TOKEN_EOF))
         {
@@ -1274,19 +2571,18 @@ void Compiler::switchStatement()
         }
 
         endJumps.push_back(emitJump(OP_JUMP));
-
-        patchJump(caseJump);
-        emitByte(OP_POP); // [value] - Pop comparison result
-
-        // ← switch value ainda no stack para próximo case
     }
 
-    // Default (opcional)
+    // Default (e buracos da tabela densa)
     if (match(TOKEN_DEFAULT))
     {
         consume(TOKEN_COLON, "Expect ':' after 'default'");
 
-        emitByte(OP_POP); // []
+        for (int i = 0; i <= count; i++)
+        {
+            if (!patched[i])
+                patchJump(entries[i]);
+        }
 
         while (!check(TOKEN_CASE) && !check(TOKEN_RBRACE) && !check(TOKEN_EOF))
         {
@@ -1295,8 +2591,11 @@ void Compiler::switchStatement()
     }
     else
     {
-
-        emitByte(OP_POP); // []
+        for (int i = 0; i <= count; i++)
+        {
+            if (!patched[i])
+                endJumps.push_back(entries[i]);
+        }
     }
 
     consume(TOKEN_RBRACE, "Expect '}' after switch body");
@@ -1305,6 +2604,7 @@ void Compiler::switchStatement()
     {
         patchJump(jump);
     }
+    return true;
 }
 
 void Compiler::breakStatement()
@@ -1334,7 +2634,15 @@ void Compiler::forStatement()
     }
     else if (match(TOKEN_VAR))
     {
+        Token counter = current;
         varDeclaration(); // var i = 0;
+
+        // for (var i = a; i < b; i++) { ... } -> OP_FOR_PREP/OP_FOR_STEP
+        if (numericForStatement(counter))
+        {
+            endScope();
+            return;
+        }
     }
     else
     {
@@ -1407,6 +2715,212 @@ void Compiler::forStatement()
     endScope(); // Limpa variáveis do initializer
 }
 
+// Ciclo numerico canonico: for (var i = a; i <op> limite; i++ | i-- | i += n | i -= n) { ... }
+// O limite e um literal ou uma variavel (relida em cada iteracao, como no
+// caminho generico) e o step e uma constante. Se o corpo pode alterar i,
+// usa o caminho generico.
+bool Compiler::numericForStatement(Token &counter)
+{
+    if (hadError || counter.type != TOKEN_IDENTIFIER)
+        return false;
+
+    // Num process, o nome pode ser um private (namedVariable resolve-o primeiro)
+    if (isProcess_ && vm_->getProcessPrivateIndex(counter.lexeme.c_str()) != -1)
+        return false;
+
+    int slot = resolveLocal(counter);
+    if (slot != localCount_ - 1)
+        return false;
+
+    // Condicao: i <op> limite ;
+    if (current.type != TOKEN_IDENTIFIER || current.lexeme != counter.lexeme)
+        return false;
+
+    uint8 compare;
+    switch (peek(0).type)
+    {
+    case TOKEN_LESS:
+        compare = FOR_LESS;
+        break;
+    case TOKEN_LESS_EQUAL:
+        compare = FOR_LESS_EQUAL;
+        break;
+    case TOKEN_GREATER:
+        compare = FOR_GREATER;
+        break;
+    case TOKEN_GREATER_EQUAL:
+        compare = FOR_GREATER_EQUAL;
+        break;
+    default:
+        return false;
+    }
+
+    Token limit = peek(1);
+    if ((limit.type != TOKEN_INT && limit.type != TOKEN_FLOAT && limit.type != TOKEN_IDENTIFIER) ||
+        peek(2).type != TOKEN_SEMICOLON)
+        return false;
+
+    // Incremento: i++  ++i  i--  --i  i += n  i -= n
+    int at = 3;
+    double step = 0;
+    bool intStep = true;
+    Token a = peek(at);
+    Token b = peek(at + 1);
+
+    if (a.type == TOKEN_IDENTIFIER && a.lexeme == counter.lexeme &&
+        (b.type == TOKEN_PLUS_PLUS || b.type == TOKEN_MINUS_MINUS))
+    {
+        step = (b.type == TOKEN_PLUS_PLUS) ? 1 : -1;
+        at += 2;
+    }
+    else if ((a.type == TOKEN_PLUS_PLUS || a.type == TOKEN_MINUS_MINUS) &&
+             b.type == TOKEN_IDENTIFIER && b.lexeme == counter.lexeme)
+    {
+        step = (a.type == TOKEN_PLUS_PLUS) ? 1 : -1;
+        at += 2;
+    }
+    else if (a.type == TOKEN_IDENTIFIER && a.lexeme == counter.lexeme &&
+             (b.type == TOKEN_PLUS_EQUAL || b.type == TOKEN_MINUS_EQUAL) &&
+             (peek(at + 2).type == TOKEN_INT || peek(at + 2).type == TOKEN_FLOAT))
+    {
+        Token amount = peek(at + 2);
+        intStep = amount.type == TOKEN_INT;
+        Value value = numberLiteral(amount);
+        step = intStep ? (double)value.asInt() : value.asDouble();
+        if (b.type == TOKEN_MINUS_EQUAL)
+            step = -step;
+        at += 3;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (peek(at).type != TOKEN_RPAREN || peek(at + 1).type != TOKEN_LBRACE)
+        return false;
+
+    if (loopBodyAssigns(counter.lexeme, cursor + at + 1))
+        return false;
+
+    // Limite: mesma resolucao que namedVariable
+    uint8 limitKind;
+    int limitArg = -1;
+    if (limit.type == TOKEN_IDENTIFIER)
+    {
+        if (isProcess_ && (limitArg = vm_->getProcessPrivateIndex(limit.lexeme.c_str())) != -1)
+            limitKind = FOR_LIMIT_PRIVATE;
+        else if ((limitArg = resolveLocal(limit)) != -1)
+            limitKind = FOR_LIMIT_LOCAL;
+        else if (const NamedConstant *constant = lookupConstant(limit))
+        {
+            if (!constant->value.isInt() && !constant->value.isDouble())
+                return false;
+            limitKind = FOR_LIMIT_CONSTANT;
+            limitArg = makeConstant(constant->value);
+        }
+        else
+        {
+            limitKind = FOR_LIMIT_GLOBAL;
+            limitArg = identifierConstant(limit);
+            forgetInline(limit.lexeme);
+        }
+    }
+    else
+    {
+        limitKind = FOR_LIMIT_CONSTANT;
+        limitArg = makeConstant(numberLiteral(limit));
+    }
+
+    int stepConstant = makeConstant(intStep ? Value::makeInt((long)step) : Value::makeDouble(step));
+    uint8 mode = (uint8)(compare | (limitKind << 2));
+
+    // FOR_PREP/FOR_STEP so tem operandos de 8 bits
+    if (limitArg > UINT8_MAX || stepConstant > UINT8_MAX)
+        return false;
+
+    // Consome condicao e incremento
+    for (int i = 0; i <= at; i++)
+        advance();
+    consume(TOKEN_RPAREN, "Expect ')' after for clauses");
+
+    // continue -> trampolim -> FOR_STEP (o optimizer encurta a cadeia)
+    int entryJump = emitJump(OP_JUMP);
+    int continueStart = currentChunk->count;
+    int stepJump = emitJump(OP_JUMP);
+    patchJump(entryJump);
+
+    emitBytes(OP_FOR_PREP, (uint8)slot);
+    emitBytes(mode, (uint8)limitArg);
+    emitBytes(0xff, 0xff);
+    int exitJump = currentChunk->count - 2;
+
+    int bodyStart = currentChunk->count;
+    beginLoop(continueStart);
+
+    statement();
+
+    patchJump(stepJump);
+
+    emitBytes(OP_FOR_STEP, (uint8)slot);
+    emitBytes(mode, (uint8)limitArg);
+    emitByte((uint8)stepConstant);
+    int offset = currentChunk->count - bodyStart + 2;
+    if (offset > UINT16_MAX)
+    {
+        error("Loop body too large");
+    }
+    emitByte((offset >> 8) & 0xff);
+    emitByte(offset & 0xff);
+
+    patchJump(exitJump);
+
+    endLoop();
+    return true;
+}
+
+// Procura, no corpo { ... } que comeca no token 'from', algo que possa
+// reatribuir 'name' (atribuicoes, ++/--, ou um var com o mesmo nome).
+bool Compiler::loopBodyAssigns(const std::string &name, int from)
+{
+    int depth = 0;
+    for (size_t i = from; i < tokens.size(); i++)
+    {
+        const Token &t = tokens[i];
+
+        if (t.type == TOKEN_LBRACE)
+            depth++;
+        else if (t.type == TOKEN_RBRACE && --depth == 0)
+            return false;
+        else if (t.type == TOKEN_EOF)
+            return true;
+
+        if (t.type != TOKEN_IDENTIFIER || t.lexeme != name)
+            continue;
+
+        TokenType before = tokens[i - 1].type;
+        TokenType after = (i + 1 < tokens.size()) ? tokens[i + 1].type : TOKEN_EOF;
+
+        if (before == TOKEN_PLUS_PLUS || before == TOKEN_MINUS_MINUS || before == TOKEN_VAR)
+            return true;
+
+        switch (after)
+        {
+        case TOKEN_EQUAL:
+        case TOKEN_PLUS_EQUAL:
+        case TOKEN_MINUS_EQUAL:
+        case TOKEN_STAR_EQUAL:
+        case TOKEN_SLASH_EQUAL:
+        case TOKEN_PERCENT_EQUAL:
+        case TOKEN_PLUS_PLUS:
+        case TOKEN_MINUS_MINUS:
+            return true;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
 void Compiler::returnStatement()
 {
 
@@ -1431,15 +2945,24 @@ void Compiler::returnStatement()
     else
     {
         // return <expr>;
+        lastCall_ = -1;
         expression();
         consume(TOKEN_SEMICOLON, "Expect ';' after return value");
+
+        // return f(...); -> reutiliza o frame (o OP_RETURN fica para quando
+        // o callee nao e uma funcao)
+        if (lastCall_ >= 0 && lastCall_ + 2 == (int)currentChunk->count &&
+            currentChunk->code[lastCall_] == OP_CALL)
+        {
+            currentChunk->code[lastCall_] = OP_TAIL_CALL;
+        }
         emitByte(OP_RETURN);
     }
 
     function->hasReturn = true;
 }
 
-uint8 Compiler::argumentList()
+uint8 Compiler::argumentList(std::vector<int> *argStarts)
 {
     uint8 argCount = 0;
 
@@ -1447,6 +2970,8 @@ uint8 Compiler::argumentList()
     {
         do
         {
+            if (argStarts)
+                argStarts->push_back((int)currentChunk->count);
             expression();
 
             if (argCount == 255)
@@ -1463,7 +2988,20 @@ uint8 Compiler::argumentList()
 
 void Compiler::call(bool canAssign)
 {
-    uint8 argCount = argumentList();
+    // callee foi emitido mesmo antes do '(' (GET_GLOBAL ou GET_GLOBAL_LONG)?
+    int calleeStart = -1;
+    if (calleeOffset_ >= 0 && calleeOffset_ < (int)currentChunk->count &&
+        calleeOffset_ + Optimizer::instructionLength(currentChunk->code[calleeOffset_]) == (int)currentChunk->count)
+        calleeStart = calleeOffset_;
+    calleeOffset_ = -1;
+
+    std::vector<int> argStarts;
+    uint8 argCount = argumentList(&argStarts);
+
+    if (calleeStart >= 0 && tryInline(calleeStart, argStarts))
+        return;
+
+    lastCall_ = (int)currentChunk->count;
     emitByte(OP_CALL);
     emitByte(argCount);
 }
@@ -1485,10 +3023,15 @@ void Compiler::funDeclaration()
     // Compila função
     compileFunction(func, false); // false = não é process
 
+    if (scopeDepth == 0 && !hadError)
+    {
+        registerInline(nameToken, func);
+    }
+
     // Emite constant com o index da função
     emitConstant(Value::makeFunction(funcIndex));
     // Define como global
-    uint8 nameConstant = identifierConstant(nameToken);
+    int nameConstant = identifierConstant(nameToken);
     defineVariable(nameConstant);
 }
 
@@ -1549,7 +3092,7 @@ void Compiler::processDeclaration()
     // Warning("Process '%s' registered with index %d", nameToken.lexeme.c_str(), index);
 
     emitConstant(Value::makeProcess(index));
-    uint8 nameConstant = identifierConstant(nameToken);
+    int nameConstant = identifierConstant(nameToken);
     defineVariable(nameConstant);
 
     proc->finalize();
@@ -1559,6 +3102,19 @@ void Compiler::processDeclaration()
 
 void Compiler::compileFunction(Function *func, bool isProcess)
 {
+    // Antes de trocar o estado: sair aqui deixa o chunk de fora intacto
+    if (!func)
+    {
+        Error("Error in funcion");
+        return;
+    }
+
+    if (!func->chunk)
+    {
+        Error("Error in funcion code");
+        return;
+    }
+
     // Salva estado
     Function *enclosing = this->function;
     Code *enclosingChunk = this->currentChunk;
@@ -1566,27 +3122,25 @@ void Compiler::compileFunction(Function *func, bool isProcess)
     int enclosingLocalCount = this->localCount_;
     bool wasInProcess = this->isProcess_;
 
+    // Pool de constantes, saltos longos e labels sao por chunk
+    std::unordered_map<std::string, int> enclosingConstants;
+    std::vector<FarJump> enclosingFarJumps;
+    std::vector<Label> enclosingLabels;
+    std::vector<GotoJump> enclosingGotos;
+    std::vector<GotoJump> enclosingGosubs;
+    enclosingConstants.swap(constantSlots_);
+    enclosingFarJumps.swap(farJumps_);
+    enclosingLabels.swap(labels);
+    enclosingGotos.swap(pendingGotos);
+    enclosingGosubs.swap(pendingGosubs);
+
     // Troca contexto
     this->function = func;
     this->currentChunk = func->chunk;
     this->scopeDepth = 0;
     this->localCount_ = 0;
     this->isProcess_ = isProcess;
-    labels.clear();
-    pendingGotos.clear();
-    pendingGosubs.clear();
-
-    if (!func)
-    {
-        Error("Error in funcion");
-        return;
-    }
-
-    if (!func->chunk)
-    {
-        Error("Error in funcion code");
-        return;
-    }
+    resetFolding();
 
     // Parse parâmetros
     beginScope();
@@ -1624,21 +3178,41 @@ void Compiler::compileFunction(Function *func, bool isProcess)
     resolveGotos();
     resolveGosubs();
 
-    labels.clear();
-    pendingGotos.clear();
-    pendingGosubs.clear();
-
     if (!function->hasReturn)
     {
         emitReturn();
     }
 
+    widenFarJumps();
+
+    if (!hadError)
+    {
+        if (tiering_ && !isProcess)
+        {
+            func->tier = TIER_BASELINE;
+        }
+        else
+        {
+            Optimizer::optimize(*currentChunk);
+            Optimizer::specialize(*currentChunk, func->arity);
+        }
+        func->maxStack = Optimizer::verify(*currentChunk, func->arity);
+        currentChunk->shrink();
+    }
+
     // Restaura estado
     this->function = enclosing;
     this->currentChunk = enclosingChunk;
     this->scopeDepth = enclosingScopeDepth;
     this->localCount_ = enclosingLocalCount;
     this->isProcess_ = wasInProcess;
+    constantSlots_.swap(enclosingConstants);
+    farJumps_.swap(enclosingFarJumps);
+    labels.swap(enclosingLabels);
+    pendingGotos.swap(enclosingGotos);
+    pendingGosubs.swap(enclosingGosubs);
+    resetFolding();
+    foldBarrier_ = enclosingChunk ? (int)enclosingChunk->count : 0;
 }
 
 void Compiler::prefixIncrement(bool canAssign)
@@ -1664,6 +3238,11 @@ void Compiler::prefixIncrement(bool canAssign)
         getOp = OP_GET_LOCAL;
         setOp = OP_SET_LOCAL;
     }
+    else if (lookupConstant(name))
+    {
+        error("Can't assign to a constant");
+        return;
+    }
     else
     {
         arg = identifierConstant(name);
@@ -1672,13 +3251,13 @@ void Compiler::prefixIncrement(bool canAssign)
     }
 
     // i = i + 1
-    emitBytes(getOp, (uint8)arg);
+    emitOperand(getOp, arg);
     emitConstant(Value::makeInt(1));
     emitByte(OP_ADD);
-    emitBytes(setOp, (uint8)arg);
+    emitOperand(setOp, arg);
 
     // Lê o novo valor para retornar
-    emitBytes(getOp, (uint8)arg);
+    emitOperand(getOp, arg);
 }
 
 void Compiler::prefixDecrement(bool canAssign)
@@ -1702,6 +3281,11 @@ void Compiler::prefixDecrement(bool canAssign)
         getOp = OP_GET_LOCAL;
         setOp = OP_SET_LOCAL;
     }
+    else if (lookupConstant(name))
+    {
+        error("Can't assign to a constant");
+        return;
+    }
     else
     {
         arg = identifierConstant(name);
@@ -1709,12 +3293,12 @@ void Compiler::prefixDecrement(bool canAssign)
         setOp = OP_SET_GLOBAL;
     }
 
-    emitBytes(getOp, (uint8)arg);
+    emitOperand(getOp, arg);
     emitConstant(Value::makeInt(1));
     emitByte(OP_SUBTRACT);
-    emitBytes(setOp, (uint8)arg);
+    emitOperand(setOp, arg);
 
-    emitBytes(getOp, (uint8)arg);
+    emitOperand(getOp, arg);
 }
 
 void Compiler::frameStatement()
@@ -1734,7 +3318,7 @@ void Compiler::frameStatement()
     else
     {
         // frame; = frame(100);
-        emitBytes(OP_CONSTANT, makeConstant(Value::makeInt(100)));
+        emitOperand(OP_CONSTANT, makeConstant(Value::makeInt(100)));
     }
 
     consume(TOKEN_SEMICOLON, "Expect ';' after frame");
@@ -1776,7 +3360,7 @@ void Compiler::yieldStatement()
     else
     {
 
-        emitBytes(OP_CONSTANT, makeConstant(Value::makeDouble(1.0)));
+        emitOperand(OP_CONSTANT, makeConstant(Value::makeDouble(1.0)));
     }
 
     consume(TOKEN_SEMICOLON, "Expect ';' after yild");
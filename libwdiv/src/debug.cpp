@@ -14,6 +14,186 @@ void Debug::disassembleChunk(const Code &chunk, const char *name)
     }
 }
 
+// Nome do opcode (histogramas, profiler); "OP_?" se desconhecido
+const char *Debug::opcodeName(uint8 op)
+{
+    switch (op)
+    {
+    case OP_CONSTANT:
+        return "OP_CONSTANT";
+    case OP_CONSTANT_LONG:
+        return "OP_CONSTANT_LONG";
+    case OP_NIL:
+        return "OP_NIL";
+    case OP_TRUE:
+        return "OP_TRUE";
+    case OP_FALSE:
+        return "OP_FALSE";
+    case OP_POP:
+        return "OP_POP";
+    case OP_HALT:
+        return "OP_HALT";
+    case OP_NOT:
+        return "OP_NOT";
+    case OP_DUP:
+        return "OP_DUP";
+    case OP_ADD:
+        return "OP_ADD";
+    case OP_SUBTRACT:
+        return "OP_SUBTRACT";
+    case OP_MULTIPLY:
+        return "OP_MULTIPLY";
+    case OP_DIVIDE:
+        return "OP_DIVIDE";
+    case OP_NEGATE:
+        return "OP_NEGATE";
+    case OP_MODULO:
+        return "OP_MODULO";
+    case OP_BITWISE_AND:
+        return "OP_BITWISE_AND";
+    case OP_BITWISE_OR:
+        return "OP_BITWISE_OR";
+    case OP_BITWISE_XOR:
+        return "OP_BITWISE_XOR";
+    case OP_BITWISE_NOT:
+        return "OP_BITWISE_NOT";
+    case OP_SHIFT_LEFT:
+        return "OP_SHIFT_LEFT";
+    case OP_SHIFT_RIGHT:
+        return "OP_SHIFT_RIGHT";
+    case OP_EQUAL:
+        return "OP_EQUAL";
+    case OP_NOT_EQUAL:
+        return "OP_NOT_EQUAL";
+    case OP_GREATER:
+        return "OP_GREATER";
+    case OP_GREATER_EQUAL:
+        return "OP_GREATER_EQUAL";
+    case OP_LESS:
+        return "OP_LESS";
+    case OP_LESS_EQUAL:
+        return "OP_LESS_EQUAL";
+    case OP_ADD_II:
+        return "OP_ADD_II";
+    case OP_SUB_II:
+        return "OP_SUB_II";
+    case OP_MUL_II:
+        return "OP_MUL_II";
+    case OP_LT_II:
+        return "OP_LT_II";
+    case OP_LE_II:
+        return "OP_LE_II";
+    case OP_GT_II:
+        return "OP_GT_II";
+    case OP_GE_II:
+        return "OP_GE_II";
+    case OP_ADD_DD:
+        return "OP_ADD_DD";
+    case OP_SUB_DD:
+        return "OP_SUB_DD";
+    case OP_MUL_DD:
+        return "OP_MUL_DD";
+    case OP_DIV_DD:
+        return "OP_DIV_DD";
+    case OP_LT_DD:
+        return "OP_LT_DD";
+    case OP_LE_DD:
+        return "OP_LE_DD";
+    case OP_GT_DD:
+        return "OP_GT_DD";
+    case OP_GE_DD:
+        return "OP_GE_DD";
+    case OP_GET_LOCAL:
+        return "OP_GET_LOCAL";
+    case OP_SET_LOCAL:
+        return "OP_SET_LOCAL";
+    case OP_GET_GLOBAL:
+        return "OP_GET_GLOBAL";
+    case OP_SET_GLOBAL:
+        return "OP_SET_GLOBAL";
+    case OP_DEFINE_GLOBAL:
+        return "OP_DEFINE_GLOBAL";
+    case OP_GET_GLOBAL_LONG:
+        return "OP_GET_GLOBAL_LONG";
+    case OP_SET_GLOBAL_LONG:
+        return "OP_SET_GLOBAL_LONG";
+    case OP_DEFINE_GLOBAL_LONG:
+        return "OP_DEFINE_GLOBAL_LONG";
+    case OP_GET_PRIVATE:
+        return "OP_GET_PRIVATE";
+    case OP_SET_PRIVATE:
+        return "OP_SET_PRIVATE";
+    case OP_JUMP:
+        return "OP_JUMP";
+    case OP_JUMP_IF_FALSE:
+        return "OP_JUMP_IF_FALSE";
+    case OP_LOOP:
+        return "OP_LOOP";
+    case OP_JUMP_LONG:
+        return "OP_JUMP_LONG";
+    case OP_JUMP_IF_FALSE_LONG:
+        return "OP_JUMP_IF_FALSE_LONG";
+    case OP_LOOP_LONG:
+        return "OP_LOOP_LONG";
+    case OP_GOSUB:
+        return "OP_GOSUB";
+    case OP_RETURN_SUB:
+        return "OP_RETURN_SUB";
+    case OP_FOR_PREP:
+        return "OP_FOR_PREP";
+    case OP_FOR_STEP:
+        return "OP_FOR_STEP";
+    case OP_SWITCH_TABLE:
+        return "OP_SWITCH_TABLE";
+    case OP_CALL:
+        return "OP_CALL";
+    case OP_TAIL_CALL:
+        return "OP_TAIL_CALL";
+    case OP_RETURN:
+        return "OP_RETURN";
+    case OP_CALL_NATIVE:
+        return "OP_CALL_NATIVE";
+    case OP_RETURN_NIL:
+        return "OP_RETURN_NIL";
+    case OP_SPAWN:
+        return "OP_SPAWN";
+    case OP_YIELD:
+        return "OP_YIELD";
+    case OP_FRAME:
+        return "OP_FRAME";
+    case OP_EXIT:
+        return "OP_EXIT";
+    case OP_GET_PROPERTY:
+        return "OP_GET_PROPERTY";
+    case OP_SET_PROPERTY:
+        return "OP_SET_PROPERTY";
+    case OP_GET_INDEX:
+        return "OP_GET_INDEX";
+    case OP_SET_INDEX:
+        return "OP_SET_INDEX";
+    case OP_INVOKE:
+        return "OP_INVOKE";
+    case OP_GET_PROPERTY_LONG:
+        return "OP_GET_PROPERTY_LONG";
+    case OP_SET_PROPERTY_LONG:
+        return "OP_SET_PROPERTY_LONG";
+    case OP_INVOKE_LONG:
+        return "OP_INVOKE_LONG";
+    case OP_NEW_STRUCT:
+        return "OP_NEW_STRUCT";
+    case OP_GET_FIELD:
+        return "OP_GET_FIELD";
+    case OP_SET_FIELD:
+        return "OP_SET_FIELD";
+    case OP_FORMAT:
+        return "OP_FORMAT";
+    case OP_PRINT:
+        return "OP_PRINT";
+    default:
+        return "OP_?";
+    }
+}
+
 static bool hasBytes(const Code &chunk, size_t offset, size_t n)
 {
     return offset + n < chunk.count; // offset + n is last index read
@@ -23,10 +203,11 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
 {
     printf("%04zu ", offset);
 
-    if (offset > 0 && chunk.lines[offset] == chunk.lines[offset - 1])
+    int line = chunk.getLine(offset);
+    if (offset > 0 && line == chunk.getLine(offset - 1))
         printf("   | ");
     else
-        printf("%4d ", chunk.lines[offset]);
+        printf("%4d ", line);
 
     if (offset >= chunk.count)
     {
@@ -41,6 +222,8 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
     // -------- Literals --------
     case OP_CONSTANT:
         return constantInstruction("OP_CONSTANT", chunk, offset);
+    case OP_CONSTANT_LONG:
+        return constantLongInstruction("OP_CONSTANT_LONG", chunk, offset);
     case OP_NIL:
         return simpleInstruction("OP_NIL", offset);
     case OP_TRUE:
@@ -113,6 +296,38 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
     case OP_LESS_EQUAL:
         return simpleInstruction("OP_LESS_EQUAL", offset);
 
+    // -------- Typed --------
+    case OP_ADD_II:
+        return simpleInstruction("OP_ADD_II", offset);
+    case OP_SUB_II:
+        return simpleInstruction("OP_SUB_II", offset);
+    case OP_MUL_II:
+        return simpleInstruction("OP_MUL_II", offset);
+    case OP_LT_II:
+        return simpleInstruction("OP_LT_II", offset);
+    case OP_LE_II:
+        return simpleInstruction("OP_LE_II", offset);
+    case OP_GT_II:
+        return simpleInstruction("OP_GT_II", offset);
+    case OP_GE_II:
+        return simpleInstruction("OP_GE_II", offset);
+    case OP_ADD_DD:
+        return simpleInstruction("OP_ADD_DD", offset);
+    case OP_SUB_DD:
+        return simpleInstruction("OP_SUB_DD", offset);
+    case OP_MUL_DD:
+        return simpleInstruction("OP_MUL_DD", offset);
+    case OP_DIV_DD:
+        return simpleInstruction("OP_DIV_DD", offset);
+    case OP_LT_DD:
+        return simpleInstruction("OP_LT_DD", offset);
+    case OP_LE_DD:
+        return simpleInstruction("OP_LE_DD", offset);
+    case OP_GT_DD:
+        return simpleInstruction("OP_GT_DD", offset);
+    case OP_GE_DD:
+        return simpleInstruction("OP_GE_DD", offset);
+
     // -------- Variables --------
     case OP_GET_LOCAL:
         return byteInstruction("OP_GET_LOCAL", chunk, offset);
@@ -126,6 +341,12 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
         return constantNameInstruction("OP_SET_GLOBAL", chunk, offset);
     case OP_DEFINE_GLOBAL:
         return constantNameInstruction("OP_DEFINE_GLOBAL", chunk, offset);
+    case OP_GET_GLOBAL_LONG:
+        return constantLongInstruction("OP_GET_GLOBAL_LONG", chunk, offset);
+    case OP_SET_GLOBAL_LONG:
+        return constantLongInstruction("OP_SET_GLOBAL_LONG", chunk, offset);
+    case OP_DEFINE_GLOBAL_LONG:
+        return constantLongInstruction("OP_DEFINE_GLOBAL_LONG", chunk, offset);
 
     case OP_GET_PRIVATE:
         return byteInstruction("OP_GET_PRIVATE", chunk, offset);
@@ -139,10 +360,68 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
         return jumpInstruction("OP_JUMP_IF_FALSE", +1, chunk, offset);
     case OP_LOOP:
         return jumpInstruction("OP_LOOP", -1, chunk, offset);
+    case OP_JUMP_LONG:
+        return jumpLongInstruction("OP_JUMP_LONG", +1, chunk, offset);
+    case OP_JUMP_IF_FALSE_LONG:
+        return jumpLongInstruction("OP_JUMP_IF_FALSE_LONG", +1, chunk, offset);
+    case OP_LOOP_LONG:
+        return jumpLongInstruction("OP_LOOP_LONG", -1, chunk, offset);
+
+    case OP_FOR_PREP:
+    case OP_FOR_STEP:
+    {
+        // operands: slot, mode, limite, (step), offset 16 bits
+        bool step = instruction == OP_FOR_STEP;
+        size_t length = step ? 7 : 6;
+        const char *nm = step ? "OP_FOR_STEP" : "OP_FOR_PREP";
+        if (!hasBytes(chunk, offset, length - 1))
+        {
+            printf("%s <truncated>\n", nm);
+            return chunk.count;
+        }
+
+        static const char *compares[] = {"<", "<=", ">", ">="};
+        static const char *limits[] = {"const", "local", "global", "private"};
+        uint8 slot = chunk.code[offset + 1];
+        uint8 mode = chunk.code[offset + 2];
+        uint8 limit = chunk.code[offset + 3];
+        uint16 jump = (uint16)((chunk.code[offset + length - 2] << 8) | chunk.code[offset + length - 1]);
+        int sign = step ? -1 : +1;
+
+        printf("%-16s %4u %s %s %u", nm, (unsigned)slot, compares[mode & 3], limits[(mode >> 2) & 3], (unsigned)limit);
+        if (step)
+        {
+            printf(" step ");
+            printValue(chunk.constants[chunk.code[offset + 4]]);
+        }
+        printf(" -> %zu\n", offset + length + sign * jump);
+        return offset + length;
+    }
+
+    case OP_SWITCH_TABLE:
+    {
+        // operands: kind, constante, count 16 bits; seguem count+1 OP_JUMP
+        if (!hasBytes(chunk, offset, 4))
+        {
+            printf("OP_SWITCH_TABLE <truncated>\n");
+            return chunk.count;
+        }
+
+        static const char *kinds[] = {"dense", "sparse", "string"};
+        uint8 kind = chunk.code[offset + 1];
+        uint8 first = chunk.code[offset + 2];
+        uint16 count = (uint16)((chunk.code[offset + 3] << 8) | chunk.code[offset + 4]);
+
+        printf("%-16s %s %4u (%u cases + default)\n",
+               "OP_SWITCH_TABLE", kind < 3 ? kinds[kind] : "?", (unsigned)first, (unsigned)count);
+        return offset + 5;
+    }
 
     // -------- Functions --------
     case OP_CALL:
         return byteInstruction("OP_CALL", chunk, offset);
+    case OP_TAIL_CALL:
+        return byteInstruction("OP_TAIL_CALL", chunk, offset);
 
     case OP_CALL_NATIVE:
     {
@@ -182,6 +461,61 @@ size_t Debug::disassembleInstruction(const Code &chunk, size_t offset)
 
         return offset + 3;
     }
+    case OP_GET_PROPERTY_LONG:
+        return constantLongInstruction("OP_GET_PROPERTY_LONG", chunk, offset);
+    case OP_SET_PROPERTY_LONG:
+        return constantLongInstruction("OP_SET_PROPERTY_LONG", chunk, offset);
+    case OP_INVOKE_LONG:
+    {
+        if (!hasBytes(chunk, offset, 4))
+        {
+            printf("OP_INVOKE_LONG <truncated>\n");
+            return chunk.count;
+        }
+
+        uint32 nameIdx = (chunk.code[offset + 1] << 16) | (chunk.code[offset + 2] << 8) | chunk.code[offset + 3];
+        uint8_t argCount = chunk.code[offset + 4];
+
+        Value c = chunk.constants[nameIdx];
+        const char *nm = (c.isString() ? c.asString()->chars() : "<non-string>");
+
+        printf("%-16s %4u '%s' (%u args)\n",
+               "OP_INVOKE_LONG", (unsigned)nameIdx, nm, (unsigned)argCount);
+
+        return offset + 5;
+    }
+    case OP_FORMAT:
+        return byteInstruction("OP_FORMAT", chunk, offset);
+    case OP_NEW_STRUCT:
+    {
+        if (!hasBytes(chunk, offset, 3))
+        {
+            printf("OP_NEW_STRUCT <truncated>\n");
+            return chunk.count;
+        }
+
+        uint16 type = (uint16)((chunk.code[offset + 1] << 8) | chunk.code[offset + 2]);
+        uint8_t argCount = chunk.code[offset + 3];
+
+        printf("%-16s %4u (%u args)\n", "OP_NEW_STRUCT", (unsigned)type, (unsigned)argCount);
+        return offset + 4;
+    }
+    case OP_GET_FIELD:
+    case OP_SET_FIELD:
+    {
+        const char *nm = (instruction == OP_GET_FIELD) ? "OP_GET_FIELD" : "OP_SET_FIELD";
+        if (!hasBytes(chunk, offset, 3))
+        {
+            printf("%s <truncated>\n", nm);
+            return chunk.count;
+        }
+
+        uint8_t slot = chunk.code[offset + 1];
+        uint16 field = (uint16)((chunk.code[offset + 2] << 8) | chunk.code[offset + 3]);
+
+        printf("%-16s %4u slot %u\n", nm, (unsigned)field, (unsigned)slot);
+        return offset + 4;
+    }
 
     case OP_RETURN:
         return simpleInstruction("OP_RETURN", offset);
@@ -285,6 +619,36 @@ size_t Debug::jumpInstruction(const char *name, int sign, const Code &chunk, siz
     return offset + 3;
 }
 
+size_t Debug::constantLongInstruction(const char *name, const Code &chunk, size_t offset)
+{
+    if (offset + 3 >= chunk.count)
+    {
+        printf("%s <truncated>\n", name);
+        return chunk.count;
+    }
+
+    uint32 constantIdx = (chunk.code[offset + 1] << 16) | (chunk.code[offset + 2] << 8) | chunk.code[offset + 3];
+    printf("%-16s %4u '", name, (unsigned)constantIdx);
+    printValue(chunk.constants[constantIdx]);
+    printf("'\n");
+    return offset + 4;
+}
+
+size_t Debug::jumpLongInstruction(const char *name, int sign, const Code &chunk, size_t offset)
+{
+    if (offset + 3 >= chunk.count)
+    {
+        printf("%s <truncated>\n", name);
+        return chunk.count;
+    }
+
+    uint32 jump = (chunk.code[offset + 1] << 16) | (chunk.code[offset + 2] << 8) | chunk.code[offset + 3];
+    long long target = (long long)offset + 4 + (long long)sign * (long long)jump;
+
+    printf("%-16s %4zu -> %lld\n", name, offset, target);
+    return offset + 4;
+}
+
 void Debug::dumpFunction(const Function *func)
 {
     const char *name =
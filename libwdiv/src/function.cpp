@@ -12,6 +12,19 @@ Function::~Function()
         chunk->clear();
         delete chunk;
     }
+    if (baseline)
+    {
+        baseline->clear();
+        delete baseline;
+    }
+
+    // Optimizado mas nunca trocado
+    Code *pending = optimized.load();
+    if (pending && pending != chunk)
+    {
+        pending->clear();
+        delete pending;
+    }
 }
 
 Function *Interpreter::addFunction(const char *name, int arity)
@@ -25,11 +38,7 @@ Function *Interpreter::addFunction(const char *name, int arity)
         return nullptr;
     }
 
-<<<<<<< HEAD
- 
-=======
     // Function *func = (Function *)arena.Allocate(sizeof(Function));
->>>>>>> fdf5e2bc48c434b90d4163ab2d1fe87bbcdd4a33
     Function *func = new Function();
 
     func->arity = arity;
@@ -0,0 +1,448 @@
+#include "compiler.hpp"
+#include "interpreter.hpp"
+#include "code.hpp"
+#include "opcode.hpp"
+#include "optimizer.hpp"
+
+// ============================================
+// INLINING
+// ============================================
+// Copia o corpo de defs pequenos para o call site. Os parametros nao viram
+// locals: cada GET_LOCAL de um parametro e trocado pela instrucao que empilhou
+// o argumento, por isso so entram chamadas cujos argumentos sao leituras
+// simples (constante, local, global ou private). Nao ocupa slots de locals.
+//
+// Um call site inlined nao volta a ler o global: um def cujo nome e escrito
+// em qualquer ponto do script (=, +=, ++, var) nunca e inlined, mesmo que a
+// escrita venha depois da chamada. Escritas vindas do host (natives que mudam
+// globals) nao se vem aqui; quem as faz deve usar setInlining(false).
+
+void Compiler::setInlining(bool enable)
+{
+    inlining_ = enable;
+}
+
+static bool isInlineArgument(uint8 op, int length)
+{
+    if (length == 1)
+        return op == OP_TRUE || op == OP_FALSE || op == OP_NIL;
+    if (length == 2)
+        return op == OP_CONSTANT || op == OP_GET_LOCAL || op == OP_GET_GLOBAL || op == OP_GET_PRIVATE;
+    if (length == 4)
+        return op == OP_CONSTANT_LONG || op == OP_GET_GLOBAL_LONG;
+    return false;
+}
+
+// Operando 1 e um indice na pool de constantes do chunk
+static bool hasConstantOperand(uint8 op)
+{
+    switch (op)
+    {
+    case OP_CONSTANT:
+    case OP_GET_GLOBAL:
+    case OP_SET_GLOBAL:
+    case OP_GET_PROPERTY:
+    case OP_SET_PROPERTY:
+    case OP_INVOKE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Corpo pequeno, sem recursao/suspensao, so le parametros e acaba sempre
+// em OP_RETURN com exactamente um valor na pilha.
+static bool canInline(Function *func, const char *name, bool &sideEffects)
+{
+    const Code &chunk = *func->chunk;
+    int count = (int)chunk.count;
+
+    if (count == 0 || count > INLINE_MAX_BYTES)
+        return false;
+
+    sideEffects = false;
+    std::vector<bool> isStart(count + 1, false);
+
+    for (int offset = 0; offset < count;)
+    {
+        uint8 op = chunk.code[offset];
+        int length = Optimizer::instructionLength(op);
+        if (length == 0 || offset + length > count)
+            return false;
+        isStart[offset] = true;
+
+        switch (op)
+        {
+        // Suspende, mexe em processos/fibers/gosub ou cria locals
+        case OP_FRAME:
+        case OP_YIELD:
+        case OP_EXIT:
+        case OP_SPAWN:
+        case OP_GOSUB:
+        case OP_RETURN_SUB:
+        case OP_RETURN_NIL:
+        case OP_HALT:
+        case OP_DEFINE_GLOBAL:
+        case OP_SET_LOCAL:
+        case OP_GET_INDEX:
+        case OP_SET_INDEX:
+        case OP_CALL_NATIVE:
+        case OP_FOR_PREP:
+        case OP_FOR_STEP:
+        case OP_SWITCH_TABLE:
+        case OP_TAIL_CALL:
+        // Operandos de 24 bits: a pool de um def pequeno nunca passa de 256
+        case OP_CONSTANT_LONG:
+        case OP_GET_GLOBAL_LONG:
+        case OP_SET_GLOBAL_LONG:
+        case OP_DEFINE_GLOBAL_LONG:
+        case OP_GET_PROPERTY_LONG:
+        case OP_SET_PROPERTY_LONG:
+        case OP_INVOKE_LONG:
+        case OP_JUMP_LONG:
+        case OP_JUMP_IF_FALSE_LONG:
+        case OP_LOOP_LONG:
+            return false;
+
+        case OP_GET_LOCAL:
+            if (chunk.code[offset + 1] >= func->arity)
+                return false;
+            break;
+
+        case OP_GET_GLOBAL:
+        {
+            const Value &v = chunk.constants[chunk.code[offset + 1]];
+            if (v.isString() && std::strcmp(v.asStringChars(), name) == 0)
+                return false; // recursivo
+            break;
+        }
+
+        case OP_CALL:
+        case OP_INVOKE:
+        case OP_SET_GLOBAL:
+        case OP_SET_PROPERTY:
+        case OP_SET_FIELD:
+            sideEffects = true;
+            break;
+
+        default:
+            break;
+        }
+        offset += length;
+    }
+    isStart[count] = true;
+
+    // Profundidade da pilha por instrucao (relativa ao inicio do corpo)
+    std::vector<int> depthAt(count + 1, -1);
+    std::vector<int> work;
+    depthAt[0] = 0;
+    work.push_back(0);
+
+    while (!work.empty())
+    {
+        int offset = work.back();
+        work.pop_back();
+
+        if (offset == count)
+            return false; // cai do fim sem return
+
+        uint8 op = chunk.code[offset];
+        int depth = depthAt[offset];
+        int pops, pushes;
+        if (!Optimizer::stackEffect(chunk, offset, pops, pushes) || depth < pops)
+            return false;
+
+        if (op == OP_RETURN)
+        {
+            if (depth != 1)
+                return false;
+            continue;
+        }
+
+        int after = depth - pops + pushes;
+        int next = offset + Optimizer::instructionLength(op);
+        int successors[2];
+        int n = 0;
+
+        if (op == OP_JUMP || op == OP_JUMP_IF_FALSE || op == OP_LOOP)
+        {
+            uint16 jump = (uint16)((chunk.code[offset + 1] << 8) | chunk.code[offset + 2]);
+            successors[n++] = (op == OP_LOOP) ? next - jump : next + jump;
+        }
+        if (op != OP_JUMP && op != OP_LOOP)
+            successors[n++] = next;
+
+        for (int i = 0; i < n; i++)
+        {
+            int target = successors[i];
+            if (target < 0 || target > count || !isStart[target])
+                return false;
+
+            if (depthAt[target] == -1)
+            {
+                depthAt[target] = after;
+                work.push_back(target);
+            }
+            else if (depthAt[target] != after)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Os tokens ja estao todos lidos antes de compilar: basta uma passagem para
+// saber que nomes sao alvo de escrita (locals com o mesmo nome tambem contam)
+void Compiler::collectStoredNames()
+{
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        if (tokens[i].type != TOKEN_IDENTIFIER)
+            continue;
+
+        TokenType before = i > 0 ? tokens[i - 1].type : TOKEN_EOF;
+        TokenType after = i + 1 < tokens.size() ? tokens[i + 1].type : TOKEN_EOF;
+        if (before == TOKEN_DOT)
+            continue; // campo ou propriedade, nao o global
+
+        bool stored = before == TOKEN_VAR || before == TOKEN_PLUS_PLUS || before == TOKEN_MINUS_MINUS;
+        switch (after)
+        {
+        case TOKEN_EQUAL:
+        case TOKEN_PLUS_EQUAL:
+        case TOKEN_MINUS_EQUAL:
+        case TOKEN_STAR_EQUAL:
+        case TOKEN_SLASH_EQUAL:
+        case TOKEN_PERCENT_EQUAL:
+        case TOKEN_PLUS_PLUS:
+        case TOKEN_MINUS_MINUS:
+            stored = true;
+            break;
+        default:
+            break;
+        }
+
+        if (stored)
+            storedNames_.insert(tokens[i].lexeme);
+    }
+}
+
+void Compiler::registerInline(Token &name, Function *func)
+{
+    forgetInline(name.lexeme);
+    if (storedNames_.count(name.lexeme))
+        return;
+
+    bool sideEffects;
+    if (!canInline(func, name.lexeme.c_str(), sideEffects))
+        return;
+
+    InlineFunction entry;
+    entry.name = name.lexeme;
+    entry.func = func;
+    entry.sideEffects = sideEffects;
+    inlineFunctions_.push_back(entry);
+}
+
+void Compiler::forgetInline(const std::string &name)
+{
+    for (size_t i = 0; i < inlineFunctions_.size(); i++)
+    {
+        if (inlineFunctions_[i].name == name)
+        {
+            inlineFunctions_.erase(inlineFunctions_.begin() + i);
+            return;
+        }
+    }
+}
+
+struct InlineArgument
+{
+    uint8 bytes[4];
+    int length;
+    int line;
+    bool evaluate; // ler e descartar antes do corpo
+};
+
+bool Compiler::tryInline(int calleeStart, const std::vector<int> &argStarts)
+{
+    if (!inlining_ || hadError || calleeStart < foldBarrier_)
+        return false;
+
+    Code *chunk = currentChunk;
+    uint32 calleeName;
+    if (chunk->code[calleeStart] == OP_GET_GLOBAL)
+        calleeName = chunk->code[calleeStart + 1];
+    else if (chunk->code[calleeStart] == OP_GET_GLOBAL_LONG)
+        calleeName = (chunk->code[calleeStart + 1] << 16) | (chunk->code[calleeStart + 2] << 8) | chunk->code[calleeStart + 3];
+    else
+        return false;
+
+    const Value &callee = chunk->constants[calleeName];
+    if (!callee.isString())
+        return false;
+
+    const InlineFunction *target = nullptr;
+    for (size_t i = 0; i < inlineFunctions_.size(); i++)
+    {
+        if (inlineFunctions_[i].name == callee.asStringChars())
+        {
+            target = &inlineFunctions_[i];
+            break;
+        }
+    }
+
+    if (!target || target->func->arity != (int)argStarts.size())
+        return false;
+
+    // Argumentos: uma leitura simples cada
+    std::vector<InlineArgument> args(argStarts.size());
+    for (size_t i = 0; i < argStarts.size(); i++)
+    {
+        int start = argStarts[i];
+        int end = (i + 1 < argStarts.size()) ? argStarts[i + 1] : (int)chunk->count;
+        uint8 op = chunk->code[start];
+
+        if (!isInlineArgument(op, end - start))
+            return false;
+
+        bool global = op == OP_GET_GLOBAL || op == OP_GET_GLOBAL_LONG;
+
+        // Com efeitos no corpo, globals/privates tem de ser lidos antes da chamada
+        if (target->sideEffects && (global || op == OP_GET_PRIVATE))
+            return false;
+
+        args[i].length = end - start;
+        for (int k = 0; k < args[i].length; k++)
+            args[i].bytes[k] = chunk->code[start + k];
+        args[i].line = chunk->getLine(start);
+        args[i].evaluate = global;
+    }
+
+    const Code &body = *target->func->chunk;
+    int bodyCount = (int)body.count;
+
+    // Parametros lidos antes do primeiro salto/return sao lidos sempre; os
+    // outros argumentos globais sao lidos e descartados a entrada, para o
+    // "Undefined variable" continuar a aparecer
+    for (int offset = 0; offset < bodyCount;)
+    {
+        uint8 op = body.code[offset];
+        if (op == OP_JUMP || op == OP_JUMP_IF_FALSE || op == OP_LOOP || op == OP_RETURN)
+            break;
+        if (op == OP_GET_LOCAL)
+            args[body.code[offset + 1]].evaluate = false;
+        offset += Optimizer::instructionLength(op);
+    }
+
+    // Indices na pool do caller (acima de 255 o opcode passa a _LONG)
+    int remap[UINT8_MAX + 1];
+    for (int i = 0; i <= UINT8_MAX; i++)
+        remap[i] = -1;
+
+    // Offsets no codigo inlined; OP_RETURN final desaparece, os outros viram OP_JUMP
+    std::vector<int> newAt(bodyCount + 1, 0);
+    int size = 0;
+
+    for (int offset = 0; offset < bodyCount;)
+    {
+        uint8 op = body.code[offset];
+        int length = Optimizer::instructionLength(op);
+        newAt[offset] = size;
+
+        if (op == OP_GET_LOCAL)
+            size += args[body.code[offset + 1]].length;
+        else if (op == OP_RETURN)
+            size += (offset + length == bodyCount) ? 0 : 3;
+        else
+            size += length;
+
+        if (hasConstantOperand(op))
+        {
+            uint8 index = body.code[offset + 1];
+            if (remap[index] == -1)
+                remap[index] = chunk->addConstant(body.constants[index]);
+            if (remap[index] > UINT8_MAX)
+                size += 2;
+        }
+        offset += length;
+    }
+    newAt[bodyCount] = size;
+
+    // Descarta GET_GLOBAL do callee + argumentos e copia o corpo
+    chunk->truncate(calleeStart);
+    foldCount_ = 0;
+
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        if (!args[i].evaluate)
+            continue;
+        for (int k = 0; k < args[i].length; k++)
+            chunk->write(args[i].bytes[k], args[i].line);
+        chunk->write(OP_POP, args[i].line);
+    }
+
+    for (int offset = 0; offset < bodyCount;)
+    {
+        uint8 op = body.code[offset];
+        int length = Optimizer::instructionLength(op);
+        int line = body.getLine(offset);
+
+        switch (op)
+        {
+        case OP_GET_LOCAL:
+        {
+            const InlineArgument &arg = args[body.code[offset + 1]];
+            for (int k = 0; k < arg.length; k++)
+                chunk->write(arg.bytes[k], arg.line);
+            break;
+        }
+
+        case OP_RETURN:
+        {
+            if (offset + length == bodyCount)
+                break;
+            int jump = size - (newAt[offset] + 3);
+            chunk->write(OP_JUMP, line);
+            chunk->writeShort((uint16)jump, line);
+            break;
+        }
+
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_LOOP:
+        {
+            uint16 old = (uint16)((body.code[offset + 1] << 8) | body.code[offset + 2]);
+            int from = offset + 3;
+            int to = (op == OP_LOOP) ? from - old : from + old;
+            int jump = (op == OP_LOOP) ? (newAt[offset] + 3) - newAt[to] : newAt[to] - (newAt[offset] + 3);
+            chunk->write(op, line);
+            chunk->writeShort((uint16)jump, line);
+            break;
+        }
+
+        default:
+        {
+            int k = 1;
+            if (hasConstantOperand(op))
+            {
+                emitOperand(op, remap[body.code[offset + 1]], line);
+                k = 2;
+            }
+            else
+            {
+                chunk->write(op, line);
+            }
+            for (; k < length; k++)
+                chunk->write(body.code[offset + k], line);
+            break;
+        }
+        }
+        offset += length;
+    }
+
+    // Saltos internos do corpo aterram aqui dentro
+    foldBarrier_ = (int)chunk->count;
+    return true;
+}
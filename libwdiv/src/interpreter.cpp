@@ -3,13 +3,31 @@
 #include "pool.hpp"
 #include "opcode.hpp"
 #include "debug.hpp"
+#include "tiering.hpp"
+#include "numconv.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
 #include <new>
 #include <stdarg.h>
 #include <cmath> // std::fmod
+#include <climits>
+#include <algorithm>
+#include <vector>
 
 #define DEBUG_TRACE_EXECUTION 0 // 1 = ativa, 0 = desativa
 #define DEBUG_TRACE_STACK 0     // 1 = mostra stack, 0 = esconde
 
+// Contadores do dispatch. WDIV_COUNT_INSTRUCTIONS: instrucoes, e o profiler
+// amostra por instrucao (a lib do wdiv_bench liga-o sempre). Sem ele o
+// profiler conta so backedges e calls (PROFILE_TICK). WDIV_PROFILE_OPCODES
+// (cmake -DWDIV_PROFILE_OPCODES=ON) conta tambem o histograma de opcodes.
+#ifndef WDIV_PROFILE_OPCODES
+#define WDIV_PROFILE_OPCODES 0
+#endif
+#ifndef WDIV_COUNT_INSTRUCTIONS
+#define WDIV_COUNT_INSTRUCTIONS WDIV_PROFILE_OPCODES
+#endif
+
 #ifdef NDEBUG
 #define WDIV_ASSERT(condition, ...) ((void)0)
 #else
@@ -28,10 +46,18 @@ Interpreter::Interpreter()
 {
     compiler = new Compiler(this);
     setPrivateTable();
+#if WDIV_PROFILE_OPCODES
+    opcodeProfile_ = (OpcodeProfile *)aAlloc(sizeof(OpcodeProfile));
+    std::memset(opcodeProfile_, 0, sizeof(OpcodeProfile));
+#endif
 }
 
 Interpreter::~Interpreter()
 {
+    aFree(opcodeProfile_);
+    delete profiler_;
+    delete tracer_;
+    delete tierCompiler_; // antes dos Functions: a thread ainda os pode referir
     delete compiler;
     for (size_t i = 0; i < functions.size(); i++)
     {
@@ -49,7 +75,13 @@ Interpreter::~Interpreter()
     const bool showStats = false;
 
     processes.clear();
-    ProcessPool::instance().clear();
+
+    // Instancias vivem no arena (sai com o Interpreter)
+    for (size_t i = 0; i < structs.size(); i++)
+    {
+        delete structs[i];
+    }
+    structs.clear();
 
     if (showStats)
         arena.Stats();
@@ -71,6 +103,9 @@ Interpreter::~Interpreter()
 
     aliveProcesses.clear();
 
+    // Depois dos vivos: as pilhas deles tambem voltaram ao pool
+    ProcessPool::instance().clear();
+
     for (size_t i = 0; i < natives.size(); i++)
     {
         NativeDef &native = natives[i];
@@ -248,6 +283,191 @@ float Interpreter::getCurrentTime() const
     return currentTime;
 }
 
+bool Interpreter::isInstructionCountEnabled() const
+{
+    return WDIV_COUNT_INSTRUCTIONS != 0;
+}
+
+uint64_t Interpreter::getInstructionCount() const
+{
+    return instructionsExecuted_;
+}
+
+// ============================================
+// PROFILER POR AMOSTRAGEM
+// ============================================
+
+// Sem contador de instrucoes cada backedge ou call vale ~isto em instrucoes
+static const uint32 PROFILE_TICK_INSTRUCTIONS = 8;
+
+void Interpreter::startProfiler(uint32 interval)
+{
+    if (!profiler_)
+    {
+#if !WDIV_COUNT_INSTRUCTIONS
+        interval = interval > PROFILE_TICK_INSTRUCTIONS ? interval / PROFILE_TICK_INSTRUCTIONS : 1;
+#endif
+        profiler_ = new Profiler(interval);
+    }
+    profiling_ = true;
+    sampleCountdown_ = profiler_->nextInterval();
+}
+
+void Interpreter::stopProfiler()
+{
+    profiling_ = false;
+    sampleCountdown_ = UINT64_MAX;
+}
+
+Profiler *Interpreter::getProfiler()
+{
+    return profiler_;
+}
+
+// Chamado pelo dispatch quando a contagem (instrucoes, ou ticks de
+// PROFILE_TICK) chega a sampleCountdown_
+uint32 Interpreter::takeSample(Fiber *fiber, const uint8 *ip)
+{
+    if (!profiling_) // stopProfiler a meio da fatia
+        return UINT32_MAX;
+    profiler_->sample(currentProcess, fiber, ip);
+    uint32 next = profiler_->nextInterval();
+    sampleCountdown_ += next;
+    return next;
+}
+
+// ============================================
+// TRACER
+// ============================================
+
+void Interpreter::startTrace(size_t capacity)
+{
+    if (!tracer_ || tracer_->capacity() != capacity)
+    {
+        delete tracer_;
+        tracer_ = new Tracer(capacity);
+    }
+    tracing_ = true;
+}
+
+void Interpreter::stopTrace()
+{
+    tracing_ = false;
+}
+
+Tracer *Interpreter::getTracer()
+{
+    return tracer_;
+}
+
+Value Interpreter::callNativeTraced(const NativeDef &native, int argCount, Value *args)
+{
+    uint64_t start = Tracer::now();
+    Value result = native.func(this, argCount, args);
+    uint64_t end = Tracer::now();
+    if (end - start >= tracer_->nativeThresholdNs())
+        tracer_->complete(TRACE_NATIVE, native.name->chars(), start, end);
+    return result;
+}
+
+// ============================================
+// HISTOGRAMA DE OPCODES (WDIV_PROFILE_OPCODES)
+// ============================================
+
+bool Interpreter::isOpcodeProfileEnabled() const
+{
+    return opcodeProfile_ != nullptr;
+}
+
+void Interpreter::resetOpcodeProfile()
+{
+    if (opcodeProfile_)
+        std::memset(opcodeProfile_, 0, sizeof(OpcodeProfile));
+    for (size_t i = 0; i < functions.size(); i++)
+        functions[i]->profiledInstructions = 0;
+}
+
+struct ProfileRow
+{
+    uint64_t count;
+    uint32 key;
+};
+
+static bool byCount(const ProfileRow &a, const ProfileRow &b)
+{
+    return a.count != b.count ? a.count > b.count : a.key < b.key;
+}
+
+static void printProfileRow(FILE *out, uint64_t count, uint64_t total)
+{
+    double percent = total ? 100.0 * (double)count / (double)total : 0.0;
+    fprintf(out, "%14llu %6.2f%%  ", (unsigned long long)count, percent);
+}
+
+void Interpreter::dumpOpcodeProfile(FILE *out, int maxRows)
+{
+    if (!opcodeProfile_)
+    {
+        fprintf(out, "opcode profile: libwdiv built without WDIV_PROFILE_OPCODES\n");
+        return;
+    }
+
+    std::vector<ProfileRow> rows;
+    uint64_t total = 0;
+    for (uint32 op = 0; op < 256; op++)
+    {
+        uint64_t count = opcodeProfile_->opcodes[op];
+        total += count;
+        if (count)
+            rows.push_back({count, op});
+    }
+    std::sort(rows.begin(), rows.end(), byCount);
+
+    size_t limit = maxRows > 0 ? (size_t)maxRows : rows.size();
+    fprintf(out, "== opcodes (%llu instructions) ==\n", (unsigned long long)total);
+    for (size_t i = 0; i < rows.size() && i < limit; i++)
+    {
+        printProfileRow(out, rows[i].count, total);
+        fprintf(out, "%s\n", Debug::opcodeName((uint8)rows[i].key));
+    }
+
+    // Pares: candidatos a superinstrucoes
+    rows.clear();
+    uint64_t pairTotal = 0;
+    for (uint32 pair = 0; pair < 256 * 256; pair++)
+    {
+        uint64_t count = opcodeProfile_->pairs[pair];
+        pairTotal += count;
+        if (count)
+            rows.push_back({count, pair});
+    }
+    std::sort(rows.begin(), rows.end(), byCount);
+
+    fprintf(out, "== opcode pairs (%llu) ==\n", (unsigned long long)pairTotal);
+    for (size_t i = 0; i < rows.size() && i < limit; i++)
+    {
+        printProfileRow(out, rows[i].count, pairTotal);
+        fprintf(out, "%s -> %s\n", Debug::opcodeName((uint8)(rows[i].key >> 8)),
+                Debug::opcodeName((uint8)(rows[i].key & 0xFF)));
+    }
+
+    rows.clear();
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+        if (functions[i]->profiledInstructions)
+            rows.push_back({functions[i]->profiledInstructions, (uint32)i});
+    }
+    std::sort(rows.begin(), rows.end(), byCount);
+
+    fprintf(out, "== functions ==\n");
+    for (size_t i = 0; i < rows.size() && i < limit; i++)
+    {
+        Function *func = functions[rows[i].key];
+        printProfileRow(out, rows[i].count, total);
+        fprintf(out, "%s\n", func->name ? func->name->chars() : "<anonymous>");
+    }
+}
+
 void Interpreter::runtimeError(const char *format, ...)
 {
     hasFatalError_ = true;
@@ -318,6 +538,11 @@ Function *Interpreter::compileExpression(const char *source)
     return mainFunc;
 }
 
+void Interpreter::setInlining(bool enable)
+{
+    compiler->setInlining(enable);
+}
+
 bool Interpreter::run(const char *source, bool _dump)
 {
     hasFatalError_ = false;
@@ -358,6 +583,8 @@ void Interpreter::setHooks(const VMHooks &h)
 
 void Interpreter::initFiber(Fiber *fiber, Function *func)
 {
+    ProcessPool::instance().attachStack(fiber);
+
     fiber->state = FiberState::RUNNING;
     fiber->resumeTime = 0.0f;
 
@@ -396,6 +623,44 @@ bool toNumberPair(const Value &a, const Value &b, double &da, double &db)
     return true;
 }
 
+// "42".to_int() / " 2.5 ".to_float(): espacos nas pontas sao ignorados,
+// qualquer outro resto (ou nada para ler) da nil
+static Value parseNumberText(String *text, bool integer)
+{
+    const char *first = text->chars();
+    const char *last = first + text->length();
+    while (first < last && isspace((unsigned char)*first))
+        first++;
+    while (last > first && isspace((unsigned char)last[-1]))
+        last--;
+
+    const char *end;
+    Value result;
+    if (integer)
+    {
+        long value;
+        end = parseLong(first, last, value);
+        result = Value::makeInt(value);
+    }
+    else
+    {
+        double value;
+        end = parseDouble(first, last, value);
+        result = Value::makeDouble(value);
+    }
+    return (end == last) ? result : Value::makeNil();
+}
+
+// (2.7).to_int(): trunca; NaN, inf ou fora do alcance de long da nil
+static Value truncateToInt(double value)
+{
+    // LONG_MIN e potencia de 2, exacta em double; LONG_MAX arredonda para cima
+    const double lowest = (double)LONG_MIN;
+    if (!(value >= lowest && value < -lowest))
+        return Value::makeNil();
+    return Value::makeInt((long)value);
+}
+
 // ===== STACK API =====
 
 const Value &Interpreter::peek(int index)
@@ -582,7 +847,8 @@ bool Interpreter::toBool(int index)
     return isTruthy(v);
 }
 
-FiberResult Interpreter::run_fiber(Fiber *fiber)
+template <bool Checked>
+FiberResult Interpreter::dispatch(Fiber *fiber)
 {
 
     currentFiber = fiber;
@@ -592,14 +858,29 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
     uint8 *ip;
     Function *func;
 
-    int instructionsRun = 0;
+    uint64_t instructionsRun = 0;
+#if WDIV_COUNT_INSTRUCTIONS
+    uint64_t sampleAt = sampleCountdown_;
+#endif
+#if WDIV_PROFILE_OPCODES
+    uint32 previousOpcode = 256; // nenhum: o primeiro da fatia nao forma par
+#endif
 
 #define DROP() (fiber->stackTop--)
 #define PEEK() (*(fiber->stackTop - 1))
 #define PEEK2() (*(fiber->stackTop - 2))
 
 #define POP() (*(--fiber->stackTop))
-#define PUSH(value) (*fiber->stackTop++ = value)
+#define PUSH(value)                                                        \
+    do                                                                     \
+    {                                                                      \
+        if (Checked && fiber->stackTop >= fiber->stack + STACK_MAX)        \
+        {                                                                  \
+            runtimeError("Stack overflow");                                \
+            return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};       \
+        }                                                                  \
+        *fiber->stackTop++ = value;                                        \
+    } while (false)
 #define NPEEK(n) (fiber->stackTop[-1 - (n)])
 
     // if (frame->ip == nullptr)
@@ -610,6 +891,7 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
 
 #define READ_BYTE() (*ip++)
 #define READ_SHORT() (ip += 2, (uint16)((ip[-2] << 8) | ip[-1]))
+#define READ_LONG() (ip += 3, (uint32)((ip[-3] << 16) | (ip[-2] << 8) | ip[-1]))
 
 #define BINARY_OP_PREP()           \
     Value b = fiber->stackTop[-1]; \
@@ -629,6 +911,38 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
     } while (false)
 
 #define READ_CONSTANT() (func->chunk->constants[READ_BYTE()])
+#define READ_CONSTANT_LONG() (func->chunk->constants[READ_LONG()])
+// Nome de global/propriedade: operando de 8 bits, ou 24 bits nas versoes _LONG
+#define READ_NAME(shortOp) (instruction == (shortOp) ? READ_CONSTANT() : READ_CONSTANT_LONG())
+
+// Backedges e calls: o profiler sem WDIV_COUNT_INSTRUCTIONS desconta aqui
+// (sampleCountdown_ fica em UINT64_MAX quando esta parado)
+#if WDIV_COUNT_INSTRUCTIONS
+#define PROFILE_TICK() ((void)0)
+#else
+#define PROFILE_TICK()                  \
+    do                                  \
+    {                                   \
+        if (--sampleCountdown_ == 0)    \
+            takeSample(fiber, ip - 1);  \
+    } while (false)
+#endif
+
+// Frame novo (ou de volta a um) sem verificacao: o resto da fatia segue
+// em dispatch<true>, que nunca volta atras
+#define ENTER_CHECKED()                                     \
+    do                                                      \
+    {                                                       \
+        if (!Checked && func->maxStack < 0)                 \
+        {                                                   \
+            sampleCountdown_ -= instructionsRun;            \
+            FiberResult result = dispatch<true>(fiber);     \
+            sampleCountdown_ += instructionsRun;            \
+            result.instructionsRun += instructionsRun;      \
+            return result;                                  \
+        }                                                   \
+    } while (false)
+
     LOAD_FRAME();
 
     // printf("[DEBUG] Starting run_fiber: ip=%p, func=%s, offset=%ld\n",
@@ -659,6 +973,19 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
 
         uint8 instruction = READ_BYTE();
 
+#if WDIV_COUNT_INSTRUCTIONS
+        instructionsRun++;
+        if (instructionsRun == sampleAt)
+            sampleAt += takeSample(fiber, ip - 1);
+#endif
+#if WDIV_PROFILE_OPCODES
+        opcodeProfile_->opcodes[instruction]++;
+        if (previousOpcode < 256)
+            opcodeProfile_->pairs[previousOpcode * 256 + instruction]++;
+        previousOpcode = instruction;
+        func->profiledInstructions++;
+#endif
+
         switch (instruction)
         {
             // ========== CONSTANTS ==========
@@ -670,6 +997,13 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
             break;
         }
 
+        case OP_CONSTANT_LONG:
+        {
+            Value constant = READ_CONSTANT_LONG();
+            PUSH(constant);
+            break;
+        }
+
         case OP_NIL:
             PUSH(Value::makeNil());
             break;
@@ -698,6 +1032,11 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
         case OP_GET_LOCAL:
         {
             uint8 slot = READ_BYTE();
+            if (Checked && stackStart + slot >= fiber->stackTop)
+            {
+                runtimeError("Invalid local slot %d", slot);
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+            }
             PUSH(stackStart[slot]);
             break;
         }
@@ -705,6 +1044,11 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
         case OP_SET_LOCAL:
         {
             uint8 slot = READ_BYTE();
+            if (Checked && stackStart + slot >= fiber->stackTop)
+            {
+                runtimeError("Invalid local slot %d", slot);
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+            }
             stackStart[slot] = PEEK();
             break;
         }
@@ -724,9 +1068,10 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
         }
 
         case OP_GET_GLOBAL:
+        case OP_GET_GLOBAL_LONG:
         {
 
-            Value name = READ_CONSTANT();
+            Value name = READ_NAME(OP_GET_GLOBAL);
             Value value;
 
             if (!globals.get(name.asString(), &value))
@@ -739,17 +1084,19 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
         }
 
         case OP_SET_GLOBAL:
+        case OP_SET_GLOBAL_LONG:
         {
 
-            Value name = READ_CONSTANT();
+            Value name = READ_NAME(OP_SET_GLOBAL);
             globals.set(name.asString(), PEEK());
             break;
         }
 
         case OP_DEFINE_GLOBAL:
+        case OP_DEFINE_GLOBAL_LONG:
         {
 
-            Value name = READ_CONSTANT();
+            Value name = READ_NAME(OP_DEFINE_GLOBAL);
             globals.set(name.asString(), POP());
             break;
         }
@@ -997,6 +1344,85 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
             break;
         }
 
+            // ======= TYPED (Optimizer::specialize) =====
+            // Os tipos dos operandos foram provados pelo compilador: mexe
+            // directamente no slot de baixo, sem testar tags
+
+#define TYPED_ARITH(field, op)                                     \
+    {                                                              \
+        Value *top = fiber->stackTop;                              \
+        top[-2].as.field = top[-2].as.field op top[-1].as.field;   \
+        fiber->stackTop--;                                         \
+        break;                                                     \
+    }
+
+#define TYPED_COMPARE(field, op)                                   \
+    {                                                              \
+        Value *top = fiber->stackTop;                              \
+        bool result = top[-2].as.field op top[-1].as.field;        \
+        top[-2].type = ValueType::BOOL;                            \
+        top[-2].as.boolean = result;                               \
+        fiber->stackTop--;                                         \
+        break;                                                     \
+    }
+#define TYPED_COMPARE_NOT(field, op)                               \
+    {                                                              \
+        Value *top = fiber->stackTop;                              \
+        bool result = !(top[-2].as.field op top[-1].as.field);     \
+        top[-2].type = ValueType::BOOL;                            \
+        top[-2].as.boolean = result;                               \
+        fiber->stackTop--;                                         \
+        break;                                                     \
+    }
+
+        case OP_ADD_II:
+            TYPED_ARITH(integer, +)
+        case OP_SUB_II:
+            TYPED_ARITH(integer, -)
+        case OP_MUL_II:
+            TYPED_ARITH(integer, *)
+        case OP_LT_II:
+            TYPED_COMPARE(integer, <)
+        case OP_LE_II:
+            TYPED_COMPARE(integer, <=)
+        case OP_GT_II:
+            TYPED_COMPARE(integer, >)
+        case OP_GE_II:
+            TYPED_COMPARE(integer, >=)
+
+        case OP_ADD_DD:
+            TYPED_ARITH(number, +)
+        case OP_SUB_DD:
+            TYPED_ARITH(number, -)
+        case OP_MUL_DD:
+            TYPED_ARITH(number, *)
+        case OP_LT_DD:
+            TYPED_COMPARE(number, <)
+        // Vem de GREATER_DD + NOT: !(a > b), para NaN dar o mesmo
+        case OP_LE_DD:
+            TYPED_COMPARE_NOT(number, >)
+        case OP_GT_DD:
+            TYPED_COMPARE(number, >)
+        case OP_GE_DD:
+            TYPED_COMPARE_NOT(number, <)
+
+        case OP_DIV_DD:
+        {
+            Value *top = fiber->stackTop;
+            if (top[-1].as.number == 0.0)
+            {
+                runtimeError("Division by zero");
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+            }
+            top[-2].as.number = top[-2].as.number / top[-1].as.number;
+            fiber->stackTop--;
+            break;
+        }
+
+#undef TYPED_ARITH
+#undef TYPED_COMPARE
+#undef TYPED_COMPARE_NOT
+
             // ======= BITWISE =====
 
         case OP_BITWISE_AND:
@@ -1091,19 +1517,235 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
         case OP_LOOP:
         {
             uint16 offset = READ_SHORT();
+            PROFILE_TICK();
 
             ip -= offset;
 
+            if (func->tier == TIER_BASELINE && ++func->hotness >= TIER_HOT_THRESHOLD)
+                tierUp(func);
+            break;
+        }
+
+        case OP_JUMP_LONG:
+        {
+            uint32 offset = READ_LONG();
+            ip += offset;
+            break;
+        }
+
+        case OP_JUMP_IF_FALSE_LONG:
+        {
+            uint32 offset = READ_LONG();
+            if (isFalsey(PEEK()))
+                ip += offset;
+            break;
+        }
+
+        case OP_LOOP_LONG:
+        {
+            uint32 offset = READ_LONG();
+            PROFILE_TICK();
+            ip -= offset;
+
+            if (func->tier == TIER_BASELINE && ++func->hotness >= TIER_HOT_THRESHOLD)
+                tierUp(func);
+            break;
+        }
+
+        // for numerico: compara (e em FOR_STEP soma o step) sem passar pela pilha
+        case OP_FOR_PREP:
+        case OP_FOR_STEP:
+        {
+            uint8 op = ip[-1];
+            uint8 slot = READ_BYTE();
+            uint8 mode = READ_BYTE();
+            uint8 limitArg = READ_BYTE();
+            Value &counter = stackStart[slot];
+
+            if (op == OP_FOR_STEP)
+            {
+                Value step = READ_CONSTANT();
+                if (counter.isInt() && step.isInt())
+                {
+                    counter = Value::makeInt(counter.asInt() + step.asInt());
+                }
+                else
+                {
+                    double da, db;
+                    if (!toNumberPair(counter, step, da, db))
+                    {
+                        runtimeError("Operands must be numbers or strings");
+                        return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                    }
+                    counter = Value::makeDouble(da + db);
+                }
+            }
+
+            uint16 offset = READ_SHORT();
+
+            Value limit;
+            switch (mode >> 2)
+            {
+            case FOR_LIMIT_CONSTANT:
+                limit = func->chunk->constants[limitArg];
+                break;
+            case FOR_LIMIT_LOCAL:
+                limit = stackStart[limitArg];
+                break;
+            case FOR_LIMIT_PRIVATE:
+                limit = currentProcess->privates[limitArg];
+                break;
+            default:
+            {
+                Value name = func->chunk->constants[limitArg];
+                if (!globals.get(name.asString(), &limit))
+                {
+                    runtimeError("Undefined variable '%s'", name.asString()->chars());
+                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                }
+                break;
+            }
+            }
+
+            bool loop;
+            if (counter.isInt() && limit.isInt())
+            {
+                long a = counter.asInt();
+                long b = limit.asInt();
+                switch (mode & 3)
+                {
+                case FOR_LESS:
+                    loop = a < b;
+                    break;
+                case FOR_LESS_EQUAL:
+                    loop = a <= b;
+                    break;
+                case FOR_GREATER:
+                    loop = a > b;
+                    break;
+                default:
+                    loop = a >= b;
+                    break;
+                }
+            }
+            else
+            {
+                double da, db;
+                if (!toNumberPair(counter, limit, da, db))
+                {
+                    runtimeError("Operands must be numbers");
+                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                }
+                switch (mode & 3)
+                {
+                case FOR_LESS:
+                    loop = da < db;
+                    break;
+                case FOR_LESS_EQUAL:
+                    loop = da <= db;
+                    break;
+                case FOR_GREATER:
+                    loop = da > db;
+                    break;
+                default:
+                    loop = da >= db;
+                    break;
+                }
+            }
+
+            if (op == OP_FOR_PREP)
+            {
+                if (!loop)
+                    ip += offset;
+            }
+            else if (loop)
+            {
+                PROFILE_TICK();
+                ip -= offset;
+                if (func->tier == TIER_BASELINE && ++func->hotness >= TIER_HOT_THRESHOLD)
+                    tierUp(func);
+            }
+            break;
+        }
+
+        case OP_SWITCH_TABLE:
+        {
+            uint8 kind = READ_BYTE();
+            uint8 first = READ_BYTE();
+            uint16 count = READ_SHORT();
+            Value value = POP();
+            const Value *keys = &func->chunk->constants[first];
+            int index = count; // default
+
+            if (kind == SWITCH_DENSE)
+            {
+                if (value.isInt())
+                {
+                    long delta = value.asInt() - keys[0].asInt();
+                    if (delta >= 0 && delta < count)
+                        index = (int)delta;
+                }
+            }
+            else if (kind == SWITCH_SPARSE)
+            {
+                if (value.isInt())
+                {
+                    long key = value.asInt();
+                    int lo = 0, hi = count - 1;
+                    while (lo <= hi)
+                    {
+                        int mid = (lo + hi) / 2;
+                        long k = keys[mid].asInt();
+                        if (k == key)
+                        {
+                            index = mid;
+                            break;
+                        }
+                        if (k < key)
+                            lo = mid + 1;
+                        else
+                            hi = mid - 1;
+                    }
+                }
+            }
+            else if (value.isString())
+            {
+                // Pesquisa pelo hash, confirma pelo conteudo
+                String *key = value.asString();
+                size_t keyHash = key->hashCode();
+                int lo = 0, hi = count;
+                while (lo < hi)
+                {
+                    int mid = (lo + hi) / 2;
+                    if (keys[mid].asString()->hashCode() < keyHash)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                for (; lo < count && keys[lo].asString()->hashCode() == keyHash; lo++)
+                {
+                    if (StringEq()(keys[lo].asString(), key))
+                    {
+                        index = lo;
+                        break;
+                    }
+                }
+            }
+
+            // Cada entrada e um OP_JUMP (ou OP_LOOP) de 3 bytes
+            ip += index * 3;
             break;
         }
 
             // ========== FUNCTIONS ==========
 
         case OP_CALL:
+        case OP_TAIL_CALL:
         {
             uint8 argCount = READ_BYTE();
 
             STORE_FRAME();
+            PROFILE_TICK();
 
             Value callee = NPEEK(argCount);
 
@@ -1128,16 +1770,51 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                     return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
                 }
 
-                if (fiber->frameCount >= FRAMES_MAX)
+                // Entrada da funcao: ponto seguro para trocar o chunk
+                if (func->tier != TIER_OPTIMIZED)
+                {
+                    if (func->tier == TIER_QUEUED)
+                        promote(func);
+                    else if (++func->hotness >= TIER_HOT_THRESHOLD)
+                        tierUp(func);
+                }
+
+                // Codigo verificado: uma so comparacao cobre todos os PUSH do frame
+                Value *slots = (instruction == OP_TAIL_CALL && fiber->frameCount > 1) ? frame->slots : fiber->stackTop - argCount;
+                if (func->maxStack >= 0 && slots + func->maxStack > fiber->stack + STACK_MAX)
                 {
                     runtimeError("Stack overflow");
                     return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
                 }
 
-                CallFrame *newFrame = &fiber->frames[fiber->frameCount++];
-                newFrame->func = func;
-                newFrame->ip = func->chunk->code;
-                newFrame->slots = fiber->stackTop - argCount; // Argumentos começam aqui
+                // return f(...): callee + argumentos descem para o lugar do
+                // callee actual e o frame e reaproveitado. O frame base da
+                // fiber nao tem callee por baixo, esse segue como OP_CALL.
+                if (instruction == OP_TAIL_CALL && fiber->frameCount > 1)
+                {
+                    Value *dest = frame->slots - 1;
+                    Value *src = fiber->stackTop - argCount - 1;
+                    for (int i = 0; i <= argCount; i++)
+                        dest[i] = src[i];
+
+                    fiber->stackTop = dest + argCount + 1;
+                    frame->func = func;
+                    frame->ip = func->chunk->code;
+                    frame->slots = dest + 1;
+                }
+                else
+                {
+                    if (fiber->frameCount >= FRAMES_MAX)
+                    {
+                        runtimeError("Stack overflow");
+                        return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                    }
+
+                    CallFrame *newFrame = &fiber->frames[fiber->frameCount++];
+                    newFrame->func = func;
+                    newFrame->ip = func->chunk->code;
+                    newFrame->slots = fiber->stackTop - argCount; // Argumentos começam aqui
+                }
             }
             else if (callee.isNative())
             {
@@ -1150,7 +1827,8 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                     return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
                 }
 
-                Value result = nativeFunc.func(this, argCount, fiber->stackTop - argCount);
+                Value result = tracing_ ? callNativeTraced(nativeFunc, argCount, fiber->stackTop - argCount)
+                                        : nativeFunc.func(this, argCount, fiber->stackTop - argCount);
 
                 // Remove args + callee da stack
                 fiber->stackTop -= (argCount + 1);
@@ -1234,6 +1912,7 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
             }
 
             LOAD_FRAME();
+            ENTER_CHECKED();
             break;
         }
 
@@ -1275,8 +1954,17 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
 
             fiber->frameCount--;
 
-            fiber->stackTop = resultSlot;
-            *fiber->stackTop++ = result;
+            // O frame base da fiber nao tem callee por baixo: o resultado
+            // nao tem onde ficar (slots - 1 ja esta fora da FiberStack)
+            if (fiber->frameCount > 0)
+            {
+                fiber->stackTop = resultSlot;
+                *fiber->stackTop++ = result;
+            }
+            else
+            {
+                fiber->stackTop = fiber->stack;
+            }
 
             if (fiber->frameCount == 0)
             {
@@ -1308,6 +1996,7 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
             }
 
             LOAD_FRAME();
+            ENTER_CHECKED();
             break;
         }
             // ========== PROCESS/FIBER CONTROL ==========
@@ -1399,6 +2088,7 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
 
             int fiberIdx = currentProcess->nextFiberIndex++;
             Fiber *newFiber = &currentProcess->fibers[fiberIdx];
+            ProcessPool::instance().attachStack(newFiber);
 
             newFiber->state = FiberState::RUNNING;
             newFiber->resumeTime = 0;
@@ -1436,15 +2126,9 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
             // ========== PROPERTY ACCESS ==========
 
         case OP_GET_PROPERTY:
+        case OP_GET_PROPERTY_LONG:
         {
-            Value object = PEEK();
-            Value nameValue = READ_CONSTANT();
-
-            // printf("\nGet Object: '");
-            // printValue(object);
-            // printf("'\nName : '");
-            // printValue(nameValue);
-            // printf("'\n");
+            Value nameValue = READ_NAME(OP_GET_PROPERTY);
 
             if (!nameValue.isString())
             {
@@ -1452,74 +2136,18 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                 return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
             }
 
-            const char *name = nameValue.asStringChars();
-
-            // === STRING METHODS ===
-            if (object.isString())
-            {
-
-                if (strcmp(name, "length") == 0)
-                {
-
-                    DROP();
-                    PUSH(Value::makeInt(object.asString()->length()));
-                }
-                else
-                {
-
-                    runtimeError("String has no property '%s'", name);
-                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
-                }
-            }
-
-            // === PROCESS PRIVATES (external access) ===
-            if (object.isProcess())
-            {
-
-                int processId = object.asProcessId();
-
-                Process *proc = aliveProcesses[processId];
-                if (!proc)
-                {
-                    runtimeError("Process '%i' is dead or invalid", processId);
-                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
-                }
-                int privateIdx = getProcessPrivateIndex(name);
-                if (privateIdx != -1)
-                {
-                    PUSH(proc->privates[privateIdx]);
-                }
-                else
-                {
-                    runtimeError("Proces  does not support '%s' property access", name);
-                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
-                }
-
-                break;
-
-                // runtimeError("Process has no property '%s'", name);
-                // return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
-            }
+            Value result;
+            if (!getProperty(PEEK(), nameValue.asString(), result))
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
 
-            // === OUTROS TIPOS (futuro) ===
-            runtimeError("Type does not support property access");
-            return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+            PEEK() = result;
             break;
         }
         case OP_SET_PROPERTY:
+        case OP_SET_PROPERTY_LONG:
         {
             // Stack: [object, value]
-            Value value = PEEK();
-            Value object = PEEK2();
-            Value nameValue = READ_CONSTANT();
-
-            // printf("Set Value: '");
-            // printValue(value);
-            // printf("'\nObject: '");
-            // printValue(object);
-            // printf("'\nName : '");
-            // printValue(nameValue);
-            // printf("'\n");
+            Value nameValue = READ_NAME(OP_SET_PROPERTY);
 
             if (!nameValue.isString())
             {
@@ -1527,56 +2155,116 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                 return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
             }
 
-            String *propName = nameValue.asString();
-            const char *name = propName->chars();
+            Value value = PEEK();
+            if (!setProperty(PEEK2(), nameValue.asString(), value))
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+
+            DROP();
+            PEEK() = value; // Assignment retorna valor
+            break;
+        }
 
-            // === STRINGS (read-only) ===
-            if (object.isString())
+        case OP_FORMAT:
+        {
+            uint8 count = READ_BYTE();
+            String *result = StringPool::instance().format(fiber->stackTop - count, count);
+            fiber->stackTop -= count;
+            PUSH(Value::makeString(result));
+            break;
+        }
+
+            // ========== TYPES ==========
+
+        case OP_NEW_STRUCT:
+        {
+            uint16 type = READ_SHORT();
+            uint8 argCount = READ_BYTE();
+
+            if (Checked && type >= structs.size())
             {
-                runtimeError("Cannot set property on string (immutable)");
+                runtimeError("Invalid type index %d", (int)type);
                 return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
             }
 
-            // === PROCESS PRIVATES (external write) ===
-            if (object.isProcess())
+            Value instance = newStruct(structs[type], fiber->stackTop - argCount, argCount);
+            fiber->stackTop -= argCount;
+            PUSH(instance);
+            break;
+        }
+        case OP_GET_FIELD:
+        {
+            // Stack: [object] -> [valor]
+            uint8 slot = READ_BYTE();
+            uint16 field = READ_SHORT();
+            Value &object = PEEK();
+
+            if (object.isStruct())
             {
-                int processId = object.asProcessId();
-                Process *proc = aliveProcesses[processId];
+                StructInstance *instance = object.asStruct();
+                const StructDef *def = instance->def;
 
-                if (!proc) // || proc->state == FiberState::DEAD)
+                // Slot esperado e de outro type: procura o campo neste e
+                // guarda o slot no bytecode (cache por site)
+                if (slot >= def->fieldCount || def->fieldIds[slot] != field)
                 {
-                    runtimeError("Process '%i' is dead or invalid", processId);
-                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                    int found = def->slotOf(field);
+                    if (found == -1)
+                    {
+                        runtimeError("Type '%s' has no field '%s'", def->name->chars(), fieldNames[field]->chars());
+                        return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                    }
+                    slot = (uint8)found;
+                    ip[-3] = slot; // proximo acesso deste site tenta este type
                 }
+                object = instance->fields()[slot];
+                break;
+            }
+
+            Value result;
+            if (!getProperty(object, fieldNames[field], result))
+                return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+            PEEK() = result;
+            break;
+        }
+        case OP_SET_FIELD:
+        {
+            // Stack: [object, value] -> [value]
+            uint8 slot = READ_BYTE();
+            uint16 field = READ_SHORT();
+            Value value = PEEK();
+            Value &object = PEEK2();
 
-                // Lookup private pelo nome
-                int privateIdx = getProcessPrivateIndex(name);
-                if (privateIdx != -1)
+            if (object.isStruct())
+            {
+                StructInstance *instance = object.asStruct();
+                const StructDef *def = instance->def;
+
+                if (slot >= def->fieldCount || def->fieldIds[slot] != field)
                 {
-                    if ((privateIdx == (int)PrivateIndex::ID) || (privateIdx == (int)PrivateIndex::FATHER))
+                    int found = def->slotOf(field);
+                    if (found == -1)
                     {
-                        runtimeError("Property '%s' is readonly", name);
+                        runtimeError("Type '%s' has no field '%s'", def->name->chars(), fieldNames[field]->chars());
                         return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
                     }
-                    proc->privates[privateIdx] = value;
-                    DROP();      // Remove value
-                    DROP();      // Remove process
-                    PUSH(value); // Assignment retorna valor
-                    break;
+                    slot = (uint8)found;
+                    ip[-3] = slot; // proximo acesso deste site tenta este type
                 }
-
-                runtimeError("Process has no property '%s'", name);
+                instance->fields()[slot] = value;
+            }
+            else if (!setProperty(object, fieldNames[field], value))
+            {
                 return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
             }
 
-            runtimeError("Cannot set property on this type");
-            return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
-
+            DROP();
+            PEEK() = value;
             break;
         }
         case OP_INVOKE:
+        case OP_INVOKE_LONG:
         {
-            Value nameValue = READ_CONSTANT();
+            Value nameValue = READ_NAME(OP_INVOKE);
             uint8_t argCount = READ_BYTE();
 
             if (!nameValue.isString())
@@ -1851,6 +2539,18 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                     ARGS_CLEANUP();
                     PUSH(Value::makeString(result));
                 }
+                else if (strcmp(name, "to_int") == 0 || strcmp(name, "to_float") == 0)
+                {
+                    if (argCount != 0)
+                    {
+                        runtimeError("%s() expects no arguments", name);
+                        return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                    }
+
+                    Value result = parseNumberText(str, strcmp(name, "to_int") == 0);
+                    ARGS_CLEANUP();
+                    PUSH(result);
+                }
                 else
                 {
                     runtimeError("String has no method '%s'", name);
@@ -1859,6 +2559,32 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
                 break;
             }
 
+            // === NUMBER METHODS ===
+            if (receiver.isInt() || receiver.isDouble())
+            {
+                Value result;
+                if (strcmp(name, "to_int") == 0)
+                    result = receiver.isInt() ? receiver : truncateToInt(receiver.asDouble());
+                else if (strcmp(name, "to_float") == 0)
+                    result = receiver.isDouble() ? receiver : Value::makeDouble((double)receiver.asInt());
+                else if (strcmp(name, "to_string") == 0)
+                    result = Value::makeString(StringPool::instance().to_string(receiver));
+                else
+                {
+                    runtimeError("Number has no method '%s'", name);
+                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                }
+
+                if (argCount != 0)
+                {
+                    runtimeError("%s() expects no arguments", name);
+                    return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
+                }
+                ARGS_CLEANUP();
+                PUSH(result);
+                break;
+            }
+
             runtimeError("Type does not support method calls");
             return {FiberResult::FIBER_DONE, instructionsRun, 0, 0};
         }
@@ -1894,4 +2620,16 @@ FiberResult Interpreter::run_fiber(Fiber *fiber)
 
 #undef READ_BYTE
 #undef READ_SHORT
+#undef READ_LONG
+}
+
+FiberResult Interpreter::run_fiber(Fiber *fiber)
+{
+    Function *top = fiber->frames[fiber->frameCount - 1].func;
+    FiberResult result = (top->maxStack < 0) ? dispatch<true>(fiber) : dispatch<false>(fiber);
+    instructionsExecuted_ += result.instructionsRun;
+    // startProfiler a meio da fatia (num native) ainda nao foi visto pelo dispatch
+    if (profiling_)
+        sampleCountdown_ = sampleCountdown_ > result.instructionsRun ? sampleCountdown_ - result.instructionsRun : 1;
+    return result;
 }
@@ -33,6 +33,8 @@ void Lexer::initKeywords()
     keywords = {
         {"var", TOKEN_VAR},
         {"def", TOKEN_DEF},
+        {"const", TOKEN_CONST},
+        {"enum", TOKEN_ENUM},
         {"if", TOKEN_IF},
         {"elif", TOKEN_ELIF},
         {"else", TOKEN_ELSE},
@@ -0,0 +1,239 @@
+#include "interpreter.hpp"
+#include "pool.hpp"
+#include "code.hpp"
+#include "structs.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+
+// ============================================
+// MEMORIA
+// ============================================
+// Cada subsistema aloca pelo seu caminho (HeapAllocator, aAlloc, new); aqui
+// junta-se tudo em reservado/usado/livre. O modo barato le os contadores dos
+// allocators e do ProcessPool, soma capacidades de tabelas e chunks e percorre
+// as fibers dos processos vivos (O(functions + processos)).
+
+template <typename M>
+static void addMap(MemoryUsage &usage, const M &map)
+{
+    usage.reserved += map.capacity * sizeof(typename M::Entry);
+    usage.used += map.count * sizeof(typename M::Entry);
+}
+
+template <typename T>
+static void addVector(MemoryUsage &usage, const Vector<T> &vector)
+{
+    usage.reserved += vector.capacity() * sizeof(T);
+    usage.used += vector.size() * sizeof(T);
+}
+
+static void addCode(MemoryUsage &usage, const Code *code)
+{
+    if (!code)
+        return;
+    usage.reserved += sizeof(Code) + code->capacity() + code->lineCapacity * sizeof(LineRun) +
+                      code->constants.capacity * sizeof(Value);
+    usage.used += sizeof(Code) + code->count + code->lineCount * sizeof(LineRun) +
+                  code->constants.count * sizeof(Value);
+}
+
+// Stack de cada fiber com FiberStack: reservada inteira, usada ate ao
+// stackTop nas que nao estao mortas
+static void addStacks(MemoryUsage &usage, const Fiber *fibers)
+{
+    for (int i = 0; i < MAX_FIBERS; i++)
+    {
+        const Fiber &fiber = fibers[i];
+        if (!fiber.storage)
+            continue;
+        usage.reserved += STACK_MAX * sizeof(Value);
+        if (fiber.state != FiberState::DEAD)
+            usage.used += (size_t)(fiber.stackTop - fiber.stack) * sizeof(Value);
+    }
+}
+
+static void addHeap(MemoryUsage &usage, const HeapAllocator &heap)
+{
+    // Alocacoes grandes vao direto ao aAlloc: reservadas == usadas
+    usage.reserved += heap.GetTotalReserved() + heap.GetLargeAllocatedBytes();
+    usage.used += heap.GetTotalAllocated();
+    usage.peak = heap.GetPeakAllocated();
+}
+
+const char *Interpreter::memorySubsystemName(int subsystem)
+{
+    switch (subsystem)
+    {
+    case MEM_STRINGS:
+        return "strings";
+    case MEM_ARENA:
+        return "arena";
+    case MEM_PROCESSES:
+        return "processes";
+    case MEM_CODE:
+        return "code";
+    case MEM_TABLES:
+        return "tables";
+    case MEM_PROFILING:
+        return "profiling";
+    default:
+        return "?";
+    }
+}
+
+void Interpreter::getMemoryReport(MemoryReport &report, bool detailed)
+{
+    report = MemoryReport();
+    report.detailed = detailed;
+
+    const HeapAllocator &stringHeap = StringPool::instance().getAllocator();
+    addHeap(report.subsystems[MEM_STRINGS], stringHeap);
+    addHeap(report.subsystems[MEM_ARENA], arena);
+
+    // Process e FiberStack do pool (em uso + reciclaveis) e os blueprints. Os
+    // slots de stack por usar estao dentro destes bytes mas contam como livres
+    ProcessPool &pool = ProcessPool::instance();
+    MemoryUsage &processUsage = report.subsystems[MEM_PROCESSES];
+    size_t blueprints = processes.size() * sizeof(ProcessDef);
+    processUsage.reserved = pool.allocatedCount() * sizeof(Process) + pool.stackCount() * sizeof(FiberStack) +
+                            blueprints;
+    processUsage.used = (pool.allocatedCount() - pool.freeCount()) * sizeof(Process) +
+                        (pool.stackCount() - pool.freeStackCount()) * sizeof(FiberStack) + blueprints;
+
+    MemoryUsage &stacks = report.fiberStacks;
+    for (size_t i = 0; i < aliveProcesses.size(); i++)
+        addStacks(stacks, aliveProcesses[i]->fibers);
+    for (size_t i = 0; i < processes.size(); i++)
+        addStacks(stacks, processes[i]->fibers);
+    // Pilhas no pool ja ficaram fora de processUsage.used: so a folga das ligadas sai
+    size_t slack = stacks.reserved - stacks.used;
+    processUsage.used -= slack < processUsage.used ? slack : processUsage.used;
+    stacks.reserved += pool.freeStackCount() * STACK_MAX * sizeof(Value);
+    stacks.free = stacks.reserved - stacks.used;
+    if (stacks.used > fiberStackPeak_)
+        fiberStackPeak_ = stacks.used;
+    stacks.peak = fiberStackPeak_;
+
+    // Functions: chunk actual, baseline de um tier-up e copia optimizada por trocar
+    MemoryUsage &codeUsage = report.subsystems[MEM_CODE];
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+        const Function *func = functions[i];
+        codeUsage.reserved += sizeof(Function);
+        codeUsage.used += sizeof(Function);
+        addCode(codeUsage, func->chunk);
+        addCode(codeUsage, func->baseline);
+        Code *optimized = func->optimized.load(std::memory_order_acquire);
+        if (optimized != func->chunk)
+            addCode(codeUsage, optimized);
+    }
+
+    MemoryUsage &tableUsage = report.subsystems[MEM_TABLES];
+    addMap(tableUsage, functionsMap);
+    addMap(tableUsage, processesMap);
+    addMap(tableUsage, nativesMap);
+    addMap(tableUsage, privateIndexMap);
+    addMap(tableUsage, globals);
+    addMap(tableUsage, structsMap);
+    addMap(tableUsage, fieldsMap);
+    addVector(tableUsage, functions);
+    addVector(tableUsage, processes);
+    addVector(tableUsage, processStats_);
+    addVector(tableUsage, natives);
+    addVector(tableUsage, globalList);
+    addVector(tableUsage, structs);
+    addVector(tableUsage, fieldNames);
+    addVector(tableUsage, fieldSlots);
+    addVector(tableUsage, aliveProcesses);
+    addVector(tableUsage, cleanProcesses);
+    addVector(tableUsage, tierPending_);
+    tableUsage.reserved += structs.size() * sizeof(StructDef);
+    tableUsage.used += structs.size() * sizeof(StructDef);
+
+    MemoryUsage &profilingUsage = report.subsystems[MEM_PROFILING];
+    if (opcodeProfile_)
+    {
+        profilingUsage.reserved += sizeof(OpcodeProfile);
+        profilingUsage.used += sizeof(OpcodeProfile);
+    }
+    if (profiler_)
+    {
+        size_t bytes = sizeof(Profiler) + profiler_->memoryUsed();
+        profilingUsage.reserved += bytes;
+        profilingUsage.used += bytes;
+    }
+    if (tracer_)
+    {
+        profilingUsage.reserved += sizeof(Tracer) + tracer_->capacity() * sizeof(TraceEvent);
+        profilingUsage.used += sizeof(Tracer) + tracer_->count() * sizeof(TraceEvent);
+    }
+
+    for (int i = 0; i < MEM_COUNT; i++)
+    {
+        MemoryUsage &usage = report.subsystems[i];
+        usage.free = usage.reserved > usage.used ? usage.reserved - usage.used : 0;
+        if (usage.used > memoryPeaks_[i])
+            memoryPeaks_[i] = usage.used;
+        if (memoryPeaks_[i] > usage.peak)
+            usage.peak = memoryPeaks_[i];
+
+        report.total.reserved += usage.reserved;
+        report.total.used += usage.used;
+        report.total.free += usage.free;
+    }
+    if (report.total.used > memoryTotalPeak_)
+        memoryTotalPeak_ = report.total.used;
+    report.total.peak = memoryTotalPeak_;
+    report.fragmentation = report.total.reserved ? (float)report.total.free / (float)report.total.reserved : 0.0f;
+
+    if (!detailed)
+        return;
+
+    stringHeap.GetStats(report.strings);
+    arena.GetStats(report.arena);
+}
+
+static void printUsage(FILE *out, const char *name, const MemoryUsage &usage)
+{
+    fprintf(out, "%-14s %12.1f %12.1f %12.1f %12.1f\n", name, usage.reserved / 1024.0, usage.used / 1024.0,
+            usage.free / 1024.0, usage.peak / 1024.0);
+}
+
+static void printSizeClasses(FILE *out, const char *name, const AllocationStats &stats)
+{
+    fprintf(out, "== %s size classes ==\n", name);
+    fprintf(out, "%8s %10s %12s %12s %7s\n", "size", "blocks", "used KB", "reserved KB", "free%");
+    for (size_t i = 0; i < blockSizes; i++)
+    {
+        if (!stats.blockReserved[i])
+            continue;
+        size_t used = stats.blockStats[i] * HeapAllocator::GetBlockSize(i);
+        fprintf(out, "%8zu %10zu %12.1f %12.1f %6.1f%%\n", HeapAllocator::GetBlockSize(i), stats.blockStats[i],
+                used / 1024.0, stats.blockReserved[i] / 1024.0,
+                100.0 * (double)(stats.blockReserved[i] - used) / (double)stats.blockReserved[i]);
+    }
+    fprintf(out, "%8s %10zu %12.1f\n", "large", stats.largeAllocations, stats.largeAllocatedBytes / 1024.0);
+}
+
+void Interpreter::dumpMemoryReport(FILE *out)
+{
+    MemoryReport report;
+    getMemoryReport(report, true);
+
+    fprintf(out, "== memory (KB) ==\n");
+    fprintf(out, "%-14s %12s %12s %12s %12s\n", "subsystem", "reserved", "used", "free", "peak");
+    for (int i = 0; i < MEM_COUNT; i++)
+        printUsage(out, memorySubsystemName(i), report.subsystems[i]);
+    printUsage(out, "total", report.total);
+    printUsage(out, "(fiber stacks)", report.fiberStacks);
+    fprintf(out, "fragmentation  %.1f%% of reserved is free\n", report.fragmentation * 100.0f);
+
+    printSizeClasses(out, "strings", report.strings);
+    printSizeClasses(out, "arena", report.arena);
+}
+
+void Interpreter::setMemorySampling(uint32 everyFrames)
+{
+    memorySampleEvery_ = everyFrames;
+    memorySampleFrame_ = 0;
+}
@@ -0,0 +1,523 @@
+#include "numconv.hpp"
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cmath>
+#include <string>
+
+// ============================================
+// INTEIROS
+// ============================================
+
+static const char DIGIT_PAIRS[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+int formatLong(char *buffer, long value)
+{
+    // Dois digitos de cada vez, de tras para a frente
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    unsigned long n = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    while (n >= 100)
+    {
+        unsigned pair = (unsigned)(n % 100) * 2;
+        n /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if (n >= 10)
+    {
+        unsigned pair = (unsigned)n * 2;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    else
+    {
+        *--p = (char)('0' + n);
+    }
+
+    int length = 0;
+    if (value < 0)
+        buffer[length++] = '-';
+    std::memcpy(buffer + length, p, end - p);
+    return length + (int)(end - p);
+}
+
+const char *parseLong(const char *first, const char *last, long &out)
+{
+    const char *p = first;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    const char *digits = p;
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1UL : (unsigned long)LONG_MAX;
+    unsigned long value = 0;
+    while (p < last && *p >= '0' && *p <= '9')
+    {
+        unsigned d = (unsigned)(*p - '0');
+        if (value > (limit - d) / 10)
+            return nullptr; // nao cabe
+        value = value * 10 + d;
+        p++;
+    }
+    if (p == digits)
+        return nullptr;
+
+    out = negative ? (long)(0UL - value) : (long)value;
+    return p;
+}
+
+// ============================================
+// DOUBLE -> TEXTO (Grisu2)
+// ============================================
+// Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers" (2010). Os digitos voltam sempre ao mesmo double; em raros
+// casos ha um digito a mais do que o minimo.
+
+namespace
+{
+    const uint64_t DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+    const uint64_t DP_HIDDEN_BIT = 0x0010000000000000ULL;
+    const int DP_SIGNIFICAND_SIZE = 52;
+    const int DP_EXPONENT_BIAS = 0x3FF + DP_SIGNIFICAND_SIZE;
+    const int DP_MIN_EXPONENT = -DP_EXPONENT_BIAS;
+
+    // 10^k para k = -348, -340, ..., 340: f * 2^e com f normalizado
+    const uint64_t POW10_SIGNIFICANDS[87] = {
+        0xFA8FD5A0081C0288, 0xBAAEE17FA23EBF76, 0x8B16FB203055AC76,
+        0xCF42894A5DCE35EA, 0x9A6BB0AA55653B2D, 0xE61ACF033D1A45DF,
+        0xAB70FE17C79AC6CA, 0xFF77B1FCBEBCDC4F, 0xBE5691EF416BD60C,
+        0x8DD01FAD907FFC3C, 0xD3515C2831559A83, 0x9D71AC8FADA6C9B5,
+        0xEA9C227723EE8BCB, 0xAECC49914078536D, 0x823C12795DB6CE57,
+        0xC21094364DFB5637, 0x9096EA6F3848984F, 0xD77485CB25823AC7,
+        0xA086CFCD97BF97F4, 0xEF340A98172AACE5, 0xB23867FB2A35B28E,
+        0x84C8D4DFD2C63F3B, 0xC5DD44271AD3CDBA, 0x936B9FCEBB25C996,
+        0xDBAC6C247D62A584, 0xA3AB66580D5FDAF6, 0xF3E2F893DEC3F126,
+        0xB5B5ADA8AAFF80B8, 0x87625F056C7C4A8B, 0xC9BCFF6034C13053,
+        0x964E858C91BA2655, 0xDFF9772470297EBD, 0xA6DFBD9FB8E5B88F,
+        0xF8A95FCF88747D94, 0xB94470938FA89BCF, 0x8A08F0F8BF0F156B,
+        0xCDB02555653131B6, 0x993FE2C6D07B7FAC, 0xE45C10C42A2B3B06,
+        0xAA242499697392D3, 0xFD87B5F28300CA0E, 0xBCE5086492111AEB,
+        0x8CBCCC096F5088CC, 0xD1B71758E219652C, 0x9C40000000000000,
+        0xE8D4A51000000000, 0xAD78EBC5AC620000, 0x813F3978F8940984,
+        0xC097CE7BC90715B3, 0x8F7E32CE7BEA5C70, 0xD5D238A4ABE98068,
+        0x9F4F2726179A2245, 0xED63A231D4C4FB27, 0xB0DE65388CC8ADA8,
+        0x83C7088E1AAB65DB, 0xC45D1DF942711D9A, 0x924D692CA61BE758,
+        0xDA01EE641A708DEA, 0xA26DA3999AEF774A, 0xF209787BB47D6B85,
+        0xB454E4A179DD1877, 0x865B86925B9BC5C2, 0xC83553C5C8965D3D,
+        0x952AB45CFA97A0B3, 0xDE469FBD99A05FE3, 0xA59BC234DB398C25,
+        0xF6C69A72A3989F5C, 0xB7DCBF5354E9BECE, 0x88FCF317F22241E2,
+        0xCC20CE9BD35C78A5, 0x98165AF37B2153DF, 0xE2A0B5DC971F303A,
+        0xA8D9D1535CE3B396, 0xFB9B7CD9A4A7443C, 0xBB764C4CA7A44410,
+        0x8BAB8EEFB6409C1A, 0xD01FEF10A657842C, 0x9B10A4E5E9913129,
+        0xE7109BFBA19C0C9D, 0xAC2820D9623BF429, 0x80444B5E7AA7CF85,
+        0xBF21E44003ACDD2D, 0x8E679C2F5E44FF8F, 0xD433179D9C8CB841,
+        0x9E19DB92B4E31BA9, 0xEB96BF6EBADF77D9, 0xAF87023B9BF0EE6B};
+
+    const int16 POW10_EXPONENTS[87] = {
+        -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+        -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+        -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+        -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+        -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+        109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+        375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+        641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+        907, 933, 960, 986, 1013, 1039, 1066};
+
+    const uint64_t POW10[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+        10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL};
+
+    // Float com mantissa de 64 bits
+    struct DiyFp
+    {
+        uint64_t f;
+        int e;
+
+        DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+        explicit DiyFp(double d)
+        {
+            uint64_t u;
+            std::memcpy(&u, &d, sizeof(u));
+            int biased = (int)((u >> DP_SIGNIFICAND_SIZE) & 0x7FF);
+            uint64_t significand = u & DP_SIGNIFICAND_MASK;
+            if (biased != 0)
+            {
+                f = significand + DP_HIDDEN_BIT;
+                e = biased - DP_EXPONENT_BIAS;
+            }
+            else
+            {
+                f = significand;
+                e = DP_MIN_EXPONENT + 1;
+            }
+        }
+
+        // 64x64 -> 64 bits de cima, arredondado
+        DiyFp operator*(const DiyFp &rhs) const
+        {
+            const uint64_t M32 = 0xFFFFFFFFULL;
+            uint64_t a = f >> 32, b = f & M32;
+            uint64_t c = rhs.f >> 32, d = rhs.f & M32;
+            uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+            tmp += 1ULL << 31;
+            return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+        }
+
+        DiyFp normalize() const
+        {
+            DiyFp r = *this;
+            while (!(r.f & (1ULL << 63)))
+            {
+                r.f <<= 1;
+                r.e--;
+            }
+            return r;
+        }
+
+        DiyFp normalizeBoundary() const
+        {
+            DiyFp r = *this;
+            while (!(r.f & (DP_HIDDEN_BIT << 1)))
+            {
+                r.f <<= 1;
+                r.e--;
+            }
+            r.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+            r.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+            return r;
+        }
+
+        // Meio caminho para os doubles vizinhos, com o expoente de plus
+        void boundaries(DiyFp &minus, DiyFp &plus) const
+        {
+            DiyFp pl = DiyFp((f << 1) + 1, e - 1).normalizeBoundary();
+            DiyFp mi = (f == DP_HIDDEN_BIT) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+            mi.f <<= mi.e - pl.e;
+            mi.e = pl.e;
+            plus = pl;
+            minus = mi;
+        }
+    };
+
+    DiyFp cachedPower(int e, int &K)
+    {
+        double dk = (-61 - e) * 0.30102999566398114 + 347; // log10(2)
+        int k = (int)dk;
+        if (dk - k > 0.0)
+            k++;
+
+        unsigned index = (unsigned)((k >> 3) + 1);
+        K = -(-348 + (int)(index << 3));
+        return DiyFp(POW10_SIGNIFICANDS[index], POW10_EXPONENTS[index]);
+    }
+
+    int countDigits(uint32 n)
+    {
+        int count = 1;
+        while (n >= 10 && count < 10)
+        {
+            n /= 10;
+            count++;
+        }
+        return count;
+    }
+
+    void grisuRound(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpW)
+    {
+        while (rest < wpW && delta - rest >= tenKappa &&
+               (rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW))
+        {
+            buffer[length - 1]--;
+            rest += tenKappa;
+        }
+    }
+
+    void digitGen(const DiyFp &W, const DiyFp &Mp, uint64_t delta, char *buffer, int &length, int &K)
+    {
+        const DiyFp one(1ULL << -Mp.e, Mp.e);
+        const uint64_t wpW = Mp.f - W.f;
+        uint32 p1 = (uint32)(Mp.f >> -one.e);
+        uint64_t p2 = Mp.f & (one.f - 1);
+        int kappa = countDigits(p1);
+        length = 0;
+
+        // Parte inteira
+        while (kappa > 0)
+        {
+            uint32 div = (uint32)POW10[kappa - 1];
+            uint32 d = p1 / div;
+            p1 %= div;
+            if (d || length)
+                buffer[length++] = (char)('0' + d);
+            kappa--;
+
+            uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+            if (tmp <= delta)
+            {
+                K += kappa;
+                grisuRound(buffer, length, delta, tmp, POW10[kappa] << -one.e, wpW);
+                return;
+            }
+        }
+
+        // Parte fraccionaria
+        for (;;)
+        {
+            p2 *= 10;
+            delta *= 10;
+            char d = (char)(p2 >> -one.e);
+            if (d || length)
+                buffer[length++] = (char)('0' + d);
+            p2 &= one.f - 1;
+            kappa--;
+            if (p2 < delta)
+            {
+                K += kappa;
+                int index = -kappa;
+                grisuRound(buffer, length, delta, p2, one.f, wpW * (index < 20 ? POW10[index] : 0));
+                return;
+            }
+        }
+    }
+
+    // value > 0: digitos em buffer, value = digitos * 10^K
+    void grisu2(double value, char *buffer, int &length, int &K)
+    {
+        const DiyFp v(value);
+        DiyFp wm(0, 0), wp(0, 0);
+        v.boundaries(wm, wp);
+
+        const DiyFp cmk = cachedPower(wp.e, K);
+        const DiyFp W = v.normalize() * cmk;
+        DiyFp Wp = wp * cmk;
+        DiyFp Wm = wm * cmk;
+        Wm.f++;
+        Wp.f--;
+        digitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+    }
+
+    int writeExponent(char *buffer, int K)
+    {
+        int length = 0;
+        buffer[length++] = 'e';
+        buffer[length++] = (K < 0) ? '-' : '+';
+        return length + formatLong(buffer + length, K < 0 ? -K : K);
+    }
+
+    // Notacao como no JavaScript: decimal para 1e-7 < |x| < 1e21
+    int prettify(char *buffer, int length, int K)
+    {
+        const int kk = length + K; // posicao do ponto decimal
+
+        if (K >= 0 && kk <= 21)
+        {
+            // 1234e7 -> 12340000000
+            for (int i = length; i < kk; i++)
+                buffer[i] = '0';
+            return kk;
+        }
+        if (kk > 0 && kk <= 21)
+        {
+            // 1234e-2 -> 12.34
+            std::memmove(buffer + kk + 1, buffer + kk, (size_t)(length - kk));
+            buffer[kk] = '.';
+            return length + 1;
+        }
+        if (kk > -6 && kk <= 0)
+        {
+            // 1234e-6 -> 0.001234
+            const int offset = 2 - kk;
+            std::memmove(buffer + offset, buffer, (size_t)length);
+            buffer[0] = '0';
+            buffer[1] = '.';
+            for (int i = 2; i < offset; i++)
+                buffer[i] = '0';
+            return length + offset;
+        }
+        if (length == 1)
+        {
+            // 1e30
+            return 1 + writeExponent(buffer + 1, kk - 1);
+        }
+        // 1234e30 -> 1.234e+33
+        std::memmove(buffer + 2, buffer + 1, (size_t)(length - 1));
+        buffer[1] = '.';
+        return length + 1 + writeExponent(buffer + length + 1, kk - 1);
+    }
+}
+
+int formatDouble(char *buffer, double value)
+{
+    if (value != value)
+    {
+        std::memcpy(buffer, "nan", 3);
+        return 3;
+    }
+
+    char *p = buffer;
+    if (std::signbit(value))
+    {
+        *p++ = '-';
+        value = -value;
+    }
+
+    if (value == 0.0)
+    {
+        *p++ = '0';
+        return (int)(p - buffer);
+    }
+    if (std::isinf(value))
+    {
+        std::memcpy(p, "inf", 3);
+        return (int)(p - buffer) + 3;
+    }
+
+    // Inteiro exacto (o caso comum): sem Grisu
+    if (value < 1e15 && value == (double)(long)value)
+        return (int)(p - buffer) + formatLong(p, (long)value);
+
+    int length, K;
+    grisu2(value, p, length, K);
+    return (int)(p - buffer) + prettify(p, length, K);
+}
+
+// ============================================
+// TEXTO -> DOUBLE
+// ============================================
+// Caminho exacto de Clinger: ate 19 digitos com mantissa <= 2^53 e
+// |expoente| <= 22 da o double certo com uma so multiplicacao/divisao.
+// O resto (raro em scripts) vai ao strtod numa copia terminada em '\0'.
+
+static const double POW10_EXACT[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+const char *parseDouble(const char *first, const char *last, double &out)
+{
+    const char *p = first;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;       // digitos significativos na mantissa
+    int exponent = 0;     // expoente decimal da mantissa
+    bool any = false;     // viu pelo menos um digito
+    bool truncated = false; // deitou fora digitos != 0
+
+    while (p < last && *p >= '0' && *p <= '9')
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa)
+                digits++;
+        }
+        else
+        {
+            truncated |= (*p != '0');
+            exponent++;
+        }
+        p++;
+    }
+
+    if (p < last && *p == '.')
+    {
+        p++;
+        while (p < last && *p >= '0' && *p <= '9')
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa)
+                    digits++;
+                exponent--;
+            }
+            else
+            {
+                truncated |= (*p != '0');
+            }
+            p++;
+        }
+    }
+
+    if (!any)
+        return nullptr;
+
+    // Expoente: sem digitos depois do 'e' o numero acaba antes dele
+    if (p < last && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool expNegative = false;
+        if (q < last && (*q == '-' || *q == '+'))
+        {
+            expNegative = (*q == '-');
+            q++;
+        }
+        if (q < last && *q >= '0' && *q <= '9')
+        {
+            int value = 0;
+            while (q < last && *q >= '0' && *q <= '9')
+            {
+                if (value < 100000)
+                    value = value * 10 + (*q - '0');
+                q++;
+            }
+            exponent += expNegative ? -value : value;
+            p = q;
+        }
+    }
+
+    if (!truncated)
+    {
+        if (mantissa == 0)
+        {
+            out = negative ? -0.0 : 0.0;
+            return p;
+        }
+        if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double value = (double)mantissa;
+            value = (exponent < 0) ? value / POW10_EXACT[-exponent] : value * POW10_EXACT[exponent];
+            out = negative ? -value : value;
+            return p;
+        }
+    }
+
+    char local[64];
+    size_t size = (size_t)(p - first);
+    if (size < sizeof(local))
+    {
+        std::memcpy(local, first, size);
+        local[size] = '\0';
+        out = std::strtod(local, nullptr);
+    }
+    else
+    {
+        std::string copy(first, size);
+        out = std::strtod(copy.c_str(), nullptr);
+    }
+    return p;
+}
@@ -0,0 +1,988 @@
+#include "optimizer.hpp"
+#include "code.hpp"
+#include "value.hpp"
+#include "opcode.hpp"
+#include <vector>
+#include <cstdint>
+
+// ============================================
+// INSTRUCTION DECODING
+// ============================================
+
+int Optimizer::instructionLength(uint8 op)
+{
+    switch (op)
+    {
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_POP:
+    case OP_HALT:
+    case OP_NOT:
+    case OP_DUP:
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_NEGATE:
+    case OP_MODULO:
+    case OP_BITWISE_AND:
+    case OP_BITWISE_OR:
+    case OP_BITWISE_XOR:
+    case OP_BITWISE_NOT:
+    case OP_SHIFT_LEFT:
+    case OP_SHIFT_RIGHT:
+    case OP_EQUAL:
+    case OP_NOT_EQUAL:
+    case OP_GREATER:
+    case OP_GREATER_EQUAL:
+    case OP_LESS:
+    case OP_LESS_EQUAL:
+    case OP_ADD_II:
+    case OP_SUB_II:
+    case OP_MUL_II:
+    case OP_LT_II:
+    case OP_LE_II:
+    case OP_GT_II:
+    case OP_GE_II:
+    case OP_ADD_DD:
+    case OP_SUB_DD:
+    case OP_MUL_DD:
+    case OP_DIV_DD:
+    case OP_LT_DD:
+    case OP_LE_DD:
+    case OP_GT_DD:
+    case OP_GE_DD:
+    case OP_RETURN_SUB:
+    case OP_RETURN:
+    case OP_RETURN_NIL:
+    case OP_YIELD:
+    case OP_FRAME:
+    case OP_EXIT:
+    case OP_GET_INDEX:
+    case OP_SET_INDEX:
+    case OP_PRINT:
+        return 1;
+
+    case OP_CONSTANT:
+    case OP_GET_LOCAL:
+    case OP_SET_LOCAL:
+    case OP_GET_GLOBAL:
+    case OP_SET_GLOBAL:
+    case OP_DEFINE_GLOBAL:
+    case OP_GET_PRIVATE:
+    case OP_SET_PRIVATE:
+    case OP_CALL:
+    case OP_TAIL_CALL:
+    case OP_SPAWN:
+    case OP_GET_PROPERTY:
+    case OP_SET_PROPERTY:
+    case OP_FORMAT:
+        return 2;
+
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_LOOP:
+    case OP_GOSUB:
+    case OP_CALL_NATIVE:
+    case OP_INVOKE:
+        return 3;
+
+    case OP_CONSTANT_LONG:
+    case OP_GET_GLOBAL_LONG:
+    case OP_SET_GLOBAL_LONG:
+    case OP_DEFINE_GLOBAL_LONG:
+    case OP_GET_PROPERTY_LONG:
+    case OP_SET_PROPERTY_LONG:
+    case OP_JUMP_LONG:
+    case OP_JUMP_IF_FALSE_LONG:
+    case OP_LOOP_LONG:
+    case OP_NEW_STRUCT:
+    case OP_GET_FIELD:
+    case OP_SET_FIELD:
+        return 4;
+
+    case OP_INVOKE_LONG:
+        return 5;
+
+    case OP_FOR_PREP:
+        return 6;
+
+    case OP_FOR_STEP:
+        return 7;
+
+    case OP_SWITCH_TABLE:
+        return 5;
+
+    default:
+        return 0;
+    }
+}
+
+bool Optimizer::stackEffect(const Code &chunk, size_t offset, int &pops, int &pushes)
+{
+    uint8 op = chunk.code[offset];
+    pops = 0;
+    pushes = 0;
+
+    switch (op)
+    {
+    case OP_CONSTANT:
+    case OP_CONSTANT_LONG:
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_GET_LOCAL:
+    case OP_GET_GLOBAL:
+    case OP_GET_GLOBAL_LONG:
+    case OP_GET_PRIVATE:
+        pushes = 1;
+        return true;
+
+    case OP_POP:
+    case OP_DEFINE_GLOBAL:
+    case OP_DEFINE_GLOBAL_LONG:
+    case OP_SWITCH_TABLE:
+    case OP_RETURN:
+    case OP_YIELD:
+    case OP_FRAME:
+    case OP_EXIT:
+    case OP_PRINT:
+        pops = 1;
+        return true;
+
+    case OP_NOT:
+    case OP_NEGATE:
+    case OP_BITWISE_NOT:
+    case OP_SET_LOCAL:
+    case OP_SET_GLOBAL:
+    case OP_SET_GLOBAL_LONG:
+    case OP_SET_PRIVATE:
+    case OP_JUMP_IF_FALSE:
+    case OP_JUMP_IF_FALSE_LONG:
+    case OP_GET_PROPERTY:
+    case OP_GET_PROPERTY_LONG:
+    case OP_GET_FIELD:
+        pops = 1;
+        pushes = 1;
+        return true;
+
+    case OP_DUP:
+        pops = 1;
+        pushes = 2;
+        return true;
+
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_MODULO:
+    case OP_BITWISE_AND:
+    case OP_BITWISE_OR:
+    case OP_BITWISE_XOR:
+    case OP_SHIFT_LEFT:
+    case OP_SHIFT_RIGHT:
+    case OP_EQUAL:
+    case OP_NOT_EQUAL:
+    case OP_GREATER:
+    case OP_GREATER_EQUAL:
+    case OP_LESS:
+    case OP_LESS_EQUAL:
+    case OP_ADD_II:
+    case OP_SUB_II:
+    case OP_MUL_II:
+    case OP_LT_II:
+    case OP_LE_II:
+    case OP_GT_II:
+    case OP_GE_II:
+    case OP_ADD_DD:
+    case OP_SUB_DD:
+    case OP_MUL_DD:
+    case OP_DIV_DD:
+    case OP_LT_DD:
+    case OP_LE_DD:
+    case OP_GT_DD:
+    case OP_GE_DD:
+    case OP_SET_PROPERTY:
+    case OP_SET_PROPERTY_LONG:
+    case OP_SET_FIELD:
+    case OP_GET_INDEX:
+        pops = 2;
+        pushes = 1;
+        return true;
+
+    case OP_SET_INDEX:
+        pops = 3;
+        pushes = 1;
+        return true;
+
+    case OP_JUMP:
+    case OP_LOOP:
+    case OP_JUMP_LONG:
+    case OP_LOOP_LONG:
+    case OP_GOSUB:
+    case OP_RETURN_SUB:
+    case OP_RETURN_NIL:
+    case OP_HALT:
+    case OP_FOR_PREP:
+    case OP_FOR_STEP:
+        return true;
+
+    // callee + argumentos -> resultado
+    case OP_CALL:
+    case OP_TAIL_CALL:
+    case OP_SPAWN:
+        pops = chunk.code[offset + 1] + 1;
+        pushes = 1;
+        return true;
+
+    // objecto + argumentos -> resultado
+    case OP_INVOKE:
+        pops = chunk.code[offset + 2] + 1;
+        pushes = 1;
+        return true;
+
+    case OP_INVOKE_LONG:
+        pops = chunk.code[offset + 4] + 1;
+        pushes = 1;
+        return true;
+
+    case OP_CALL_NATIVE:
+        pops = chunk.code[offset + 2];
+        pushes = 1;
+        return true;
+
+    // partes -> string
+    case OP_FORMAT:
+        pops = chunk.code[offset + 1];
+        pushes = 1;
+        return true;
+
+    // campos pela ordem -> instancia
+    case OP_NEW_STRUCT:
+        pops = chunk.code[offset + 3];
+        pushes = 1;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+namespace
+{
+    struct Instr
+    {
+        int offset;    // offset original no chunk
+        int length;    // 0 na sentinela de fim
+        uint8 op;
+        int target;    // indice da instrucao destino (saltos), -1 se nao for salto
+        bool removed;
+        bool reachable;
+        bool dirty;    // vizinhanca mudou neste sweep, esperar pela proxima analise
+        bool pinned;   // entrada de OP_SWITCH_TABLE: fica no sitio, mesmo que salte para a seguinte
+        int jumpsIn;   // saltos vivos (e retornos de gosub) que aterram aqui
+        int newOffset;
+    };
+
+    static const int MAX_PASSES = 64;
+    static const int MAX_THREAD_HOPS = 16;
+
+    // O offset de 16 bits e sempre o ultimo operando
+    bool isJump(uint8 op)
+    {
+        return op == OP_JUMP || op == OP_JUMP_IF_FALSE || op == OP_LOOP || op == OP_GOSUB ||
+               op == OP_FOR_PREP || op == OP_FOR_STEP;
+    }
+
+    bool isBackward(uint8 op)
+    {
+        return op == OP_LOOP || op == OP_FOR_STEP;
+    }
+
+    bool isForLoop(uint8 op)
+    {
+        return op == OP_FOR_PREP || op == OP_FOR_STEP;
+    }
+
+    bool isUnconditional(uint8 op)
+    {
+        return op == OP_JUMP || op == OP_LOOP;
+    }
+
+    // Sem fall-through para a instrucao seguinte.
+    // OP_RETURN_NIL/OP_HALT nao tem case no run_fiber e caem para a seguinte.
+    bool endsFlow(uint8 op)
+    {
+        switch (op)
+        {
+        case OP_JUMP:
+        case OP_LOOP:
+        case OP_RETURN:
+        case OP_RETURN_SUB:
+        case OP_EXIT:
+        case OP_SWITCH_TABLE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Empilha um valor sem efeitos laterais
+    bool isPurePush(uint8 op)
+    {
+        switch (op)
+        {
+        case OP_CONSTANT:
+        case OP_CONSTANT_LONG:
+        case OP_NIL:
+        case OP_TRUE:
+        case OP_FALSE:
+        case OP_DUP:
+        case OP_GET_LOCAL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Comparacao tipada com o resultado negado (a <= b compila para
+    // GREATER + NOT). LE_DD/GE_DD sao !(>)/!(<), por isso com NaN dao o mesmo
+    // que o par original. 0 se op nao e uma comparacao tipada.
+    uint8 negatedCompare(uint8 op)
+    {
+        switch (op)
+        {
+        case OP_LT_II:
+            return OP_GE_II;
+        case OP_GE_II:
+            return OP_LT_II;
+        case OP_GT_II:
+            return OP_LE_II;
+        case OP_LE_II:
+            return OP_GT_II;
+        case OP_LT_DD:
+            return OP_GE_DD;
+        case OP_GE_DD:
+            return OP_LT_DD;
+        case OP_GT_DD:
+            return OP_LE_DD;
+        case OP_LE_DD:
+            return OP_GT_DD;
+        default:
+            return 0;
+        }
+    }
+
+    class Pass
+    {
+    public:
+        Pass(Code &chunk) : chunk_(chunk) {}
+
+        bool decode()
+        {
+            std::vector<int> indexAt(chunk_.count + 1, -1);
+
+            size_t offset = 0;
+            while (offset < chunk_.count)
+            {
+                uint8 op = chunk_.code[offset];
+                int length = Optimizer::instructionLength(op);
+                if (length == 0 || offset + length > chunk_.count)
+                    return false;
+
+                // Saltos de 24 bits so existem em chunks grandes demais para esta passagem
+                if (op == OP_JUMP_LONG || op == OP_JUMP_IF_FALSE_LONG || op == OP_LOOP_LONG)
+                    return false;
+
+                indexAt[offset] = (int)code_.size();
+                code_.push_back(make((int)offset, length, op));
+                offset += length;
+            }
+
+            // Sentinela: alvo de saltos para o fim do chunk
+            indexAt[chunk_.count] = (int)code_.size();
+            code_.push_back(make((int)chunk_.count, 0, OP_HALT));
+
+            for (size_t i = 0; i + 1 < code_.size(); i++)
+            {
+                if (code_[i].op != OP_SWITCH_TABLE)
+                    continue;
+
+                // A tabela sao as count+1 instrucoes seguintes, todas OP_JUMP/OP_LOOP
+                int count = tableCount(code_[i]);
+                for (size_t k = i + 1; k <= i + count + 1; k++)
+                {
+                    if (k + 1 >= code_.size() || !isUnconditional(code_[k].op))
+                        return false;
+                    code_[k].pinned = true;
+                }
+            }
+
+            for (size_t i = 0; i + 1 < code_.size(); i++)
+            {
+                Instr &ins = code_[i];
+                if (!isJump(ins.op))
+                    continue;
+
+                int from = ins.offset + ins.length;
+                uint16 operand = (uint16)((chunk_.code[from - 2] << 8) | chunk_.code[from - 1]);
+                int to;
+                if (isBackward(ins.op))
+                    to = from - operand;
+                else if (ins.op == OP_GOSUB)
+                    to = from + (int16)operand;
+                else
+                    to = from + operand;
+
+                // Saltos por resolver (0xffff) ou a meio de uma instrucao: nao mexer
+                if (to < 0 || to > (int)chunk_.count || indexAt[to] < 0)
+                    return false;
+                ins.target = indexAt[to];
+            }
+            return true;
+        }
+
+        bool run()
+        {
+            bool touched = false;
+            for (int pass = 0; pass < MAX_PASSES; pass++)
+            {
+                bool changed = threadJumps();
+                changed |= analyze();
+                changed |= peephole();
+                if (!changed)
+                    break;
+                touched = true;
+            }
+            return touched;
+        }
+
+        void rewrite()
+        {
+            int size = 0;
+            for (size_t i = 0; i < code_.size(); i++)
+            {
+                code_[i].newOffset = size;
+                if (!code_[i].removed)
+                    size += code_[i].length;
+            }
+
+            std::vector<uint8> bytes;
+            std::vector<int> lines;
+            bytes.reserve(size);
+            lines.reserve(size);
+
+            for (size_t i = 0; i + 1 < code_.size(); i++)
+            {
+                const Instr &ins = code_[i];
+                if (ins.removed)
+                    continue;
+
+                int line = chunk_.getLine(ins.offset);
+                for (int k = 0; k < ins.length; k++)
+                {
+                    bytes.push_back(k == 0 ? ins.op : chunk_.code[ins.offset + k]);
+                    lines.push_back(line);
+                }
+
+                if (!isJump(ins.op))
+                    continue;
+
+                int from = ins.newOffset + ins.length;
+                int to = code_[ins.target].newOffset;
+                int distance = isBackward(ins.op) ? from - to : to - from;
+                DEBUG_BREAK_IF(ins.op != OP_GOSUB && (distance < 0 || distance > UINT16_MAX));
+
+                uint16 operand = (uint16)distance;
+                bytes[ins.newOffset] = ins.op;
+                bytes[from - 2] = (operand >> 8) & 0xff;
+                bytes[from - 1] = operand & 0xff;
+            }
+
+            // Nunca cresce: reescreve no mesmo buffer (ips ja guardados continuam validos)
+            chunk_.truncate(0);
+            for (size_t i = 0; i < bytes.size(); i++)
+                chunk_.write(bytes[i], lines[i]);
+        }
+
+    private:
+        Code &chunk_;
+        std::vector<Instr> code_;
+
+        static Instr make(int offset, int length, uint8 op)
+        {
+            Instr ins;
+            ins.offset = offset;
+            ins.length = length;
+            ins.op = op;
+            ins.target = -1;
+            ins.removed = false;
+            ins.reachable = false;
+            ins.dirty = false;
+            ins.pinned = false;
+            ins.jumpsIn = 0;
+            ins.newOffset = 0;
+            return ins;
+        }
+
+        // Instrucao que de facto executa a partir de i (removidas caem para a seguinte)
+        int live(int i) const
+        {
+            while (code_[i].removed)
+                i++;
+            return i;
+        }
+
+        int prevLive(int i) const
+        {
+            for (i--; i >= 0; i--)
+            {
+                if (!code_[i].removed)
+                    return i;
+            }
+            return -1;
+        }
+
+        // Entradas de OP_SWITCH_TABLE, sem contar o default
+        int tableCount(const Instr &ins) const
+        {
+            return (chunk_.code[ins.offset + 3] << 8) | chunk_.code[ins.offset + 4];
+        }
+
+        bool isSentinel(int i) const
+        {
+            return i == (int)code_.size() - 1;
+        }
+
+        // ---------- jump threading ----------
+
+        bool threadJumps()
+        {
+            bool changed = false;
+            for (size_t i = 0; i + 1 < code_.size(); i++)
+            {
+                Instr &ins = code_[i];
+                if (ins.removed || ins.op == OP_GOSUB || isForLoop(ins.op) || !isJump(ins.op))
+                    continue;
+
+                bool conditional = ins.op == OP_JUMP_IF_FALSE;
+                int best = live(ins.target);
+                int t = best;
+
+                for (int hop = 0; hop < MAX_THREAD_HOPS; hop++)
+                {
+                    const Instr &next = code_[t];
+                    // JIF nao faz pop: um JIF que aterra noutro JIF salta outra vez
+                    bool follows = isUnconditional(next.op) || (conditional && next.op == OP_JUMP_IF_FALSE);
+                    if (isSentinel(t) || !follows || t == (int)i)
+                        break;
+
+                    t = live(next.target);
+                    if (conditional && code_[t].offset <= ins.offset)
+                        break;
+                    best = t;
+                }
+
+                if (best != ins.target)
+                {
+                    ins.target = best;
+                    changed = true;
+                }
+
+                if (!conditional)
+                {
+                    uint8 op = code_[ins.target].offset > ins.offset ? OP_JUMP : OP_LOOP;
+                    if (op != ins.op)
+                    {
+                        ins.op = op;
+                        changed = true;
+                    }
+                }
+            }
+            return changed;
+        }
+
+        // ---------- reachability + contagem de entradas ----------
+
+        bool analyze()
+        {
+            for (size_t i = 0; i < code_.size(); i++)
+            {
+                code_[i].reachable = false;
+                code_[i].jumpsIn = 0;
+                code_[i].dirty = false;
+            }
+
+            std::vector<int> work;
+            work.push_back(live(0));
+            while (!work.empty())
+            {
+                int i = work.back();
+                work.pop_back();
+
+                Instr &ins = code_[i];
+                if (ins.reachable)
+                    continue;
+                ins.reachable = true;
+
+                if (isSentinel(i))
+                    continue;
+
+                if (isJump(ins.op))
+                {
+                    int t = live(ins.target);
+                    code_[t].jumpsIn++;
+                    work.push_back(t);
+                }
+
+                // Entradas da tabela
+                if (ins.op == OP_SWITCH_TABLE)
+                {
+                    for (int k = i + 1; k <= i + tableCount(ins) + 1; k++)
+                    {
+                        code_[k].jumpsIn++;
+                        work.push_back(k);
+                    }
+                }
+
+                if (!endsFlow(ins.op))
+                {
+                    int n = live(i + 1);
+                    // Retorno de gosub aterra na instrucao seguinte
+                    if (ins.op == OP_GOSUB)
+                        code_[n].jumpsIn++;
+                    work.push_back(n);
+                }
+            }
+
+            bool changed = false;
+            for (size_t i = 0; i + 1 < code_.size(); i++)
+            {
+                if (!code_[i].removed && !code_[i].reachable)
+                {
+                    code_[i].removed = true;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        // ---------- peephole ----------
+
+        bool constantFalsey(const Instr &ins, bool &falsey) const
+        {
+            switch (ins.op)
+            {
+            case OP_NIL:
+            case OP_FALSE:
+                falsey = true;
+                return true;
+            case OP_TRUE:
+                falsey = false;
+                return true;
+            case OP_CONSTANT:
+            {
+                const Value &v = chunk_.constants[chunk_.code[ins.offset + 1]];
+                falsey = v.isNil() || (v.isBool() && !v.asBool());
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        void remove(int i)
+        {
+            code_[i].removed = true;
+            // Quem saltava para aqui passa a aterrar na seguinte
+            code_[live(i)].dirty = true;
+        }
+
+        bool peephole()
+        {
+            bool changed = false;
+            for (int i = 0; i + 1 < (int)code_.size(); i++)
+            {
+                Instr &ins = code_[i];
+                if (ins.removed || ins.dirty || ins.pinned)
+                    continue;
+
+                // Salto para a instrucao seguinte
+                if ((ins.op == OP_JUMP || ins.op == OP_JUMP_IF_FALSE) && live(ins.target) == live(i + 1))
+                {
+                    remove(i);
+                    changed = true;
+                    continue;
+                }
+
+                int p = prevLive(i);
+                if (p < 0 || code_[p].dirty || ins.jumpsIn > 0)
+                    continue;
+
+                // Condicao constante: o valor testado e conhecido
+                bool falsey;
+                if (ins.op == OP_JUMP_IF_FALSE && constantFalsey(code_[p], falsey))
+                {
+                    if (falsey)
+                        ins.op = OP_JUMP;
+                    else
+                        remove(i);
+                    changed = true;
+                    continue;
+                }
+
+                // push sem efeitos seguido de POP
+                if (ins.op == OP_POP && isPurePush(code_[p].op))
+                {
+                    remove(p);
+                    remove(i);
+                    changed = true;
+                    continue;
+                }
+
+                // Comparacao tipada seguida de NOT: a comparacao inversa
+                if (ins.op == OP_NOT && negatedCompare(code_[p].op))
+                {
+                    code_[p].op = negatedCompare(code_[p].op);
+                    remove(i);
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+    };
+}
+
+// ============================================
+// ENTRY POINT
+// ============================================
+
+bool Optimizer::optimize(Code &chunk)
+{
+    if (chunk.count == 0 || chunk.count > UINT16_MAX)
+        return false;
+
+    Pass pass(chunk);
+    if (!pass.decode())
+        return false;
+
+    if (!pass.run())
+        return false;
+
+    pass.rewrite();
+    return true;
+}
+
+// ============================================
+// WIDE JUMPS
+// ============================================
+// Os saltos sao emitidos com 16 bits antes de se saber a distancia; os que
+// nao couberam chegam aqui em far. Cada salto passa a apontar para o indice
+// da instrucao destino e o layout e refeito ate estabilizar: alargar um salto
+// afasta outros, que podem tambem ter de alargar.
+
+namespace
+{
+    struct WideInstr
+    {
+        int offset;
+        int length; // no chunk original
+        uint8 op;
+        int target; // indice da instrucao destino, -1 se nao for salto
+        bool wide;  // vai sair como _LONG
+        bool pinned; // entrada de OP_SWITCH_TABLE: 3 bytes fixos
+        int newOffset;
+    };
+
+    uint8 longForm(uint8 op)
+    {
+        switch (op)
+        {
+        case OP_JUMP:
+            return OP_JUMP_LONG;
+        case OP_JUMP_IF_FALSE:
+            return OP_JUMP_IF_FALSE_LONG;
+        case OP_LOOP:
+            return OP_LOOP_LONG;
+        default:
+            return op;
+        }
+    }
+
+    bool isLongJump(uint8 op)
+    {
+        return op == OP_JUMP_LONG || op == OP_JUMP_IF_FALSE_LONG || op == OP_LOOP_LONG;
+    }
+
+    // Tamanho da instrucao no layout novo
+    int wideLength(const WideInstr &ins)
+    {
+        return (ins.wide && !isLongJump(ins.op)) ? ins.length + 1 : ins.length;
+    }
+}
+
+bool Optimizer::widenJumps(Code &chunk, const std::vector<FarJump> &far)
+{
+    int count = (int)chunk.count;
+    std::vector<int> farTarget(count + 1, -1);
+    for (size_t i = 0; i < far.size(); i++)
+    {
+        if (far[i].operand < 0 || far[i].operand >= count)
+            return false;
+        farTarget[far[i].operand] = far[i].target;
+    }
+
+    std::vector<WideInstr> code;
+    std::vector<int> indexAt(count + 1, -1);
+
+    for (int offset = 0; offset < count;)
+    {
+        uint8 op = chunk.code[offset];
+        int length = instructionLength(op);
+        if (length == 0 || offset + length > count)
+            return false;
+
+        WideInstr ins;
+        ins.offset = offset;
+        ins.length = length;
+        ins.op = op;
+        ins.target = -1;
+        ins.wide = isLongJump(op);
+        ins.pinned = false;
+        ins.newOffset = 0;
+
+        indexAt[offset] = (int)code.size();
+        code.push_back(ins);
+        offset += length;
+    }
+    indexAt[count] = (int)code.size();
+
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        WideInstr &ins = code[i];
+        int from = ins.offset + ins.length;
+        int to;
+
+        if (ins.op == OP_SWITCH_TABLE)
+        {
+            int entries = ((chunk.code[ins.offset + 3] << 8) | chunk.code[ins.offset + 4]) + 1;
+            for (size_t k = i + 1; k <= i + entries && k < code.size(); k++)
+                code[k].pinned = true;
+        }
+
+        if (isLongJump(ins.op))
+        {
+            int operand = (chunk.code[from - 3] << 16) | (chunk.code[from - 2] << 8) | chunk.code[from - 1];
+            to = (ins.op == OP_LOOP_LONG) ? from - operand : from + operand;
+        }
+        else if (isJump(ins.op))
+        {
+            uint16 operand = (uint16)((chunk.code[from - 2] << 8) | chunk.code[from - 1]);
+            if (farTarget[from - 2] != -1)
+            {
+                // So JUMP/JUMP_IF_FALSE tem versao longa
+                if (longForm(ins.op) == ins.op)
+                    return false;
+                to = farTarget[from - 2];
+                ins.wide = true;
+            }
+            else if (isBackward(ins.op))
+                to = from - operand;
+            else if (ins.op == OP_GOSUB)
+                to = from + (int16)operand;
+            else
+                to = from + operand;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (to < 0 || to > count || indexAt[to] < 0)
+            return false;
+        ins.target = indexAt[to];
+    }
+
+    // Layout ate estabilizar (so cresce, por isso acaba)
+    int size = 0;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        size = 0;
+        for (size_t i = 0; i < code.size(); i++)
+        {
+            code[i].newOffset = size;
+            size += wideLength(code[i]);
+        }
+
+        for (size_t i = 0; i < code.size(); i++)
+        {
+            WideInstr &ins = code[i];
+            if (ins.target < 0 || ins.wide)
+                continue;
+
+            int from = ins.newOffset + wideLength(ins);
+            int to = (ins.target < (int)code.size()) ? code[ins.target].newOffset : size;
+            int distance = isBackward(ins.op) ? from - to : to - from;
+            if (ins.op == OP_GOSUB ? (distance >= INT16_MIN && distance <= INT16_MAX) : distance <= UINT16_MAX)
+                continue;
+
+            if (ins.pinned || longForm(ins.op) == ins.op)
+                return false;
+            ins.wide = true;
+            changed = true;
+        }
+    }
+
+    std::vector<uint8> bytes;
+    std::vector<int> lines;
+    bytes.reserve(size);
+    lines.reserve(size);
+
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        const WideInstr &ins = code[i];
+        int line = chunk.getLine(ins.offset);
+        int length = wideLength(ins);
+
+        if (ins.target < 0)
+        {
+            for (int k = 0; k < ins.length; k++)
+            {
+                bytes.push_back(chunk.code[ins.offset + k]);
+                lines.push_back(line);
+            }
+            continue;
+        }
+
+        // Tudo antes do offset e copiado; o offset e recalculado
+        int operandSize = ins.wide ? 3 : 2;
+        int head = ins.length - (isLongJump(ins.op) ? 3 : 2);
+        bytes.push_back(ins.wide ? longForm(ins.op) : ins.op);
+        lines.push_back(line);
+        for (int k = 1; k < head; k++)
+        {
+            bytes.push_back(chunk.code[ins.offset + k]);
+            lines.push_back(line);
+        }
+
+        int from = ins.newOffset + length;
+        int to = (ins.target < (int)code.size()) ? code[ins.target].newOffset : size;
+        bool backward = isBackward(ins.op) || ins.op == OP_LOOP_LONG;
+        int distance = backward ? from - to : to - from;
+
+        for (int k = operandSize - 1; k >= 0; k--)
+        {
+            bytes.push_back((uint8)((distance >> (8 * k)) & 0xff));
+            lines.push_back(line);
+        }
+    }
+
+    // O buffer cresce: ainda nao ha frames a apontar para este chunk
+    chunk.truncate(0);
+    chunk.reserve(bytes.size());
+    for (size_t i = 0; i < bytes.size(); i++)
+        chunk.write(bytes[i], lines[i]);
+    return true;
+}
@@ -2,11 +2,15 @@
 #include "value.hpp"
 #include "arena.hpp"
 #include "interpreter.hpp"
+#include "structs.hpp"
+#include "numconv.hpp"
+#include "stringops.hpp"
 #include <ctype.h>
+#include <new>
 
 String *StringPool::create(const char *str, uint32 len)
 {
-    uint32 h = hashString(str, len);
+    size_t h = hashString(str, len); // mesmo tipo que concat/substring, o hash tem de bater
 
     // Aloca objeto (32 bytes)
     String *s = (String *)allocator.Allocate(sizeof(String));
@@ -39,7 +43,12 @@ void StringPool::destroy(String *s)
         return;
 
     //Warning(" Destroy string %s", s->chars());
-    if (s->isLong())
+    // Dono com slices: as slices apontam para ele, fica vivo ate ao clear()
+    if (s->length_and_flag & String::IS_PINNED_FLAG)
+        return;
+
+    // O buffer de uma slice e do dono
+    if (s->isLong() && !s->isSlice())
     {
 
         allocator.Free(s->ptr, s->length() + 1);
@@ -71,16 +80,16 @@ String *StringPool::concat(String *a, String *b)
     if (len <= String::SMALL_THRESHOLD)
     {
         s->length_and_flag = static_cast<uint32>(len);
-        std::memcpy(s->data, a->chars(), lenA);
-        std::memcpy(s->data + lenA, b->chars(), lenB);
+        std::memcpy(s->data, a->bytes(), lenA);
+        std::memcpy(s->data + lenA, b->bytes(), lenB);
         s->data[len] = '\0';
     }
     else
     {
         s->length_and_flag = static_cast<uint32>(len) | String::IS_LONG_FLAG;
         s->ptr = (char *)allocator.Allocate(len + 1);
-        std::memcpy(s->ptr, a->chars(), lenA);
-        std::memcpy(s->ptr + lenA, b->chars(), lenB);
+        std::memcpy(s->ptr, a->bytes(), lenA);
+        std::memcpy(s->ptr + lenA, b->bytes(), lenB);
         s->ptr[len] = '\0';
     }
 
@@ -99,6 +108,80 @@ void StringPool::clear()
  //   allocator.Stats();
  
     allocator.Clear();
+    empty = nullptr;
+    std::memset(singles, 0, sizeof(singles));
+}
+
+// ============================================
+// SLICES
+// ============================================
+// Uma slice e uma String longa cujo ptr aponta para dentro do buffer do dono.
+// Nao ha copia nem hash ate alguem precisar: hashCode() calcula a pedido e
+// chars() so copia se a slice nao acabar no '\0' do dono.
+// O dono fica preso (IS_PINNED_FLAG) ate ao clear(), mesmo depois de todas as
+// suas slices terem sido copiadas: nao ha contagem de slices por dono. Na
+// pratica nao muda nada, porque o VM nao liberta Strings criadas a correr
+// (so destroy() dos nomes no compilador, que nunca sao slices).
+
+String *StringPool::single(unsigned char c)
+{
+    String *&s = singles[c];
+    if (!s)
+    {
+        char buffer[1] = {(char)c};
+        s = create(buffer, 1);
+    }
+    return s;
+}
+
+String *StringPool::slice(String *src, size_t start, size_t length)
+{
+    if (length == 0)
+    {
+        if (!empty)
+            empty = create("", 0);
+        return empty;
+    }
+    if (length == src->length())
+        return src; // imutavel: a propria serve
+    if (length == 1)
+        return single((unsigned char)src->bytes()[start]);
+
+    const char *from = src->bytes() + start;
+    String *owner = src->isSlice() ? src->slice.owner : src;
+
+    // Pequena (cabe inline) ou uma lasca de um dono enorme: copia
+    if (length <= String::SMALL_THRESHOLD || length * SLICE_PIN_RATIO < owner->length())
+        return create(from, (uint32)length);
+
+    String *s = (String *)allocator.Allocate(sizeof(String));
+    s->hash = 0;
+    s->length_and_flag = length | String::IS_LONG_FLAG | String::IS_SLICE_FLAG | String::HASH_PENDING_FLAG;
+    s->ptr = const_cast<char *>(from);
+    s->slice.owner = owner;
+    owner->length_and_flag |= String::IS_PINNED_FLAG;
+    return s;
+}
+
+const char *StringPool::flatten(String *s)
+{
+    if (!s->isSlice())
+        return s->chars();
+
+    size_t len = s->length();
+    char *buffer = (char *)allocator.Allocate(len + 1);
+    std::memcpy(buffer, s->ptr, len);
+    buffer[len] = '\0';
+
+    s->ptr = buffer;
+    s->slice.owner = nullptr;
+    s->length_and_flag &= ~String::IS_SLICE_FLAG;
+    return buffer;
+}
+
+const char *flattenString(String *s)
+{
+    return StringPool::instance().flatten(s);
 }
 
 String *StringPool::upper(String *src)
@@ -107,7 +190,7 @@ String *StringPool::upper(String *src)
         return nullptr;
 
     size_t len = src->length();
-    const char *str = src->chars();
+    const char *str = src->bytes();
 
     // Aloca objeto String (32 bytes)
     String *s = (String *)allocator.Allocate(sizeof(String));
@@ -117,10 +200,7 @@ String *StringPool::upper(String *src)
         // Small - inline
         s->length_and_flag = static_cast<uint32>(len);
 
-        for (size_t i = 0; i < len; i++)
-        {
-            s->data[i] = (char)toupper((unsigned char)str[i]);
-        }
+        upperText(s->data, str, len);
         s->data[len] = '\0';
     }
     else
@@ -129,10 +209,7 @@ String *StringPool::upper(String *src)
         s->length_and_flag = static_cast<uint32>(len) | String::IS_LONG_FLAG;
         s->ptr = (char *)allocator.Allocate(len + 1);
 
-        for (size_t i = 0; i < len; i++)
-        {
-            s->ptr[i] = (char)toupper((unsigned char)str[i]);
-        }
+        upperText(s->ptr, str, len);
         s->ptr[len] = '\0';
     }
 
@@ -146,7 +223,7 @@ String *StringPool::lower(String *src)
         return nullptr;
 
     size_t len = src->length();
-    const char *str = src->chars();
+    const char *str = src->bytes();
 
     // Aloca objeto String (32 bytes)
     String *s = (String *)allocator.Allocate(sizeof(String));
@@ -156,10 +233,7 @@ String *StringPool::lower(String *src)
         // Small - inline
         s->length_and_flag = static_cast<uint32>(len);
 
-        for (size_t i = 0; i < len; i++)
-        {
-            s->data[i] = (char)tolower((unsigned char)str[i]);
-        }
+        lowerText(s->data, str, len);
         s->data[len] = '\0';
     }
     else
@@ -168,10 +242,7 @@ String *StringPool::lower(String *src)
         s->length_and_flag = static_cast<uint32>(len) | String::IS_LONG_FLAG;
         s->ptr = (char *)allocator.Allocate(len + 1);
 
-        for (size_t i = 0; i < len; i++)
-        {
-            s->ptr[i] = (char)tolower((unsigned char)str[i]);
-        }
+        lowerText(s->ptr, str, len);
         s->ptr[len] = '\0';
     }
 
@@ -193,12 +264,7 @@ String *StringPool::substring(String *src, uint32 start, uint32 end)
     if (start > end)
         start = end;
 
-    size_t newLen = end - start;
-    if (newLen == 0)
-        return create("", 0); // String vazia
-
-    const char *str = src->chars() + start;
-    return create(str, newLen);
+    return slice(src, start, end - start);
 }
 
 String *StringPool::replace(String *src, const char *oldStr, const char *newStr)
@@ -206,7 +272,7 @@ String *StringPool::replace(String *src, const char *oldStr, const char *newStr)
     if (!src || !oldStr || !newStr)
         return src;
 
-    const char *str = src->chars();
+    const char *str = src->bytes();
     size_t len = src->length();
     size_t oldLen = strlen(oldStr);
     size_t newLen = strlen(newStr);
@@ -215,9 +281,10 @@ String *StringPool::replace(String *src, const char *oldStr, const char *newStr)
         return src;
 
     // Conta ocorrências
+    const char *end = str + len;
     size_t count = 0;
     const char *pos = str;
-    while ((pos = strstr(pos, oldStr)) != nullptr)
+    while ((pos = findText(pos, end - pos, oldStr, oldLen)) != nullptr)
     {
         count++;
         pos += oldLen;
@@ -249,7 +316,7 @@ String *StringPool::replace(String *src, const char *oldStr, const char *newStr)
     const char *current = str;
     size_t destIdx = 0;
 
-    while ((pos = strstr(current, oldStr)) != nullptr)
+    while ((pos = findText(current, end - current, oldStr, oldLen)) != nullptr)
     {
         // Copia até a ocorrência
         size_t copyLen = pos - current;
@@ -287,8 +354,7 @@ String *StringPool::at(String *str, int index)
         return create("", 0); // String vazia
     }
 
-    char buf[2] = {str->chars()[index], '\0'};
-    return create(buf, 1);
+    return single((unsigned char)str->bytes()[index]);
 }
 
 // Contains - verifica se contém substring
@@ -299,7 +365,7 @@ bool StringPool::contains(String *str, String *substr)
     if (substr->length() == 0)
         return true; // String vazia sempre contém
 
-    return strstr(str->chars(), substr->chars()) != nullptr;
+    return findText(str->bytes(), str->length(), substr->bytes(), substr->length()) != nullptr;
 }
 
 // Trim - remove espaços início/fim
@@ -308,23 +374,19 @@ String *StringPool::trim(String *str)
     if (!str)
         return create("", 0);
 
-    const char *start = str->chars();
-    const char *end = start + str->length() - 1;
+    const char *first = str->bytes();
+    const char *start = first;
+    const char *end = start + str->length();
 
     // Trim início
-    while (*start && isspace((unsigned char)*start))
+    while (start < end && isspace((unsigned char)*start))
         start++;
 
     // Trim fim
-    while (end > start && isspace((unsigned char)*end))
+    while (end > start && isspace((unsigned char)end[-1]))
         end--;
 
-    // Se tudo é espaço
-    if (end < start)
-        return create("", 0);
-
-    size_t len = end - start + 1;
-    return create(start, len);
+    return slice(str, start - first, end - start);
 }
 
 bool StringPool::startsWith(String *str, String *prefix)
@@ -334,7 +396,7 @@ bool StringPool::startsWith(String *str, String *prefix)
     if (prefix->length() > str->length())
         return false;
 
-    return strncmp(str->chars(), prefix->chars(), prefix->length()) == 0;
+    return std::memcmp(str->bytes(), prefix->bytes(), prefix->length()) == 0;
 }
 
 bool StringPool::endsWith(String *str, String *suffix)
@@ -348,8 +410,8 @@ bool StringPool::endsWith(String *str, String *suffix)
     if (suffixLen > strLen)
         return false;
 
-    return strcmp(str->chars() + (strLen - suffixLen),
-                  suffix->chars()) == 0;
+    return std::memcmp(str->bytes() + (strLen - suffixLen),
+                       suffix->bytes(), suffixLen) == 0;
 }
 
 int StringPool::indexOf(String *str, String *substr, int startIndex)
@@ -367,13 +429,13 @@ int StringPool::indexOf(String *str, String *substr, int startIndex)
         return -1;
 
  
-    const char *start = str->chars() + startIndex;
-    const char *found = strstr(start, substr->chars());
+    const char *start = str->bytes() + startIndex;
+    const char *found = findText(start, strLen - startIndex, substr->bytes(), substr->length());
 
     if (!found)
         return -1;
 
-    return (int)(found - str->chars());
+    return (int)(found - str->bytes());
 }
 
  
@@ -381,7 +443,18 @@ int StringPool::indexOf(String *str, const char *substr, int startIndex)
 {
     if (!str || !substr)
         return -1;
-    return indexOf(str, create(substr), startIndex);
+
+    size_t substrLen = strlen(substr);
+    int strLen = str->length();
+    if (substrLen == 0)
+        return startIndex;
+    if (startIndex < 0)
+        startIndex = 0;
+    if (startIndex >= strLen)
+        return -1;
+
+    const char *found = findText(str->bytes() + startIndex, strLen - startIndex, substr, substrLen);
+    return found ? (int)(found - str->bytes()) : -1;
 }
 
 // Repeat - repete string N vezes
@@ -414,7 +487,7 @@ String *StringPool::repeat(String *str, int count)
     // Repete
     for (int i = 0; i < count; i++)
     {
-        std::memcpy(dest + (i * len), str->chars(), len);
+        std::memcpy(dest + (i * len), str->bytes(), len);
     }
     dest[totalLen] = '\0';
 
@@ -422,6 +495,137 @@ String *StringPool::repeat(String *str, int count)
     return s;
 }
 
+// ============================================
+// FORMAT (interpolacao "x={x}")
+// ============================================
+// Junta as partes numa so String do tamanho exacto: primeiro mede (numeros
+// vao para um buffer na pilha, via numconv), depois copia tudo de uma vez.
+
+static const char *valueText(const Value &v, int &length)
+{
+    const char *text;
+    switch (v.type)
+    {
+    case ValueType::NIL:
+        text = "nil";
+        break;
+    case ValueType::BOOL:
+        text = v.asBool() ? "true" : "false";
+        break;
+    case ValueType::FUNCTION:
+        text = "<function>";
+        break;
+    case ValueType::NATIVE:
+        text = "<native>";
+        break;
+    case ValueType::PROCESS:
+        text = "<process>";
+        break;
+    case ValueType::STRUCT:
+        text = v.asStruct()->def->name->chars();
+        break;
+    default:
+        text = "<?>";
+        break;
+    }
+    length = (int)std::strlen(text);
+    return text;
+}
+
+String *StringPool::format(const Value *parts, int count)
+{
+    if (count > FORMAT_MAX_PARTS)
+        count = FORMAT_MAX_PARTS;
+
+    // Uma parte so, ja string: e ela
+    if (count == 1 && parts[0].isString())
+        return parts[0].asString();
+
+    // Texto dos numeros (so deles: strings e o resto ja tem o texto algures)
+    int numberCount = 0;
+    for (int i = 0; i < count; i++)
+        numberCount += parts[i].isNumber();
+
+    char inlineNumbers[FORMAT_INLINE_NUMBERS * FORMAT_NUMBER_SIZE];
+    int inlineLengths[FORMAT_INLINE_NUMBERS];
+    char *numbers = inlineNumbers;
+    int *numberLengths = inlineLengths;
+    if (numberCount > FORMAT_INLINE_NUMBERS)
+    {
+        numbers = (char *)aAlloc(numberCount * (FORMAT_NUMBER_SIZE + sizeof(int)));
+        numberLengths = (int *)(numbers + numberCount * FORMAT_NUMBER_SIZE);
+    }
+
+    size_t len = 0;
+    int number = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const Value &v = parts[i];
+        int partLength;
+        if (v.isString())
+            partLength = (int)v.asString()->length();
+        else if (v.isNumber())
+        {
+            char *slot = numbers + number * FORMAT_NUMBER_SIZE;
+            partLength = v.isInt() ? formatLong(slot, v.asInt()) : formatDouble(slot, v.asDouble());
+            numberLengths[number++] = partLength;
+        }
+        else
+            valueText(v, partLength);
+        len += partLength;
+    }
+
+    String *s = (String *)allocator.Allocate(sizeof(String));
+    char *dest;
+    if (len <= String::SMALL_THRESHOLD)
+    {
+        s->length_and_flag = static_cast<uint32>(len);
+        dest = s->data;
+    }
+    else
+    {
+        s->length_and_flag = static_cast<uint32>(len) | String::IS_LONG_FLAG;
+        s->ptr = (char *)allocator.Allocate(len + 1);
+        dest = s->ptr;
+    }
+
+    char *at = dest;
+    number = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const Value &v = parts[i];
+        const char *text;
+        int partLength;
+        if (v.isString())
+        {
+            text = v.asString()->bytes();
+            partLength = (int)v.asString()->length();
+        }
+        else if (v.isNumber())
+        {
+            text = numbers + number * FORMAT_NUMBER_SIZE;
+            partLength = numberLengths[number++];
+        }
+        else
+            text = valueText(v, partLength);
+
+        std::memcpy(at, text, partLength);
+        at += partLength;
+    }
+    *at = '\0';
+
+    if (numbers != inlineNumbers)
+        aFree(numbers);
+
+    s->hash = hashString(dest, static_cast<uint32>(len));
+    return s;
+}
+
+String *StringPool::to_string(Value v)
+{
+    return format(&v, 1);
+}
+
 //     // Split - divide string por separador
 //     Array* split(String* str, String* separator) {
 //         Array* result = new Array();
@@ -511,24 +715,30 @@ Process *ProcessPool::create()
     Process * proc=nullptr;
     if (!pool.size())
     {
-        proc = (Process*) aAlloc(sizeof(Process));
-        return proc;
+        // Fibers sem pilha: attachStack so quando arrancam
+        proc = new (aAlloc(sizeof(Process))) Process();
+        allocated++;
+    }
+    else
+    {
+        proc = pool.back();
+        pool.pop();
     }
-
-    proc = pool.back();
-    pool.pop();
     return proc;
 }
 
 void ProcessPool::destory(Process *proc)
 {
+    detachStacks(proc);
     pool.push(proc);
 }
 
 void ProcessPool::free(Process *proc)
 {
         proc->release();
+        detachStacks(proc);
         aFree(proc);
+        allocated--;
 }
 
 
@@ -540,5 +750,60 @@ void ProcessPool::clear()
         proc->release();
         aFree(proc);
     }
+    allocated -= pool.size();
     pool.clear();
+
+    for (size_t j = 0; j < stacks.size(); j++)
+    {
+        aFree(stacks[j]);
+    }
+    stacksAllocated -= stacks.size();
+    stacks.clear();
+}
+
+void ProcessPool::attachStack(Fiber *fiber)
+{
+    if (fiber->storage)
+        return;
+
+    FiberStack *storage;
+    if (stacks.size())
+    {
+        storage = stacks.back();
+        stacks.pop();
+    }
+    else
+    {
+        storage = (FiberStack *)aAlloc(sizeof(FiberStack));
+        stacksAllocated++;
+    }
+
+    fiber->storage = storage;
+    fiber->stack = storage->stack;
+    fiber->stackTop = storage->stack;
+    fiber->frames = storage->frames;
+    fiber->gosubStack = storage->gosubStack;
+}
+
+void ProcessPool::detachStack(Fiber *fiber)
+{
+    if (!fiber->storage)
+        return;
+
+    stacks.push(fiber->storage);
+    fiber->storage = nullptr;
+    fiber->stack = nullptr;
+    fiber->stackTop = nullptr;
+    fiber->frames = nullptr;
+    fiber->gosubStack = nullptr;
+    fiber->frameCount = 0;
+    fiber->gosubTop = 0;
+}
+
+void ProcessPool::detachStacks(Process *proc)
+{
+    for (int i = 0; i < MAX_FIBERS; i++)
+    {
+        detachStack(&proc->fibers[i]);
+    }
 }
@@ -1,5 +1,6 @@
 #include "interpreter.hpp"
 #include "pool.hpp"
+#include "tracer.hpp"
 
 static uint64_t PROCESS_IDS = 0;
 
@@ -33,6 +34,10 @@ void ProcessDef::release()
     // {
     //     destroyString(argsNames[i]);
     // }
+    for (int i = 0; i < MAX_FIBERS; i++)
+    {
+        ProcessPool::instance().detachStack(&fibers[i]);
+    }
 }
 void Process::finalize()
 {
@@ -136,6 +141,11 @@ ProcessDef *Interpreter::addProcess(const char *name, Function *func)
 
     currentFiber = proc->current;
 
+    proc->index = (uint32)processes.size();
+    ProcessStats stats;
+    stats.name = pName;
+    processStats_.push(stats);
+
     processesMap.set(pName, proc);
     processes.push(proc);
     return proc;
@@ -154,6 +164,9 @@ Process *Interpreter::spawnProcess(ProcessDef *blueprint)
     instance->current = nullptr;
     instance->initialized = false;
     instance->exitCode = 0;
+    instance->defIndex = blueprint->index;
+    instance->instructions = 0;
+    instance->cpuNs = 0;
 
     // Clona privates
     for (int i = 0; i < MAX_PRIVATES; i++)
@@ -161,19 +174,24 @@ Process *Interpreter::spawnProcess(ProcessDef *blueprint)
         instance->privates[i] = blueprint->privates[i];
     }
 
-    // Clona fibers
+    // Clona fibers (so as que o blueprint tem a correr pedem pilha)
     for (int i = 0; i < MAX_FIBERS; i++)
     {
         Fiber *srcFiber = &blueprint->fibers[i];
         Fiber *dstFiber = &instance->fibers[i];
 
-        if (srcFiber->state == FiberState::DEAD)
-        {
-            dstFiber->state = FiberState::DEAD;
-        }
-        // Copia estado
         dstFiber->state = srcFiber->state;
         dstFiber->resumeTime = srcFiber->resumeTime;
+        dstFiber->ip = srcFiber->ip;
+        dstFiber->gosubTop = 0;
+
+        if (!srcFiber->storage)
+        {
+            dstFiber->frameCount = 0;
+            continue;
+        }
+
+        ProcessPool::instance().attachStack(dstFiber);
         dstFiber->frameCount = srcFiber->frameCount;
 
         // Copia stack
@@ -184,14 +202,6 @@ Process *Interpreter::spawnProcess(ProcessDef *blueprint)
         }
         dstFiber->stackTop = dstFiber->stack + stackSize;
 
-        dstFiber->ip = srcFiber->ip;
-
-        dstFiber->gosubTop=0;
-        for (int j = 0; j < GOSUB_MAX; j++)
-        {
-            dstFiber->gosubStack[j]= srcFiber->gosubStack[j];
-        }
-
         // Copia frames
         for (int j = 0; j < srcFiber->frameCount; j++)
         {
@@ -209,6 +219,9 @@ Process *Interpreter::spawnProcess(ProcessDef *blueprint)
 
     aliveProcesses.push(instance);
 
+    if (tracing_)
+        tracer_->instant(TRACE_SPAWN, blueprint->name->chars(), instance->id);
+
     return instance;
 }
 
@@ -222,6 +235,55 @@ uint32 Interpreter::getTotalAliveProcesses() const
     return uint32(aliveProcesses.size());
 }
 
+// ============================================
+// CONTAS POR PROCESSO
+// ============================================
+
+void Interpreter::setProcessTiming(bool enable)
+{
+    processTiming_ = enable;
+}
+
+const Vector<ProcessStats> &Interpreter::getProcessStats() const
+{
+    return processStats_;
+}
+
+// Peso para a lista "top": ns se ha tempo, senao instrucoes se a lib as
+// conta, senao o numero de steps
+static uint64_t statsWeight(const ProcessStats *stats, bool timed, bool counted)
+{
+    if (timed)
+        return stats->ns;
+    return counted ? stats->instructions : stats->steps;
+}
+
+uint32 Interpreter::getTopProcessStats(const ProcessStats **out, uint32 count) const
+{
+    bool counted = isInstructionCountEnabled();
+
+    // count e pequeno (uma lista no ecra): insercao ordenada
+    uint32 found = 0;
+    for (size_t i = 0; i < processStats_.size(); i++)
+    {
+        const ProcessStats *stats = &processStats_[i];
+        if (stats->steps == 0)
+            continue;
+        uint64_t weight = statsWeight(stats, processTiming_, counted);
+
+        uint32 at = found < count ? found++ : count;
+        while (at > 0 && weight > statsWeight(out[at - 1], processTiming_, counted))
+        {
+            if (at < count)
+                out[at] = out[at - 1];
+            at--;
+        }
+        if (at < count)
+            out[at] = stats;
+    }
+    return found;
+}
+
 int Interpreter::addGlobal(const char *name, Value value)
 {
     String *pName = createString(name);
@@ -275,9 +337,23 @@ void Process::release()
 
 void Interpreter::update(float deltaTime)
 {
+    uint64_t updateStart = tracing_ ? Tracer::now() : 0;
     currentTime += deltaTime;
     lastFrameTime = deltaTime;
 
+    // Chunks optimizados em background entram entre frames
+    if (!tierPending_.empty())
+        promoteTiered();
+
+    // getProcessStats mostra so este update
+    for (size_t i = 0; i < processStats_.size(); i++)
+    {
+        ProcessStats &stats = processStats_[i];
+        stats.steps = 0;
+        stats.instructions = 0;
+        stats.ns = 0;
+    }
+
     // for (size_t i = 0; i < aliveProcesses.size(); i++)
     // {
     //     Process *proc = aliveProcesses[i];
@@ -312,6 +388,7 @@ void Interpreter::update(float deltaTime)
 
     // }
 
+    uint64_t scheduleStart = tracing_ ? Tracer::now() : 0;
     size_t i = 0;
     while (i < aliveProcesses.size())
     {
@@ -347,15 +424,21 @@ void Interpreter::update(float deltaTime)
         i++;
     }
 
+    if (tracing_)
+        tracer_->complete(TRACE_SCHEDULE, "schedule", scheduleStart, Tracer::now());
+
     if (cleanProcesses.size() >= 1)
     {
         // Warning(" Cleaning up %zu processes ", cleanProcesses.size());
+        uint64_t cleanupStart = tracing_ ? Tracer::now() : 0;
 
         for (size_t j = 0; j < cleanProcesses.size(); j++)
         {
             Process *proc = cleanProcesses[j];
             // Warning(" Releasing process %s (id=%u) ", proc->name->chars(), proc->id);
 
+            if (tracing_)
+                tracer_->instant(TRACE_DESTROY, proc->name->chars(), proc->id);
             if (hooks.onDestroy)
                 hooks.onDestroy(proc, proc->exitCode);
 
@@ -363,7 +446,25 @@ void Interpreter::update(float deltaTime)
             ProcessPool::instance().destory(proc);
         }
         cleanProcesses.clear();
+
+        if (tracing_)
+            tracer_->complete(TRACE_CLEANUP, "cleanup", cleanupStart, Tracer::now());
+    }
+
+    // Depois do cleanup: os Process libertados ja voltaram ao pool
+    if (memorySampleEvery_ && ++memorySampleFrame_ >= memorySampleEvery_)
+    {
+        memorySampleFrame_ = 0;
+        if (hooks.onMemorySample)
+        {
+            MemoryReport report;
+            getMemoryReport(report);
+            hooks.onMemorySample(this, report);
+        }
     }
+
+    if (tracing_)
+        tracer_->complete(TRACE_UPDATE, "update", updateStart, Tracer::now());
 }
 
 void Interpreter::run_process_step(Process *proc)
@@ -378,8 +479,29 @@ void Interpreter::run_process_step(Process *proc)
     }
 
     proc->current = fiber;
+    bool timed = processTiming_ || tracing_;
+    uint64_t start = timed ? Tracer::now() : 0;
     FiberResult result = run_fiber(fiber);
 
+    ProcessStats &stats = processStats_[proc->defIndex];
+    stats.steps++;
+    stats.totalSteps++;
+    stats.instructions += result.instructionsRun;
+    stats.totalInstructions += result.instructionsRun;
+    proc->instructions += result.instructionsRun;
+    if (timed)
+    {
+        uint64_t end = Tracer::now();
+        if (processTiming_)
+        {
+            stats.ns += end - start;
+            stats.totalNs += end - start;
+            proc->cpuNs += end - start;
+        }
+        if (tracing_)
+            tracer_->complete(TRACE_STEP, proc->name->chars(), start, end, proc->id);
+    }
+
     // Warning("  [run_process_step] result.reason=%d, instructions=%d",   (int)result.reason, result.instructionsRun);
 
     if (proc->state == FiberState::DEAD)
@@ -421,6 +543,7 @@ void Interpreter::render()
 {
     if (!hooks.onRender)
         return;
+    uint64_t renderStart = tracing_ ? Tracer::now() : 0;
     for (size_t i = 0; i < aliveProcesses.size(); i++)
     {
         Process *proc = aliveProcesses[i];
@@ -429,4 +552,6 @@ void Interpreter::render()
             hooks.onRender(proc);
         }
     }
+    if (tracing_)
+        tracer_->complete(TRACE_RENDER, "render", renderStart, Tracer::now());
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "profiler.hpp"
+#include "interpreter.hpp"
+#include "code.hpp"
+#include <algorithm>
+
+// ============================================
+// PROFILER POR AMOSTRAGEM
+// ============================================
+// A contagem de instrucoes fica no dispatch (uma comparacao por instrucao);
+// aqui so chega uma chamada por amostra. A pilha e guardada como ids de
+// sites (funcao, linha) e agregada num map; os nomes so sao resolvidos no dump.
+
+Profiler::Profiler(uint32 interval)
+    : interval_(interval < 2 ? 2 : interval), random_(0x9E3779B9u), samples_(0)
+{
+}
+
+uint32 Profiler::nextInterval()
+{
+    // xorshift32: intervalo uniforme em [interval/2, interval*3/2)
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return interval_ / 2 + random_ % interval_;
+}
+
+static int lineOf(const Code *chunk, const uint8 *ip)
+{
+    if (!chunk || ip < chunk->code || ip >= chunk->code + chunk->count)
+        return -1;
+    return chunk->getLine((size_t)(ip - chunk->code));
+}
+
+uint32 Profiler::siteId(const Function *func, const uint8 *ip)
+{
+    // Frames que ja corriam antes de um tier-up continuam no baseline
+    int line = lineOf(func->chunk, ip);
+    if (line < 0)
+        line = lineOf(func->baseline, ip);
+
+    std::pair<const Function *, int> key(func, line);
+    std::map<std::pair<const Function *, int>, uint32>::iterator it = siteIds_.find(key);
+    if (it != siteIds_.end())
+        return it->second;
+
+    uint32 id = (uint32)sites_.size();
+    Site site = {func, line};
+    sites_.push_back(site);
+    siteIds_[key] = id;
+    return id;
+}
+
+uint32 Profiler::processId(const Process *proc)
+{
+    const String *name = proc ? proc->name : nullptr;
+    for (size_t i = 0; i < processNames_.size(); i++)
+    {
+        if (processNames_[i] == name)
+            return (uint32)i;
+    }
+    processNames_.push_back(name);
+    return (uint32)(processNames_.size() - 1);
+}
+
+void Profiler::sample(const Process *proc, const Fiber *fiber, const uint8 *ip)
+{
+    scratch_.clear();
+    scratch_.push_back(processId(proc));
+
+    // frame->ip das frames de baixo aponta para depois do CALL: -1 cai dentro dele
+    for (int i = 0; i < fiber->frameCount; i++)
+    {
+        const CallFrame &frame = fiber->frames[i];
+        const uint8 *at = ip;
+        if (i < fiber->frameCount - 1)
+            at = frame.ip ? frame.ip - 1 : nullptr;
+        scratch_.push_back(siteId(frame.func, at));
+    }
+
+    stacks_[scratch_]++;
+    samples_++;
+}
+
+size_t Profiler::memoryUsed() const
+{
+    // Cada no de std::map: o par mais 3 ponteiros e a cor
+    const size_t nodeOverhead = 4 * sizeof(void *);
+
+    size_t bytes = sites_.capacity() * sizeof(Site);
+    bytes += siteIds_.size() * (sizeof(std::pair<const std::pair<const Function *, int>, uint32>) + nodeOverhead);
+    bytes += processNames_.capacity() * sizeof(const String *);
+    bytes += scratch_.capacity() * sizeof(uint32);
+
+    std::map<std::vector<uint32>, uint64_t>::const_iterator it;
+    for (it = stacks_.begin(); it != stacks_.end(); ++it)
+        bytes += sizeof(*it) + nodeOverhead + it->first.capacity() * sizeof(uint32);
+    return bytes;
+}
+
+void Profiler::reset()
+{
+    sites_.clear();
+    siteIds_.clear();
+    stacks_.clear();
+    processNames_.clear();
+    samples_ = 0;
+}
+
+void Profiler::writeSite(FILE *out, uint32 id) const
+{
+    const Site &site = sites_[id];
+    const char *name = site.func->name ? site.func->name->chars() : "<anonymous>";
+    if (site.line < 0)
+        fprintf(out, "%s:?", name);
+    else
+        fprintf(out, "%s:%d", name, site.line);
+}
+
+bool Profiler::writeCollapsed(const char *path) const
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return false;
+
+    std::map<std::vector<uint32>, uint64_t>::const_iterator it;
+    for (it = stacks_.begin(); it != stacks_.end(); ++it)
+    {
+        const std::vector<uint32> &stack = it->first;
+        const String *process = processNames_[stack[0]];
+        if (process)
+            fwrite(process->bytes(), 1, process->length(), out);
+        else
+            fputs("<none>", out);
+        for (size_t i = 1; i < stack.size(); i++)
+        {
+            fputc(';', out);
+            writeSite(out, stack[i]);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)it->second);
+    }
+
+    fclose(out);
+    return true;
+}
+
+struct LineRow
+{
+    uint32 site;
+    uint64_t self;
+    uint64_t total;
+};
+
+static bool bySelf(const LineRow &a, const LineRow &b)
+{
+    if (a.self != b.self)
+        return a.self > b.self;
+    if (a.total != b.total)
+        return a.total > b.total;
+    return a.site < b.site;
+}
+
+void Profiler::dumpLines(FILE *out, int maxRows) const
+{
+    std::vector<LineRow> rows(sites_.size());
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        rows[i].site = (uint32)i;
+        rows[i].self = 0;
+        rows[i].total = 0;
+    }
+
+    // total: recursao conta o site uma vez por amostra
+    std::vector<uint64_t> seen(sites_.size(), 0);
+    uint64_t stackIndex = 0;
+
+    std::map<std::vector<uint32>, uint64_t>::const_iterator it;
+    for (it = stacks_.begin(); it != stacks_.end(); ++it)
+    {
+        const std::vector<uint32> &stack = it->first;
+        stackIndex++;
+        if (stack.size() < 2)
+            continue;
+
+        rows[stack.back()].self += it->second;
+        for (size_t i = 1; i < stack.size(); i++)
+        {
+            if (seen[stack[i]] == stackIndex)
+                continue;
+            seen[stack[i]] = stackIndex;
+            rows[stack[i]].total += it->second;
+        }
+    }
+    std::sort(rows.begin(), rows.end(), bySelf);
+
+    double scale = samples_ ? 100.0 / (double)samples_ : 0.0;
+    size_t limit = maxRows > 0 ? (size_t)maxRows : rows.size();
+
+    fprintf(out, "== profile (%llu samples) ==\n", (unsigned long long)samples_);
+    fprintf(out, "%10s %7s %10s %7s  line\n", "self", "self%", "total", "total%");
+    for (size_t i = 0; i < rows.size() && i < limit; i++)
+    {
+        if (!rows[i].total)
+            break;
+        fprintf(out, "%10llu %6.2f%% %10llu %6.2f%%  ",
+                (unsigned long long)rows[i].self, rows[i].self * scale,
+                (unsigned long long)rows[i].total, rows[i].total * scale);
+        writeSite(out, rows[i].site);
+        fputc('\n', out);
+    }
+}
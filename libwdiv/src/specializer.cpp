@@ -0,0 +1,373 @@
+#include "optimizer.hpp"
+#include "code.hpp"
+#include "value.hpp"
+#include "opcode.hpp"
+#include <vector>
+
+// ============================================
+// TYPE INFERENCE
+// ============================================
+// Os locals sao slots da pilha do frame, por isso basta seguir o tipo de
+// cada slot: GET_LOCAL le o slot, SET_LOCAL/FOR_STEP escrevem-no. O estado e
+// propagado por todos os caminhos (saltos, loops, tabelas de switch) ate
+// estabilizar; nos pontos de juncao tipos diferentes viram TYPE_ANY.
+
+namespace
+{
+    enum StaticType : uint8
+    {
+        TYPE_INT,
+        TYPE_DOUBLE,
+        TYPE_ANY, // qualquer outra coisa, ou nao se sabe
+    };
+
+    typedef std::vector<uint8> TypeState;
+
+    uint8 constantType(const Value &v)
+    {
+        if (v.isInt())
+            return TYPE_INT;
+        if (v.isDouble())
+            return TYPE_DOUBLE;
+        return TYPE_ANY;
+    }
+
+    bool isNumeric(uint8 t)
+    {
+        return t == TYPE_INT || t == TYPE_DOUBLE;
+    }
+
+    // Mesmas regras que o run_fiber: int op int -> int, numeros misturados -> double
+    uint8 arithmeticType(uint8 a, uint8 b)
+    {
+        if (a == TYPE_INT && b == TYPE_INT)
+            return TYPE_INT;
+        if (isNumeric(a) && isNumeric(b))
+            return TYPE_DOUBLE;
+        return TYPE_ANY;
+    }
+
+    // Versao tipada de op para dois operandos do tipo t; o proprio op se nao houver
+    uint8 typedOpcode(uint8 op, uint8 t)
+    {
+        if (t == TYPE_INT)
+        {
+            switch (op)
+            {
+            case OP_ADD:
+                return OP_ADD_II;
+            case OP_SUBTRACT:
+                return OP_SUB_II;
+            case OP_MULTIPLY:
+                return OP_MUL_II;
+            case OP_LESS:
+                return OP_LT_II;
+            case OP_GREATER:
+                return OP_GT_II;
+            default:
+                return op;
+            }
+        }
+
+        if (t == TYPE_DOUBLE)
+        {
+            switch (op)
+            {
+            case OP_ADD:
+                return OP_ADD_DD;
+            case OP_SUBTRACT:
+                return OP_SUB_DD;
+            case OP_MULTIPLY:
+                return OP_MUL_DD;
+            case OP_DIVIDE:
+                return OP_DIV_DD;
+            case OP_LESS:
+                return OP_LT_DD;
+            case OP_GREATER:
+                return OP_GT_DD;
+            default:
+                return op;
+            }
+        }
+        return op;
+    }
+
+    class TypeFlow
+    {
+    public:
+        TypeFlow(const Code &chunk) : chunk_(chunk), states_(chunk.count + 1), visited_(chunk.count + 1, false) {}
+
+        bool run(int arity)
+        {
+            int count = (int)chunk_.count;
+            std::vector<bool> isStart(count + 1, false);
+
+            for (int offset = 0; offset < count;)
+            {
+                uint8 op = chunk_.code[offset];
+                int length = Optimizer::instructionLength(op);
+                if (length == 0 || offset + length > count)
+                    return false;
+
+                // O retorno de gosub nao se segue estaticamente
+                if (op == OP_GOSUB || op == OP_RETURN_SUB)
+                    return false;
+
+                isStart[offset] = true;
+                offset += length;
+            }
+            isStart[count] = true;
+
+            if (!merge(0, TypeState(arity, TYPE_ANY), isStart))
+                return false;
+
+            while (!work_.empty())
+            {
+                int offset = work_.back();
+                work_.pop_back();
+
+                if (offset == count)
+                    continue;
+
+                TypeState state = states_[offset];
+                int successors[2];
+                int n = 0;
+
+                if (!step(offset, state, successors, n))
+                    return false;
+
+                for (int i = 0; i < n; i++)
+                {
+                    if (!merge(successors[i], state, isStart))
+                        return false;
+                }
+
+                // Entradas de OP_SWITCH_TABLE (o valor ja saiu da pilha)
+                if (chunk_.code[offset] == OP_SWITCH_TABLE)
+                {
+                    int entries = ((chunk_.code[offset + 3] << 8) | chunk_.code[offset + 4]) + 1;
+                    for (int k = 0; k < entries; k++)
+                    {
+                        if (!merge(offset + 5 + k * 3, state, isStart))
+                            return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Tipos antes da instrucao em offset; nullptr se nunca la se chega
+        const TypeState *stateAt(int offset) const
+        {
+            return visited_[offset] ? &states_[offset] : nullptr;
+        }
+
+    private:
+        const Code &chunk_;
+        std::vector<TypeState> states_;
+        std::vector<bool> visited_;
+        std::vector<int> work_;
+
+        bool merge(int target, const TypeState &state, const std::vector<bool> &isStart)
+        {
+            if (target < 0 || target > (int)chunk_.count || !isStart[target])
+                return false;
+
+            if (!visited_[target])
+            {
+                visited_[target] = true;
+                states_[target] = state;
+                work_.push_back(target);
+                return true;
+            }
+
+            TypeState &old = states_[target];
+            if (old.size() != state.size())
+                return false; // profundidade diferente: nao arriscar
+
+            bool changed = false;
+            for (size_t i = 0; i < old.size(); i++)
+            {
+                if (old[i] != state[i] && old[i] != TYPE_ANY)
+                {
+                    old[i] = TYPE_ANY;
+                    changed = true;
+                }
+            }
+            if (changed)
+                work_.push_back(target);
+            return true;
+        }
+
+        uint16 operandShort(int at) const
+        {
+            return (uint16)((chunk_.code[at] << 8) | chunk_.code[at + 1]);
+        }
+
+        int operandLong(int at) const
+        {
+            return (chunk_.code[at] << 16) | (chunk_.code[at + 1] << 8) | chunk_.code[at + 2];
+        }
+
+        // Aplica a instrucao ao estado; devolve os sucessores
+        bool step(int offset, TypeState &state, int *successors, int &n)
+        {
+            uint8 op = chunk_.code[offset];
+            int length = Optimizer::instructionLength(op);
+            int next = offset + length;
+            int depth = (int)state.size();
+
+            int pops, pushes;
+            if (!Optimizer::stackEffect(chunk_, offset, pops, pushes) || depth < pops)
+                return false;
+
+            switch (op)
+            {
+            case OP_CONSTANT:
+                state.push_back(constantType(chunk_.constants[chunk_.code[offset + 1]]));
+                break;
+
+            case OP_CONSTANT_LONG:
+                state.push_back(constantType(chunk_.constants[operandLong(offset + 1)]));
+                break;
+
+            case OP_GET_LOCAL:
+            {
+                uint8 slot = chunk_.code[offset + 1];
+                if (slot >= depth)
+                    return false;
+                state.push_back(state[slot]);
+                break;
+            }
+
+            case OP_SET_LOCAL:
+            {
+                uint8 slot = chunk_.code[offset + 1];
+                if (slot >= depth)
+                    return false;
+                state[slot] = state.back();
+                break;
+            }
+
+            case OP_DUP:
+                state.push_back(state.back());
+                break;
+
+            case OP_ADD:
+            case OP_SUBTRACT:
+            case OP_MULTIPLY:
+            case OP_DIVIDE:
+            case OP_MODULO:
+            {
+                uint8 b = state.back();
+                state.pop_back();
+                uint8 a = state.back();
+                state.back() = arithmeticType(a, b);
+                break;
+            }
+
+            case OP_NEGATE:
+                if (!isNumeric(state.back()))
+                    state.back() = TYPE_ANY;
+                break;
+
+            case OP_FOR_STEP:
+            {
+                uint8 slot = chunk_.code[offset + 1];
+                if (slot >= depth)
+                    return false;
+                state[slot] = arithmeticType(state[slot], constantType(chunk_.constants[chunk_.code[offset + 4]]));
+                break;
+            }
+
+            // SET_GLOBAL/SET_PRIVATE/JIF/FOR_PREP nao mexem na pilha (so espreitam);
+            // tudo o resto segue o stackEffect com resultado desconhecido
+            default:
+                state.resize(depth - pops);
+                for (int i = 0; i < pushes; i++)
+                    state.push_back(TYPE_ANY);
+                break;
+            }
+
+            switch (op)
+            {
+            case OP_JUMP:
+                successors[n++] = next + operandShort(offset + 1);
+                break;
+            case OP_LOOP:
+                successors[n++] = next - operandShort(offset + 1);
+                break;
+            case OP_JUMP_IF_FALSE:
+                successors[n++] = next;
+                successors[n++] = next + operandShort(offset + 1);
+                break;
+            case OP_JUMP_LONG:
+                successors[n++] = next + operandLong(offset + 1);
+                break;
+            case OP_LOOP_LONG:
+                successors[n++] = next - operandLong(offset + 1);
+                break;
+            case OP_JUMP_IF_FALSE_LONG:
+                successors[n++] = next;
+                successors[n++] = next + operandLong(offset + 1);
+                break;
+            case OP_FOR_PREP:
+                successors[n++] = next;
+                successors[n++] = next + operandShort(next - 2);
+                break;
+            case OP_FOR_STEP:
+                successors[n++] = next;
+                successors[n++] = next - operandShort(next - 2);
+                break;
+            case OP_RETURN:
+            case OP_EXIT:
+            case OP_SWITCH_TABLE:
+                break;
+            default:
+                successors[n++] = next;
+                break;
+            }
+            return true;
+        }
+    };
+}
+
+bool Optimizer::specialize(Code &chunk, int arity)
+{
+    if (chunk.count == 0 || arity < 0)
+        return false;
+
+    TypeFlow flow(chunk);
+    if (!flow.run(arity))
+        return false;
+
+    bool changed = false;
+    bool fusable = false;
+    for (size_t offset = 0; offset < chunk.count; offset += instructionLength(chunk.code[offset]))
+    {
+        const TypeState *state = flow.stateAt((int)offset);
+        if (!state || state->size() < 2)
+            continue;
+
+        uint8 a = (*state)[state->size() - 2];
+        uint8 b = (*state)[state->size() - 1];
+        if (a != b)
+            continue;
+
+        uint8 op = chunk.code[offset];
+        uint8 typed = typedOpcode(op, a);
+        if (typed != op)
+        {
+            chunk.code[offset] = typed;
+            changed = true;
+            if ((op == OP_LESS || op == OP_GREATER) && offset + 1 < chunk.count && chunk.code[offset + 1] == OP_NOT)
+                fusable = true;
+        }
+    }
+
+    // <= / >=: o peephole junta a comparacao tipada com o NOT (se nenhum
+    // salto aterrar no NOT)
+    if (fusable)
+        optimize(chunk);
+    return changed;
+}
@@ -0,0 +1,321 @@
+#include "stringops.hpp"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define TEXT_X86 0
+#endif
+
+// ============================================
+// ESCALAR
+// ============================================
+
+static const char *findScalar(const char *text, size_t length, const char *pattern, size_t patternLength)
+{
+    if (patternLength > length)
+        return nullptr;
+
+    const char first = pattern[0];
+    const char *last = text + length - patternLength; // ultima posicao possivel
+    const char *p = text;
+
+    while (p <= last)
+    {
+        p = (const char *)std::memchr(p, first, (size_t)(last - p) + 1);
+        if (!p)
+            return nullptr;
+        if (std::memcmp(p + 1, pattern + 1, patternLength - 1) == 0)
+            return p;
+        p++;
+    }
+    return nullptr;
+}
+
+static void upperScalar(char *dest, const char *src, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = src[i];
+        dest[i] = (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+    }
+}
+
+static void lowerScalar(char *dest, const char *src, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = src[i];
+        dest[i] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+}
+
+#if TEXT_X86
+
+// ============================================
+// SSE2 (16 bytes)
+// ============================================
+// Procura: compara o primeiro e o ultimo byte do padrao em 16 posicoes de uma
+// vez; so as posicoes onde os dois batem vao ao memcmp (Mula, "SIMD-friendly
+// algorithms for substring searching").
+
+static inline int lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline int lowestBit64(uint64_t mask)
+{
+    unsigned low = (unsigned)mask;
+    return low ? lowestBit(low) : 32 + lowestBit((unsigned)(mask >> 32));
+}
+
+TARGET_SSE2 static const char *findSSE2(const char *text, size_t length, const char *pattern, size_t patternLength)
+{
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i last = _mm_set1_epi8(pattern[patternLength - 1]);
+    const size_t span = length - patternLength + 1; // posicoes de inicio possiveis
+
+    size_t i = 0;
+    for (; i + 16 <= span; i += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i blockLast = _mm_loadu_si128((const __m128i *)(text + i + patternLength - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+
+        while (mask)
+        {
+            int bit = lowestBit(mask);
+            if (std::memcmp(text + i + bit + 1, pattern + 1, patternLength - 2) == 0)
+                return text + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return findScalar(text + i, length - i, pattern, patternLength);
+}
+
+// 'a'..'z' sao positivos como int8 e os bytes >= 0x80 negativos: as
+// comparacoes com sinal deixam o UTF-8 de fora
+TARGET_SSE2 static void caseSSE2(char *dest, const char *src, size_t length, char from, char to)
+{
+    const __m128i low = _mm_set1_epi8((char)(from - 1));
+    const __m128i high = _mm_set1_epi8((char)(to + 1));
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i inRange = _mm_and_si128(_mm_cmpgt_epi8(x, low), _mm_cmplt_epi8(x, high));
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_xor_si128(x, _mm_and_si128(inRange, flip)));
+    }
+
+    if (from == 'a')
+        upperScalar(dest + i, src + i, length - i);
+    else
+        lowerScalar(dest + i, src + i, length - i);
+}
+
+TARGET_SSE2 static void upperSSE2(char *dest, const char *src, size_t length)
+{
+    caseSSE2(dest, src, length, 'a', 'z');
+}
+
+TARGET_SSE2 static void lowerSSE2(char *dest, const char *src, size_t length)
+{
+    caseSSE2(dest, src, length, 'A', 'Z');
+}
+
+// ============================================
+// AVX2 (32 bytes)
+// ============================================
+
+TARGET_AVX2 static const char *findAVX2(const char *text, size_t length, const char *pattern, size_t patternLength)
+{
+    const __m256i first = _mm256_set1_epi8(pattern[0]);
+    const __m256i last = _mm256_set1_epi8(pattern[patternLength - 1]);
+    const size_t span = length - patternLength + 1;
+
+    size_t i = 0;
+
+    // 64 posicoes por volta; o memcmp so corre quando ha candidatos
+    for (; i + 64 <= span; i += 64)
+    {
+        const char *at = text + i;
+        __m256i eqLow = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)at), first),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(at + patternLength - 1)), last));
+        __m256i eqHigh = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(at + 32)), first),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(at + 32 + patternLength - 1)), last));
+        if (_mm256_testz_si256(_mm256_or_si256(eqLow, eqHigh), _mm256_or_si256(eqLow, eqHigh)))
+            continue;
+
+        uint64_t mask = (uint64_t)(unsigned)_mm256_movemask_epi8(eqLow) |
+                        ((uint64_t)(unsigned)_mm256_movemask_epi8(eqHigh) << 32);
+        while (mask)
+        {
+            int bit = lowestBit64(mask);
+            if (std::memcmp(at + bit + 1, pattern + 1, patternLength - 2) == 0)
+                return at + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i + 32 <= span; i += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i blockLast = _mm256_loadu_si256((const __m256i *)(text + i + patternLength - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last)));
+
+        while (mask)
+        {
+            int bit = lowestBit(mask);
+            if (std::memcmp(text + i + bit + 1, pattern + 1, patternLength - 2) == 0)
+                return text + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return findSSE2(text + i, length - i, pattern, patternLength);
+}
+
+TARGET_AVX2 static void caseAVX2(char *dest, const char *src, size_t length, char from, char to)
+{
+    const __m256i low = _mm256_set1_epi8((char)(from - 1));
+    const __m256i high = _mm256_set1_epi8((char)(to + 1));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi8(x, low), _mm256_cmpgt_epi8(high, x));
+        _mm256_storeu_si256((__m256i *)(dest + i), _mm256_xor_si256(x, _mm256_and_si256(inRange, flip)));
+    }
+
+    caseSSE2(dest + i, src + i, length - i, from, to);
+}
+
+TARGET_AVX2 static void upperAVX2(char *dest, const char *src, size_t length)
+{
+    caseAVX2(dest, src, length, 'a', 'z');
+}
+
+TARGET_AVX2 static void lowerAVX2(char *dest, const char *src, size_t length)
+{
+    caseAVX2(dest, src, length, 'A', 'Z');
+}
+
+// ============================================
+// CPUID
+// ============================================
+
+static bool cpuHasSSE2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // faz parte do x86-64
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    // O sistema tem de guardar os registos YMM (XCR0 bits 1 e 2)
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // TEXT_X86
+
+// ============================================
+// DISPATCH
+// ============================================
+
+struct TextKernels
+{
+    const char *(*find)(const char *, size_t, const char *, size_t);
+    void (*upper)(char *, const char *, size_t);
+    void (*lower)(char *, const char *, size_t);
+    const char *name;
+};
+
+static TextKernels selectKernels()
+{
+#if TEXT_X86
+    if (cpuHasAVX2())
+        return {findAVX2, upperAVX2, lowerAVX2, "avx2"};
+    if (cpuHasSSE2())
+        return {findSSE2, upperSSE2, lowerSSE2, "sse2"};
+#endif
+    return {findScalar, upperScalar, lowerScalar, "scalar"};
+}
+
+static const TextKernels &kernels()
+{
+    static const TextKernels selected = selectKernels();
+    return selected;
+}
+
+const char *findText(const char *text, size_t length, const char *pattern, size_t patternLength)
+{
+    if (patternLength == 0)
+        return text;
+    if (patternLength > length)
+        return nullptr;
+    if (patternLength == 1)
+        return (const char *)std::memchr(text, pattern[0], length);
+    return kernels().find(text, length, pattern, patternLength);
+}
+
+void upperText(char *dest, const char *src, size_t length)
+{
+    kernels().upper(dest, src, length);
+}
+
+void lowerText(char *dest, const char *src, size_t length)
+{
+    kernels().lower(dest, src, length);
+}
+
+const char *textKernelName()
+{
+    return kernels().name;
+}
@@ -0,0 +1,192 @@
+#include "interpreter.hpp"
+#include "pool.hpp"
+#include <new>
+
+// ============================================
+// TYPES
+// ============================================
+
+StructDef *Interpreter::addStruct(const char *name)
+{
+    int existing;
+    if (structsMap.get(name, &existing) || structs.size() >= MAX_STRUCT_TYPES)
+        return nullptr;
+
+    StructDef *def = new StructDef();
+    def->name = createString(name);
+    def->index = (int)structs.size();
+    def->fieldCount = 0;
+
+    // A chave aponta para o nome do def (vive ate ao fim do Interpreter)
+    structsMap.set(def->name->chars(), def->index);
+    structs.push(def);
+    return def;
+}
+
+StructDef *Interpreter::findStruct(const char *name)
+{
+    int index;
+    if (!structsMap.get(name, &index))
+        return nullptr;
+    return structs[index];
+}
+
+int Interpreter::addStructField(StructDef *def, const char *name)
+{
+    int id;
+    if (!fieldsMap.get(name, &id))
+    {
+        if (fieldNames.size() >= MAX_FIELD_IDS)
+            return -1;
+
+        id = (int)fieldNames.size();
+        String *fieldName = createString(name);
+        fieldNames.push(fieldName);
+        fieldSlots.push(def->fieldCount);
+        fieldsMap.set(fieldName->chars(), id);
+    }
+
+    if (def->fieldCount >= MAX_STRUCT_FIELDS || def->slotOf(id) != -1)
+        return -1;
+
+    def->fieldIds[def->fieldCount] = (uint16)id;
+    return def->fieldCount++;
+}
+
+bool Interpreter::findField(const char *name, int *id, int *slot)
+{
+    if (!fieldsMap.get(name, id))
+        return false;
+    *slot = fieldSlots[*id];
+    return true;
+}
+
+Value Interpreter::newStruct(StructDef *def, const Value *args, int argCount)
+{
+    size_t size = sizeof(StructInstance) + def->fieldCount * sizeof(Value);
+    StructInstance *instance = (StructInstance *)arena.Allocate(size);
+    instance->def = def;
+
+    Value *fields = instance->fields();
+    for (int i = 0; i < def->fieldCount; i++)
+    {
+        new (&fields[i]) Value(i < argCount ? args[i] : Value::makeNil());
+    }
+    return Value::makeStruct(instance);
+}
+
+// ============================================
+// PROPRIEDADES
+// ============================================
+// Caminho generico de obj.nome: OP_GET_PROPERTY/OP_SET_PROPERTY, e
+// OP_GET_FIELD/OP_SET_FIELD quando o objecto nao e um type.
+
+bool Interpreter::getProperty(const Value &object, String *name, Value &out)
+{
+    const char *chars = name->chars();
+
+    if (object.isStruct())
+    {
+        StructInstance *instance = object.asStruct();
+        int id;
+        int slot = fieldsMap.get(chars, &id) ? instance->def->slotOf(id) : -1;
+        if (slot == -1)
+        {
+            runtimeError("Type '%s' has no field '%s'", instance->def->name->chars(), chars);
+            return false;
+        }
+        out = instance->fields()[slot];
+        return true;
+    }
+
+    // === STRING ===
+    if (object.isString())
+    {
+        if (strcmp(chars, "length") == 0)
+        {
+            out = Value::makeInt(object.asString()->length());
+            return true;
+        }
+        runtimeError("String has no property '%s'", chars);
+        return false;
+    }
+
+    // === PROCESS PRIVATES (external access) ===
+    if (object.isProcess())
+    {
+        int processId = object.asProcessId();
+        Process *proc = aliveProcesses[processId];
+        if (!proc)
+        {
+            runtimeError("Process '%i' is dead or invalid", processId);
+            return false;
+        }
+
+        int privateIdx = getProcessPrivateIndex(chars);
+        if (privateIdx == -1)
+        {
+            runtimeError("Process does not support '%s' property access", chars);
+            return false;
+        }
+        out = proc->privates[privateIdx];
+        return true;
+    }
+
+    runtimeError("Type does not support property access");
+    return false;
+}
+
+bool Interpreter::setProperty(const Value &object, String *name, const Value &value)
+{
+    const char *chars = name->chars();
+
+    if (object.isStruct())
+    {
+        StructInstance *instance = object.asStruct();
+        int id;
+        int slot = fieldsMap.get(chars, &id) ? instance->def->slotOf(id) : -1;
+        if (slot == -1)
+        {
+            runtimeError("Type '%s' has no field '%s'", instance->def->name->chars(), chars);
+            return false;
+        }
+        instance->fields()[slot] = value;
+        return true;
+    }
+
+    // === STRINGS (read-only) ===
+    if (object.isString())
+    {
+        runtimeError("Cannot set property on string (immutable)");
+        return false;
+    }
+
+    // === PROCESS PRIVATES (external write) ===
+    if (object.isProcess())
+    {
+        int processId = object.asProcessId();
+        Process *proc = aliveProcesses[processId];
+        if (!proc)
+        {
+            runtimeError("Process '%i' is dead or invalid", processId);
+            return false;
+        }
+
+        int privateIdx = getProcessPrivateIndex(chars);
+        if (privateIdx == -1)
+        {
+            runtimeError("Process has no property '%s'", chars);
+            return false;
+        }
+        if ((privateIdx == (int)PrivateIndex::ID) || (privateIdx == (int)PrivateIndex::FATHER))
+        {
+            runtimeError("Property '%s' is readonly", chars);
+            return false;
+        }
+        proc->privates[privateIdx] = value;
+        return true;
+    }
+
+    runtimeError("Cannot set property on this type");
+    return false;
+}
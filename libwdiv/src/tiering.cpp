@@ -0,0 +1,171 @@
+#include "tiering.hpp"
+#include "interpreter.hpp"
+#include "compiler.hpp"
+#include "optimizer.hpp"
+#include "code.hpp"
+
+// ============================================
+// TIERING
+// ============================================
+// Com tiering ligado os defs saem do compilador so com folding/inlining
+// (arranque rapido). run_fiber conta chamadas e saltos para tras; ao passar
+// TIER_HOT_THRESHOLD o chunk e copiado e optimizado em background. O chunk
+// novo entra na proxima chamada (ou no inicio do update); frames que ja
+// estavam a correr continuam no baseline, que fica vivo ate ao ~Function.
+// A pool de constantes e igual nos dois, por isso READ_CONSTANT via
+// func->chunk funciona para ambos.
+//
+// O background so corre optimize/specialize/verify: e exactamente o que o
+// compilador faria com o tiering desligado. Folding e inlining acontecem ao
+// emitir, e o baseline ja os tem.
+
+TierCompiler::TierCompiler() : stopping_(false), running_(false)
+{
+    worker_ = std::thread(&TierCompiler::run, this);
+}
+
+TierCompiler::~TierCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+
+    for (size_t i = 0; i < jobs_.size(); i++)
+    {
+        jobs_[i].code->clear();
+        delete jobs_[i].code;
+    }
+    jobs_.clear();
+}
+
+Code *TierCompiler::cloneChunk(const Code &chunk)
+{
+    Code *copy = new Code(chunk.count > 0 ? chunk.count : 1);
+    for (size_t run = 0; run < chunk.lineCount; run++)
+    {
+        size_t end = (run + 1 < chunk.lineCount) ? chunk.lineRuns[run + 1].start : chunk.count;
+        for (size_t i = chunk.lineRuns[run].start; i < end; i++)
+            copy->write(chunk.code[i], chunk.lineRuns[run].line);
+    }
+    for (size_t i = 0; i < chunk.constants.size(); i++)
+        copy->addConstant(chunk.constants[i]);
+    return copy;
+}
+
+void TierCompiler::submit(Function *func)
+{
+    Job job;
+    job.func = func;
+    job.code = cloneChunk(*func->chunk);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+    }
+    wake_.notify_one();
+}
+
+void TierCompiler::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!jobs_.empty() || running_)
+        idle_.wait(lock);
+}
+
+void TierCompiler::run()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (jobs_.empty() && !stopping_)
+                wake_.wait(lock);
+            if (stopping_)
+                return;
+            job = jobs_.front();
+            jobs_.pop_front();
+            running_ = true;
+        }
+
+        Optimizer::optimize(*job.code);
+        Optimizer::specialize(*job.code, job.func->arity);
+        job.func->optimizedMaxStack = Optimizer::verify(*job.code, job.func->arity);
+        job.func->optimized.store(job.code, std::memory_order_release);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        idle_.notify_all();
+    }
+}
+
+// ============================================
+// INTERPRETER
+// ============================================
+
+void Compiler::setTiering(bool enable)
+{
+    tiering_ = enable;
+}
+
+void Interpreter::setTiering(bool enable)
+{
+    compiler->setTiering(enable);
+
+    if (enable && !tierCompiler_)
+        tierCompiler_ = new TierCompiler();
+}
+
+void Interpreter::waitTiering()
+{
+    if (!tierCompiler_)
+        return;
+    tierCompiler_->wait();
+    promoteTiered();
+}
+
+int Interpreter::getFunctionTier(Value value) const
+{
+    if (!value.isFunction())
+        return -1;
+    int index = value.asFunctionId();
+    if (index < 0 || index >= (int)functions.size() || !functions[index])
+        return -1;
+    return functions[index]->tier;
+}
+
+void Interpreter::tierUp(Function *func)
+{
+    func->tier = TIER_QUEUED;
+    tierPending_.push(func);
+    tierCompiler_->submit(func);
+}
+
+bool Interpreter::promote(Function *func)
+{
+    Code *code = func->optimized.load(std::memory_order_acquire);
+    if (!code)
+        return false;
+
+    func->baseline = func->chunk;
+    func->chunk = code;
+    func->maxStack = func->optimizedMaxStack;
+    func->tier = TIER_OPTIMIZED;
+    return true;
+}
+
+void Interpreter::promoteTiered()
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < tierPending_.size(); i++)
+    {
+        Function *func = tierPending_[i];
+        if (func->tier == TIER_QUEUED && !promote(func))
+            tierPending_[kept++] = func;
+    }
+    tierPending_.resize(kept);
+}
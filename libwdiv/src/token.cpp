@@ -50,6 +50,10 @@ const char *tokenTypeToString(TokenType type)
         return "VAR";
     case TOKEN_DEF:
         return "DEF";
+    case TOKEN_CONST:
+        return "CONST";
+    case TOKEN_ENUM:
+        return "ENUM";
     case TOKEN_IF:
         return "IF";
     case TOKEN_ELIF:
@@ -0,0 +1,112 @@
+#include "tracer.hpp"
+
+// ============================================
+// TRACER (chrome://tracing)
+// ============================================
+
+Tracer::Tracer(size_t capacity)
+    : capacity_(capacity < 16 ? 16 : capacity), head_(0), count_(0), overwritten_(0),
+      nativeThresholdNs_(50000)
+{
+    events_ = (TraceEvent *)aAlloc(capacity_ * sizeof(TraceEvent));
+}
+
+Tracer::~Tracer()
+{
+    aFree(events_);
+}
+
+void Tracer::clear()
+{
+    head_ = 0;
+    count_ = 0;
+    overwritten_ = 0;
+}
+
+static const char *kindName(uint8 kind)
+{
+    switch (kind)
+    {
+    case TRACE_UPDATE:
+        return "update";
+    case TRACE_SCHEDULE:
+        return "schedule";
+    case TRACE_STEP:
+        return "process";
+    case TRACE_NATIVE:
+        return "native";
+    case TRACE_SPAWN:
+        return "spawn";
+    case TRACE_DESTROY:
+        return "destroy";
+    case TRACE_CLEANUP:
+        return "cleanup";
+    case TRACE_RENDER:
+        return "render";
+    default:
+        return "?";
+    }
+}
+
+// Nomes vem de identificadores do script, mas nao custa escapar
+static void writeJsonString(FILE *out, const char *text)
+{
+    fputc('"', out);
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', out);
+        if ((unsigned char)*c < 0x20)
+            continue;
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+bool Tracer::writeJson(const char *path) const
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return false;
+
+    size_t first = count_ < capacity_ ? 0 : head_;
+    uint64_t origin = 0;
+    if (count_)
+    {
+        // O mais antigo a sair pode ter comecado antes de um que ja saiu
+        origin = events_[first].start;
+        for (size_t i = 0; i < count_; i++)
+        {
+            const TraceEvent &event = events_[(first + i) % capacity_];
+            if (event.start < origin)
+                origin = event.start;
+        }
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"overwritten\":%llu},\"traceEvents\":[\n",
+            (unsigned long long)overwritten_);
+    for (size_t i = 0; i < count_; i++)
+    {
+        const TraceEvent &event = events_[(first + i) % capacity_];
+        const char *category = kindName(event.kind);
+
+        fputs(i ? ",{\"name\":" : "{\"name\":", out);
+        writeJsonString(out, event.name ? event.name : category);
+        fprintf(out, ",\"cat\":\"%s\",\"pid\":1,\"tid\":1,\"ts\":%.3f", category,
+                (double)(event.start - origin) / 1000.0);
+
+        if (event.kind == TRACE_SPAWN || event.kind == TRACE_DESTROY)
+            fputs(",\"ph\":\"i\",\"s\":\"t\"", out);
+        else
+            fprintf(out, ",\"ph\":\"X\",\"dur\":%.3f", (double)(event.end - event.start) / 1000.0);
+
+        if (event.kind == TRACE_STEP || event.kind == TRACE_SPAWN || event.kind == TRACE_DESTROY)
+            fprintf(out, ",\"args\":{\"id\":%u}", event.id);
+        fputs("}\n", out);
+    }
+    fputs("]}\n", out);
+
+    bool ok = !ferror(out);
+    fclose(out);
+    return ok;
+}
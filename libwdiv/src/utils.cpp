@@ -1,4 +1,5 @@
 #include "config.hpp"
+#include "numconv.hpp"
 #include <cstdio>
 #include <time.h>
 #include <stdarg.h>
@@ -18,19 +19,18 @@ void aFree(void *mem)
 	std::free(mem);
 }
 
-#define BUFFER_SIZE 64
-
+// Buffer por thread, valido ate a proxima chamada
 const char *doubleToString(double value)
 {
-	static char buffer[BUFFER_SIZE];
-	snprintf(buffer, BUFFER_SIZE, "%f", value);
+	static thread_local char buffer[NUMBER_BUFFER_SIZE];
+	buffer[formatDouble(buffer, value)] = '\0';
 	return buffer;
 }
 
 const char *longToString(long value)
 {
-	static char buffer[BUFFER_SIZE];
-	snprintf(buffer, BUFFER_SIZE, "%ld", value);
+	static thread_local char buffer[NUMBER_BUFFER_SIZE];
+	buffer[formatLong(buffer, value)] = '\0';
 	return buffer;
 }
 
@@ -1,5 +1,7 @@
 #include "value.hpp"
 #include "pool.hpp"
+#include "structs.hpp"
+#include "numconv.hpp"
 
 
 Value::Value() : type(ValueType::NIL)
@@ -95,6 +97,14 @@ Value Value::makeProcess(int idx)
     return v;
 }
 
+Value Value::makeStruct(StructInstance *instance)
+{
+    Value v;
+    v.type = ValueType::STRUCT;
+    v.as.instance = instance;
+    return v;
+}
+
 bool Value::isNumber() const 
 { 
     return  ((type == ValueType::INT) || (type==ValueType::DOUBLE));
@@ -139,6 +149,7 @@ String *Value::asString() const { return as.string; }
 int Value::asFunctionId() const { return as.functionId; }
 int Value::asNativeId() const { return as.nativeId; }
 int Value::asProcessId() const { return as.processId; }
+StructInstance *Value::asStruct() const { return as.instance; }
 
 long Value::asNumber() const 
 { 
@@ -164,13 +175,24 @@ void printValueNewLine(const Value &value)
         printf("%s\n", value.as.boolean ? "true" : "false");
         break;
     case ValueType::INT:
-        printf("%ld\n", value.as.integer);
+    {
+        char buffer[NUMBER_BUFFER_SIZE + 1];
+        int length = formatLong(buffer, value.as.integer);
+        buffer[length++] = '\n';
+        fwrite(buffer, 1, length, stdout);
         break;
+    }
     case ValueType::DOUBLE:
-        printf("%f\n", value.as.number);
+    {
+        char buffer[NUMBER_BUFFER_SIZE + 1];
+        int length = formatDouble(buffer, value.as.number);
+        buffer[length++] = '\n';
+        fwrite(buffer, 1, length, stdout);
         break;
+    }
     case ValueType::STRING:
-        printf("%s\n", value.as.string->chars());
+        fwrite(value.as.string->bytes(), 1, value.as.string->length(), stdout);
+        putchar('\n');
         break;
     case ValueType::FUNCTION:
         printf("<function>\n");
@@ -181,6 +203,9 @@ void printValueNewLine(const Value &value)
     case ValueType::PROCESS:
         printf("<process>\n");
         break;
+    case ValueType::STRUCT:
+        printf("<%s>\n", value.as.instance->def->name->chars());
+        break;
     default:
         printf("<?>\n)");
         break;
@@ -198,13 +223,21 @@ void printValue(const Value &value)
         printf("%s", value.as.boolean ? "true" : "false");
         break;
     case ValueType::INT:
-        printf("%ld", value.as.integer);
+    {
+        char buffer[NUMBER_BUFFER_SIZE + 1];
+        int length = formatLong(buffer, value.as.integer);
+        fwrite(buffer, 1, length, stdout);
         break;
+    }
     case ValueType::DOUBLE:
-        printf("%f", value.as.number);
+    {
+        char buffer[NUMBER_BUFFER_SIZE + 1];
+        int length = formatDouble(buffer, value.as.number);
+        fwrite(buffer, 1, length, stdout);
         break;
+    }
     case ValueType::STRING:
-        printf("%s", value.as.string->chars());
+        fwrite(value.as.string->bytes(), 1, value.as.string->length(), stdout);
         break;
     case ValueType::FUNCTION:
         printf("<function>");
@@ -215,6 +248,9 @@ void printValue(const Value &value)
     case ValueType::PROCESS:
         printf("<process>");
         break;
+    case ValueType::STRUCT:
+        printf("<%s>", value.as.instance->def->name->chars());
+        break;
     default:
         printf("<?>)");
         break;
@@ -230,8 +266,15 @@ bool valuesEqual(const Value& a, const Value& b)
     case ValueType::INT:    return a.asInt()    == b.asInt();
     case ValueType::BOOL:   return a.asBool()   == b.asBool();
     case ValueType::NIL:    return true;
-    case ValueType::STRING: return a.asString() == b.asString();
+    case ValueType::STRING:
+    {
+        // Pelo conteudo: concat/sub/format criam Strings novas
+        const String *x = a.asString();
+        const String *y = b.asString();
+        return x == y || (x->length() == y->length() && std::memcmp(x->bytes(), y->bytes(), x->length()) == 0);
+    }
     case ValueType::DOUBLE: return a.asDouble() == b.asDouble();
+    case ValueType::STRUCT: return a.asStruct() == b.asStruct();
     default:                return false;
     }
 }
@@ -0,0 +1,241 @@
+#include "optimizer.hpp"
+#include "interpreter.hpp"
+#include "code.hpp"
+#include "value.hpp"
+#include "opcode.hpp"
+#include <vector>
+
+// ============================================
+// VERIFICACAO
+// ============================================
+// Corre uma vez por chunk depois do optimize/specialize. Descodifica tudo,
+// segue todos os caminhos a partir da entrada com a profundidade da pilha
+// (relativa a frame->slots, parametros incluidos) e confirma:
+//   - opcodes conhecidos e instrucoes inteiras dentro do chunk
+//   - saltos (e entradas de OP_SWITCH_TABLE) aterram no inicio de instrucoes
+//   - indices de constantes, slots de locals e privates validos
+//   - a mesma profundidade em todos os caminhos que chegam a uma instrucao
+//   - nenhum caminho cai do fim do chunk
+// O maximo da profundidade e o que o frame precisa; o run_fiber so o compara
+// com o espaco livre na entrada do frame e corre o resto sem verificacoes.
+
+namespace
+{
+    class StackFlow
+    {
+    public:
+        StackFlow(const Code &chunk) : chunk_(chunk), depthAt_(chunk.count + 1, -1), isStart_(chunk.count + 1, false), maxDepth_(0) {}
+
+        int run(int arity)
+        {
+            int count = (int)chunk_.count;
+
+            for (int offset = 0; offset < count;)
+            {
+                uint8 op = chunk_.code[offset];
+                int length = Optimizer::instructionLength(op);
+                if (length == 0 || offset + length > count)
+                    return -1;
+
+                // O retorno de gosub nao se segue estaticamente
+                if (op == OP_GOSUB || op == OP_RETURN_SUB)
+                    return -1;
+
+                isStart_[offset] = true;
+                offset += length;
+            }
+
+            maxDepth_ = arity;
+            if (!reach(0, arity))
+                return -1;
+
+            while (!work_.empty())
+            {
+                int offset = work_.back();
+                work_.pop_back();
+
+                if (!step(offset, depthAt_[offset]))
+                    return -1;
+            }
+
+            return maxDepth_ <= STACK_MAX ? maxDepth_ : -1;
+        }
+
+    private:
+        const Code &chunk_;
+        std::vector<int> depthAt_;
+        std::vector<bool> isStart_;
+        std::vector<int> work_;
+        int maxDepth_;
+
+        bool reach(int target, int depth)
+        {
+            // Cair no fim (target == count) tambem falha: nao ha OP_RETURN
+            if (target < 0 || target >= (int)chunk_.count || !isStart_[target])
+                return false;
+
+            if (depthAt_[target] == -1)
+            {
+                depthAt_[target] = depth;
+                work_.push_back(target);
+                return true;
+            }
+            return depthAt_[target] == depth;
+        }
+
+        bool validConstant(int index) const
+        {
+            return index < (int)chunk_.constants.size();
+        }
+
+        bool validName(int index) const
+        {
+            return validConstant(index) && chunk_.constants[index].isString();
+        }
+
+        uint16 operandShort(int at) const
+        {
+            return (uint16)((chunk_.code[at] << 8) | chunk_.code[at + 1]);
+        }
+
+        int operandLong(int at) const
+        {
+            return (chunk_.code[at] << 16) | (chunk_.code[at + 1] << 8) | chunk_.code[at + 2];
+        }
+
+        bool validOperands(int offset, int depth) const
+        {
+            const uint8 *code = chunk_.code + offset;
+
+            switch (code[0])
+            {
+            case OP_CONSTANT:
+                return validConstant(code[1]);
+
+            case OP_GET_GLOBAL:
+            case OP_SET_GLOBAL:
+            case OP_DEFINE_GLOBAL:
+            case OP_GET_PROPERTY:
+            case OP_SET_PROPERTY:
+            case OP_INVOKE:
+                return validName(code[1]);
+
+            case OP_CONSTANT_LONG:
+                return validConstant(operandLong(offset + 1));
+
+            case OP_GET_GLOBAL_LONG:
+            case OP_SET_GLOBAL_LONG:
+            case OP_DEFINE_GLOBAL_LONG:
+            case OP_GET_PROPERTY_LONG:
+            case OP_SET_PROPERTY_LONG:
+            case OP_INVOKE_LONG:
+                return validName(operandLong(offset + 1));
+
+            case OP_GET_LOCAL:
+            case OP_SET_LOCAL:
+                return code[1] < depth;
+
+            case OP_GET_PRIVATE:
+            case OP_SET_PRIVATE:
+                return code[1] < MAX_PRIVATES;
+
+            case OP_FOR_PREP:
+            case OP_FOR_STEP:
+            {
+                if (code[1] >= depth)
+                    return false;
+                if (code[0] == OP_FOR_STEP && !validConstant(code[4]))
+                    return false;
+
+                uint8 limit = code[3];
+                switch (code[2] >> 2)
+                {
+                case FOR_LIMIT_CONSTANT:
+                    return validConstant(limit);
+                case FOR_LIMIT_LOCAL:
+                    return limit < depth;
+                case FOR_LIMIT_PRIVATE:
+                    return limit < MAX_PRIVATES;
+                default:
+                    return validName(limit);
+                }
+            }
+
+            case OP_SWITCH_TABLE:
+            {
+                int keys = (code[1] == SWITCH_DENSE) ? 1 : operandShort(offset + 3);
+                return code[1] <= SWITCH_STRING && code[2] + keys <= (int)chunk_.constants.size();
+            }
+
+            default:
+                return true;
+            }
+        }
+
+        bool step(int offset, int depth)
+        {
+            uint8 op = chunk_.code[offset];
+            int next = offset + Optimizer::instructionLength(op);
+
+            int pops, pushes;
+            if (!Optimizer::stackEffect(chunk_, offset, pops, pushes) || depth < pops)
+                return false;
+            if (!validOperands(offset, depth))
+                return false;
+
+            int after = depth - pops + pushes;
+            if (after > maxDepth_)
+                maxDepth_ = after;
+
+            switch (op)
+            {
+            case OP_JUMP:
+                return reach(next + operandShort(offset + 1), after);
+            case OP_LOOP:
+                return reach(next - operandShort(offset + 1), after);
+            case OP_JUMP_IF_FALSE:
+                return reach(next, after) && reach(next + operandShort(offset + 1), after);
+            case OP_JUMP_LONG:
+                return reach(next + operandLong(offset + 1), after);
+            case OP_LOOP_LONG:
+                return reach(next - operandLong(offset + 1), after);
+            case OP_JUMP_IF_FALSE_LONG:
+                return reach(next, after) && reach(next + operandLong(offset + 1), after);
+            case OP_FOR_PREP:
+                return reach(next, after) && reach(next + operandShort(next - 2), after);
+            case OP_FOR_STEP:
+                return reach(next, after) && reach(next - operandShort(next - 2), after);
+
+            case OP_SWITCH_TABLE:
+            {
+                int entries = operandShort(offset + 3) + 1;
+                for (int k = 0; k < entries; k++)
+                {
+                    int entry = next + k * 3;
+                    if (entry >= (int)chunk_.count || (chunk_.code[entry] != OP_JUMP && chunk_.code[entry] != OP_LOOP))
+                        return false;
+                    if (!reach(entry, after))
+                        return false;
+                }
+                return true;
+            }
+
+            case OP_RETURN:
+            case OP_EXIT:
+                return true;
+
+            default:
+                return reach(next, after);
+            }
+        }
+    };
+}
+
+int Optimizer::verify(const Code &chunk, int arity)
+{
+    if (chunk.count == 0 || arity < 0)
+        return -1;
+
+    StackFlow flow(chunk);
+    return flow.run(arity);
+}
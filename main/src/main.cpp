@@ -29,19 +29,25 @@ Value native_write(Interpreter *vm, int argCount, Value *args)
             if (argIndex < argCount)
             {
 
-                char buffer[64];
                 Value v = args[argIndex++];
 
-                if (v.isInt())
-                    snprintf(buffer, 64, "%ld", v.asInt());
-                else if (v.isDouble())
-                    snprintf(buffer, 64, "%.2f", v.asDouble());
-                else if (v.isString())
-                    snprintf(buffer, 64, "%s", v.asString()->chars());
+                if (v.isString())
+                {
+                    // Inteira (o buffer de 64 cortava strings longas)
+                    result.append(v.asString()->chars(), v.asString()->length());
+                }
                 else
-                    snprintf(buffer, 64, "<?>");
-
-                result += buffer;
+                {
+                    char buffer[64];
+                    if (v.isInt())
+                        snprintf(buffer, 64, "%ld", v.asInt());
+                    else if (v.isDouble())
+                        snprintf(buffer, 64, "%.2f", v.asDouble());
+                    else
+                        snprintf(buffer, 64, "<?>");
+
+                    result += buffer;
+                }
             }
             i++;
         }
@@ -75,19 +81,25 @@ Value native_format(Interpreter *vm, int argCount, Value *args)
             if (argIndex < argCount)
             {
                 // Converte Value para string
-                char buffer[64];
                 Value v = args[argIndex++];
 
-                if (v.isInt())
-                    snprintf(buffer, 64, "%ld", v.asInt());
-                else if (v.isDouble())
-                    snprintf(buffer, 64, "%.2f", v.asDouble());
-                else if (v.isString())
-                    snprintf(buffer, 64, "%s", v.asString()->chars());
+                if (v.isString())
+                {
+                    // Inteira (o buffer de 64 cortava strings longas)
+                    result.append(v.asString()->chars(), v.asString()->length());
+                }
                 else
-                    snprintf(buffer, 64, "<?>");
-
-                result += buffer;
+                {
+                    char buffer[64];
+                    if (v.isInt())
+                        snprintf(buffer, 64, "%ld", v.asInt());
+                    else if (v.isDouble())
+                        snprintf(buffer, 64, "%.2f", v.asDouble());
+                    else
+                        snprintf(buffer, 64, "<?>");
+
+                    result += buffer;
+                }
             }
             i++; // salta '}'
         }
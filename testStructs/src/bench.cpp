@@ -0,0 +1,118 @@
+#include "bench.hpp"
+#include "stringops.hpp"
+#include <algorithm>
+#include <cmath>
+
+// O cabecalho so sai com o primeiro caso do grupo (com --filter pode nao haver)
+void BenchSuite::section(const char *group)
+{
+    pendingSection_ = group;
+}
+
+void BenchSuite::printSection()
+{
+    if (pendingSection_.empty())
+        return;
+    std::printf("\n[%s]\n", pendingSection_.c_str());
+    std::printf("  %-40s %10s %10s %10s\n", "case", "median", "p99", "min");
+    pendingSection_.clear();
+}
+
+bool BenchSuite::enabled(const char *group, const std::string &name) const
+{
+    if (options_.filter.empty())
+        return true;
+    std::string full = std::string(group) + "/" + name;
+    return full.find(options_.filter) != std::string::npos;
+}
+
+void BenchSuite::record(const char *group, const std::string &name, size_t ops, std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    size_t n = samples.size();
+    BenchResult result;
+    result.group = group;
+    result.name = name;
+    result.ops = ops;
+    result.median = (n & 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+    // Nearest-rank: com poucas repeticoes e o pior caso
+    size_t rank = (size_t)std::ceil(0.99 * (double)n);
+    result.p99 = samples[rank > 0 ? rank - 1 : 0];
+    result.min = samples[0];
+    results_.push_back(result);
+
+    printSection();
+    std::printf("  %-40s %8.2fns %8.2fns %8.2fns\n", name.c_str(), result.median, result.p99, result.min);
+}
+
+void BenchSuite::check(const std::string &name, bool ok)
+{
+    checks_.push_back({name, ok});
+    printSection();
+    std::printf("  check %-34s %s\n", name.c_str(), ok ? "ok" : "FAILED");
+}
+
+bool BenchSuite::ok() const
+{
+    for (size_t i = 0; i < checks_.size(); i++)
+    {
+        if (!checks_[i].ok)
+            return false;
+    }
+    return true;
+}
+
+// Os nomes sao nossos (ASCII sem aspas), mas escapa na mesma
+static void writeJsonString(FILE *f, const std::string &text)
+{
+    std::fputc('"', f);
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c == '"' || c == '\\')
+            std::fputc('\\', f);
+        std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+bool BenchSuite::writeJson(const std::string &path) const
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+
+    std::fprintf(f, "{\n  \"suite\": \"testStructs\",\n");
+#if defined(NDEBUG)
+    std::fprintf(f, "  \"build\": \"release\",\n");
+#else
+    std::fprintf(f, "  \"build\": \"debug\",\n");
+#endif
+    std::fprintf(f, "  \"text_kernel\": \"%s\",\n", textKernelName());
+    std::fprintf(f, "  \"warmup\": %d,\n  \"repetitions\": %d,\n", options_.warmup, options_.repetitions);
+
+    std::fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results_.size(); i++)
+    {
+        const BenchResult &r = results_[i];
+        std::fprintf(f, "    {\"group\": ");
+        writeJsonString(f, r.group);
+        std::fprintf(f, ", \"name\": ");
+        writeJsonString(f, r.name);
+        std::fprintf(f, ", \"ops\": %zu, \"median_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f}%s\n",
+                     r.ops, r.median, r.p99, r.min, i + 1 < results_.size() ? "," : "");
+    }
+    std::fprintf(f, "  ],\n");
+
+    std::fprintf(f, "  \"checks\": [\n");
+    for (size_t i = 0; i < checks_.size(); i++)
+    {
+        std::fprintf(f, "    {\"name\": ");
+        writeJsonString(f, checks_[i].name);
+        std::fprintf(f, ", \"ok\": %s}%s\n", checks_[i].ok ? "true" : "false", i + 1 < checks_.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+
+    return std::fclose(f) == 0;
+}
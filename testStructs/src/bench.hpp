@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ============================================
+// MINI HARNESS DE BENCHMARK
+// ============================================
+// Cada caso corre `warmup` vezes sem medir e depois `repetitions` vezes; cada
+// repeticao da uma amostra em ns por operacao. Reporta mediana, p99 e minimo.
+// O corpo devolve um valor qualquer que vai para um sink volatile (o
+// optimizador nao pode apagar o ciclo).
+//
+// Saida: tabela no stdout e, com --json <ficheiro>, um JSON estavel (mesma
+// ordem e nomes entre commits) para comparar com diff ou scripts.
+
+struct BenchOptions
+{
+    int warmup = 3;
+    int repetitions = 15;
+    std::string filter;   // so corre casos cujo "grupo/nome" contem isto
+    std::string jsonPath; // vazio = sem JSON
+};
+
+struct BenchResult
+{
+    std::string group;
+    std::string name;
+    size_t ops;    // operacoes por amostra
+    double median; // ns/op
+    double p99;
+    double min;
+};
+
+struct BenchCheck
+{
+    std::string name;
+    bool ok;
+};
+
+class BenchSuite
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit BenchSuite(const BenchOptions &options) : options_(options) {}
+
+    const BenchOptions &options() const { return options_; }
+
+    // Comeca um grupo na tabela
+    void section(const char *group);
+
+    bool enabled(const char *group, const std::string &name) const;
+
+    template <typename Fn>
+    void run(const char *group, const std::string &name, size_t ops, Fn body)
+    {
+        if (!enabled(group, name))
+            return;
+
+        for (int i = 0; i < options_.warmup; i++)
+            sink_ += (uint64_t)body();
+
+        std::vector<double> samples;
+        samples.reserve((size_t)options_.repetitions);
+        for (int i = 0; i < options_.repetitions; i++)
+        {
+            Clock::time_point start = Clock::now();
+            sink_ += (uint64_t)body();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            samples.push_back(ns / (double)ops);
+        }
+        record(group, name, ops, samples);
+    }
+
+    // Validacao: conta para o exit code e vai para o JSON
+    void check(const std::string &name, bool ok);
+
+    bool ok() const;
+
+    bool writeJson(const std::string &path) const;
+
+    const std::vector<BenchResult> &results() const { return results_; }
+
+private:
+    void printSection();
+    void record(const char *group, const std::string &name, size_t ops, std::vector<double> &samples);
+
+    BenchOptions options_;
+    std::vector<BenchResult> results_;
+    std::vector<BenchCheck> checks_;
+    std::string pendingSection_;
+    volatile uint64_t sink_ = 0;
+};
+
+// Casos (um ficheiro por estrutura)
+void benchNumbers(BenchSuite &suite);
+void benchMaps(BenchSuite &suite);
+void benchContainers(BenchSuite &suite);
+void benchAllocator(BenchSuite &suite);
+void benchStrings(BenchSuite &suite);
+void benchProcesses(BenchSuite &suite);
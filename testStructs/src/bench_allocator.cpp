@@ -0,0 +1,110 @@
+#include "bench.hpp"
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// ============================================
+// HEAPALLOCATOR vs malloc/free
+// ============================================
+// Por classe de tamanho: BLOCKS blocos vivos, libertados por uma ordem
+// baralhada (as free lists ficam misturadas como num script real) e pedidos
+// outra vez. Cada amostra = ROUNDS voltas de alloc + free.
+
+static const size_t BLOCKS = 1024;
+static const size_t ROUNDS = 32;
+
+static bool validateAllocator()
+{
+    HeapAllocator heap;
+    std::vector<unsigned char *> blocks;
+    const size_t sizes[] = {1, 16, 17, 100, 640};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (size_t i = 0; i < 200; i++)
+        {
+            unsigned char *p = (unsigned char *)heap.Allocate(sizes[s]);
+            std::memset(p, (int)(i & 0xFF), sizes[s]);
+            blocks.push_back(p);
+        }
+    }
+
+    // Ninguem escreveu por cima de ninguem
+    bool ok = true;
+    size_t index = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (size_t i = 0; i < 200; i++, index++)
+        {
+            for (size_t b = 0; b < sizes[s]; b++)
+                ok = ok && blocks[index][b] == (unsigned char)(i & 0xFF);
+            heap.Free(blocks[index], sizes[s]);
+        }
+    }
+    return ok && heap.GetTotalAllocated() == 0;
+}
+
+void benchAllocator(BenchSuite &suite)
+{
+    suite.section("allocator");
+    suite.check("allocator/no-overlap", validateAllocator());
+
+    std::vector<size_t> order(BLOCKS);
+    for (size_t i = 0; i < BLOCKS; i++)
+        order[i] = i;
+    std::mt19937 rng(7);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    // Classes do HeapAllocator (arena.cpp) ate maxBlockSize
+    const size_t sizes[] = {16, 32, 64, 128, 256, 512, 640};
+    const size_t ops = BLOCKS * ROUNDS;
+    std::vector<void *> blocks(BLOCKS);
+
+    HeapAllocator heap;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        const size_t size = sizes[s];
+        char name[64];
+
+        std::snprintf(name, sizeof(name), "HeapAllocator/churn/%zu", size);
+        suite.run("allocator", name, ops, [&]()
+                  {
+                      size_t touched = 0;
+                      for (size_t r = 0; r < ROUNDS; r++)
+                      {
+                          for (size_t i = 0; i < BLOCKS; i++)
+                          {
+                              blocks[i] = heap.Allocate(size);
+                              *(char *)blocks[i] = (char)i;
+                          }
+                          for (size_t i = 0; i < BLOCKS; i++)
+                          {
+                              touched += (size_t)*(char *)blocks[order[i]];
+                              heap.Free(blocks[order[i]], size);
+                          }
+                      }
+                      return touched; });
+
+        std::snprintf(name, sizeof(name), "malloc/churn/%zu", size);
+        suite.run("allocator", name, ops, [&]()
+                  {
+                      size_t touched = 0;
+                      for (size_t r = 0; r < ROUNDS; r++)
+                      {
+                          for (size_t i = 0; i < BLOCKS; i++)
+                          {
+                              blocks[i] = std::malloc(size);
+                              *(char *)blocks[i] = (char)i;
+                          }
+                          for (size_t i = 0; i < BLOCKS; i++)
+                          {
+                              touched += (size_t)*(char *)blocks[order[i]];
+                              std::free(blocks[order[i]]);
+                          }
+                      }
+                      return touched; });
+    }
+}
@@ -0,0 +1,130 @@
+#include "bench.hpp"
+#include "array.hpp"
+#include "vector.hpp"
+#include <vector>
+
+// ============================================
+// VECTOR / ARRAY vs std::vector
+// ============================================
+// push sem reserve (inclui os crescimentos), push com reserve, e leitura
+// sequencial. Vector<int> como as listas do compilador; Array de Value como
+// os arrays dos scripts.
+
+static const size_t PUSH_COUNT = 100000;
+
+static bool validateContainers()
+{
+    Vector<int> vector;
+    Array array;
+    for (int i = 0; i < 10000; i++)
+    {
+        vector.push(i);
+        array.push(Value::makeInt(i));
+    }
+
+    bool ok = vector.size() == 10000 && array.size() == 10000;
+    for (int i = 0; ok && i < 10000; i++)
+        ok = vector[i] == i && array[i].asInt() == i;
+
+    for (int i = 9999; ok && i >= 5000; i--)
+    {
+        ok = array.pop().asInt() == i && vector.back() == i;
+        vector.pop();
+    }
+    return ok && vector.size() == 5000 && array.size() == 5000;
+}
+
+void benchContainers(BenchSuite &suite)
+{
+    suite.section("containers");
+    suite.check("containers/push-pop", validateContainers());
+
+    // ===== push com crescimento =====
+
+    suite.run("containers", "Vector<int>/push-grow", PUSH_COUNT, []()
+              {
+                  Vector<int> vector;
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      vector.push((int)i);
+                  return vector.size(); });
+    suite.run("containers", "std::vector<int>/push-grow", PUSH_COUNT, []()
+              {
+                  std::vector<int> vector;
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      vector.push_back((int)i);
+                  return vector.size(); });
+    suite.run("containers", "Array/push-grow", PUSH_COUNT, []()
+              {
+                  Array array;
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      array.push(Value::makeInt((long)i));
+                  return array.size(); });
+    suite.run("containers", "std::vector<Value>/push-grow", PUSH_COUNT, []()
+              {
+                  std::vector<Value> array;
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      array.push_back(Value::makeInt((long)i));
+                  return array.size(); });
+
+    // ===== push com reserve =====
+
+    suite.run("containers", "Vector<int>/push-reserved", PUSH_COUNT, []()
+              {
+                  Vector<int> vector(PUSH_COUNT);
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      vector.push((int)i);
+                  return vector.size(); });
+    suite.run("containers", "std::vector<int>/push-reserved", PUSH_COUNT, []()
+              {
+                  std::vector<int> vector;
+                  vector.reserve(PUSH_COUNT);
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      vector.push_back((int)i);
+                  return vector.size(); });
+    suite.run("containers", "Array/push-reserved", PUSH_COUNT, []()
+              {
+                  Array array;
+                  array.reserve(PUSH_COUNT);
+                  for (size_t i = 0; i < PUSH_COUNT; i++)
+                      array.push(Value::makeInt((long)i));
+                  return array.size(); });
+
+    // ===== leitura =====
+
+    Vector<int> vector;
+    std::vector<int> stdVector;
+    Array array;
+    std::vector<Value> stdArray;
+    for (size_t i = 0; i < PUSH_COUNT; i++)
+    {
+        vector.push((int)i);
+        stdVector.push_back((int)i);
+        array.push(Value::makeInt((long)i));
+        stdArray.push_back(Value::makeInt((long)i));
+    }
+
+    suite.run("containers", "Vector<int>/read", PUSH_COUNT, [&]()
+              {
+                  long sum = 0;
+                  for (size_t i = 0; i < vector.size(); i++)
+                      sum += vector[i];
+                  return sum; });
+    suite.run("containers", "std::vector<int>/read", PUSH_COUNT, [&]()
+              {
+                  long sum = 0;
+                  for (size_t i = 0; i < stdVector.size(); i++)
+                      sum += stdVector[i];
+                  return sum; });
+    suite.run("containers", "Array/read", PUSH_COUNT, [&]()
+              {
+                  long sum = 0;
+                  for (size_t i = 0; i < array.size(); i++)
+                      sum += array[i].asInt();
+                  return sum; });
+    suite.run("containers", "std::vector<Value>/read", PUSH_COUNT, [&]()
+              {
+                  long sum = 0;
+                  for (size_t i = 0; i < stdArray.size(); i++)
+                      sum += stdArray[i].asInt();
+                  return sum; });
+}
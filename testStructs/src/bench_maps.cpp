@@ -0,0 +1,219 @@
+#include "bench.hpp"
+#include "flatmap.hpp"
+#include "interpreter.hpp"
+#include "pool.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================
+// HASHMAP vs FLATMAP vs std::unordered_map
+// ============================================
+// Chaves String* com os StringHasher/StringEq do interpreter (globals,
+// functionsMap...). Hit: todas as chaves; miss: outras Strings com o mesmo
+// formato. Os tamanhos deixam o HashMap (cresce a 3/4) em cargas diferentes
+// com a mesma capacidade; o nome do caso leva n e a carga de cada mapa.
+
+typedef HashMap<String *, long, StringHasher, StringEq> OldMap;
+typedef FlatMap<String *, long, StringHasher, StringEq> NewMap;
+typedef std::unordered_map<String *, long, StringHasher, StringEq> StdMap;
+
+// Operacoes por amostra (mapas pequenos repetem o ciclo)
+static const size_t MAP_OPS = 100000;
+
+static void fill(OldMap &map, const std::vector<String *> &keys)
+{
+    for (size_t i = 0; i < keys.size(); i++)
+        map.set(keys[i], (long)i);
+}
+
+static void fill(NewMap &map, const std::vector<String *> &keys)
+{
+    for (size_t i = 0; i < keys.size(); i++)
+        map.set(keys[i], (long)i);
+}
+
+static void fill(StdMap &map, const std::vector<String *> &keys)
+{
+    for (size_t i = 0; i < keys.size(); i++)
+        map[keys[i]] = (long)i;
+}
+
+template <typename Map>
+static long lookupAll(const Map &map, const std::vector<String *> &keys)
+{
+    long found = 0;
+    long value;
+    for (size_t i = 0; i < keys.size(); i++)
+        found += map.get(keys[i], &value) ? value : 0;
+    return found;
+}
+
+static long lookupAll(const StdMap &map, const std::vector<String *> &keys)
+{
+    long found = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        StdMap::const_iterator it = map.find(keys[i]);
+        found += (it != map.end()) ? it->second : 0;
+    }
+    return found;
+}
+
+static size_t sizeOf(const OldMap &map) { return map.count; }
+static size_t sizeOf(const NewMap &map) { return map.count; }
+static size_t sizeOf(const StdMap &map) { return map.size(); }
+
+static double loadOf(const OldMap &map) { return (double)map.count / (double)map.capacity; }
+static double loadOf(const NewMap &map) { return (double)map.count / (double)map.capacity; }
+static double loadOf(const StdMap &map) { return map.load_factor(); }
+
+template <typename Map>
+static void benchMap(BenchSuite &suite, const char *label, const std::vector<String *> &keys,
+                     const std::vector<String *> &misses)
+{
+    const size_t rounds = MAP_OPS / keys.size() + 1;
+    const size_t ops = rounds * keys.size();
+
+    Map filled;
+    fill(filled, keys);
+
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), "/n=%zu@%.2f", keys.size(), loadOf(filled));
+
+    suite.run("maps", std::string(label) + "/insert" + suffix, ops, [&]()
+              {
+                  long total = 0;
+                  for (size_t r = 0; r < rounds; r++)
+                  {
+                      Map map;
+                      fill(map, keys);
+                      total += (long)sizeOf(map);
+                  }
+                  return total; });
+    suite.run("maps", std::string(label) + "/hit" + suffix, ops, [&]()
+              {
+                  long total = 0;
+                  for (size_t r = 0; r < rounds; r++)
+                      total += lookupAll(filled, keys);
+                  return total; });
+    suite.run("maps", std::string(label) + "/miss" + suffix, ops, [&]()
+              {
+                  long total = 0;
+                  for (size_t r = 0; r < rounds; r++)
+                      total += lookupAll(filled, misses);
+                  return total; });
+}
+
+static bool validateFlatMap(const std::vector<String *> &keys)
+{
+    NewMap map;
+    std::unordered_map<String *, long> reference;
+    std::mt19937 rng(99);
+    long failures = 0;
+
+    for (int op = 0; op < 200000; op++)
+    {
+        String *key = keys[rng() % 3000];
+        int kind = (int)(rng() % 10);
+        if (kind < 4)
+        {
+            bool isNew = map.set(key, op);
+            failures += isNew != (reference.find(key) == reference.end());
+            reference[key] = op;
+        }
+        else if (kind < 7)
+        {
+            failures += map.erase(key) != (reference.erase(key) > 0);
+        }
+        else
+        {
+            long value = -1;
+            bool found = map.get(key, &value);
+            std::unordered_map<String *, long>::iterator it = reference.find(key);
+            failures += found != (it != reference.end()) || (found && value != it->second);
+        }
+    }
+    failures += map.count != reference.size();
+    return failures == 0;
+}
+
+static bool validateHashMap(const std::vector<String *> &keys)
+{
+    OldMap map;
+    long failures = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+        failures += !map.set(keys[i], (long)i);
+    for (size_t i = 0; i < keys.size(); i++)
+        failures += map.set(keys[i], (long)i * 2); // ja existe
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        long value = -1;
+        failures += !map.get(keys[i], &value) || value != (long)i * 2;
+    }
+    failures += map.count != keys.size();
+    return failures == 0;
+}
+
+void benchMaps(BenchSuite &suite)
+{
+    // 12: globals de um script pequeno; 1600..3071: capacidade 4096 do HashMap
+    // a 39%, 56% e 75%; 49152: maior que a L2
+    const size_t sizes[] = {12, 1600, 2304, 3071, 49152};
+    const size_t MAX_KEYS = 49152;
+
+    std::vector<String *> all;
+    all.reserve(MAX_KEYS * 2);
+    char name[32];
+    for (size_t i = 0; i < MAX_KEYS * 2; i++)
+    {
+        int length = std::snprintf(name, sizeof(name), "global_%zu", i * 7919);
+        all.push_back(createString(name, (uint32)length));
+    }
+
+    suite.section("maps");
+    suite.check("maps/HashMap-set-get", validateHashMap(std::vector<String *>(all.begin(), all.begin() + 5000)));
+    suite.check("maps/FlatMap-vs-std", validateFlatMap(all));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        std::vector<String *> keys(all.begin(), all.begin() + sizes[s]);
+        std::vector<String *> misses(all.begin() + MAX_KEYS, all.begin() + MAX_KEYS + sizes[s]);
+
+        benchMap<OldMap>(suite, "HashMap", keys, misses);
+        benchMap<NewMap>(suite, "FlatMap", keys, misses);
+        benchMap<StdMap>(suite, "std", keys, misses);
+    }
+
+    // Fila com 1000 vivas: entra uma, sai a mais antiga (o HashMap nao tem erase)
+    const size_t WINDOW = 1000;
+    const size_t churnOps = all.size() - WINDOW;
+    suite.run("maps", "FlatMap/churn/live=1000", churnOps, [&]()
+              {
+                  NewMap map;
+                  for (size_t i = 0; i < WINDOW; i++)
+                      map.set(all[i], (long)i);
+                  long erased = 0;
+                  for (size_t i = WINDOW; i < all.size(); i++)
+                  {
+                      map.set(all[i], (long)i);
+                      erased += map.erase(all[i - WINDOW]);
+                  }
+                  return erased; });
+    suite.run("maps", "std/churn/live=1000", churnOps, [&]()
+              {
+                  StdMap map;
+                  for (size_t i = 0; i < WINDOW; i++)
+                      map[all[i]] = (long)i;
+                  long erased = 0;
+                  for (size_t i = WINDOW; i < all.size(); i++)
+                  {
+                      map[all[i]] = (long)i;
+                      erased += (long)map.erase(all[i - WINDOW]);
+                  }
+                  return erased; });
+
+    StringPool::instance().clear();
+}
@@ -0,0 +1,141 @@
+#include "bench.hpp"
+#include "numconv.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// ============================================
+// NUMCONV vs snprintf/strtod
+// ============================================
+// Primeiro valida (texto -> mesmo double, e strtod le o que escrevemos),
+// depois mede ns por numero contra o caminho antigo da libc.
+
+static bool validateNumbers(const std::vector<double> &doubles)
+{
+    char buffer[NUMBER_BUFFER_SIZE];
+    int failures = 0;
+
+    for (size_t i = 0; i < doubles.size(); i++)
+    {
+        int length = formatDouble(buffer, doubles[i]);
+        buffer[length] = '\0';
+
+        double parsed;
+        const char *end = parseDouble(buffer, buffer + length, parsed);
+        if (!end || end != buffer + length || parsed != doubles[i] || std::strtod(buffer, nullptr) != doubles[i])
+        {
+            if (failures++ < 5)
+                std::printf("  roundtrip failed: %.17g -> %s\n", doubles[i], buffer);
+        }
+    }
+
+    const long longs[] = {0, 7, -7, 42, 100, -100, 123456789, 2147483648L, -2147483647L - 1};
+    for (size_t i = 0; i < sizeof(longs) / sizeof(longs[0]); i++)
+    {
+        char expected[NUMBER_BUFFER_SIZE];
+        std::snprintf(expected, sizeof(expected), "%ld", longs[i]);
+        int length = formatLong(buffer, longs[i]);
+        buffer[length] = '\0';
+
+        long parsed;
+        if (std::strcmp(buffer, expected) != 0 || !parseLong(buffer, buffer + length, parsed) || parsed != longs[i])
+        {
+            if (failures++ < 10)
+                std::printf("  long failed: %s != %s\n", buffer, expected);
+        }
+    }
+
+    return failures == 0;
+}
+
+void benchNumbers(BenchSuite &suite)
+{
+    const size_t COUNT = 100000;
+
+    std::mt19937_64 rng(12345);
+    std::vector<double> doubles;
+    std::vector<long> longs;
+    doubles.reserve(COUNT);
+    longs.reserve(COUNT);
+
+    // Metade "de script" (x.yz), metade bits aleatorios
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        double value;
+        if (i & 1)
+        {
+            uint64_t bits = rng();
+            std::memcpy(&value, &bits, sizeof(value));
+            if (value != value || value - value != 0.0)
+                value = 1.0 / (double)(i + 1);
+        }
+        else
+        {
+            value = (double)((long)(rng() % 2000000) - 1000000) / 100.0;
+        }
+        doubles.push_back(value);
+        longs.push_back((long)(rng() % 2000000000) - 1000000000);
+    }
+
+    suite.section("numbers");
+    suite.check("numbers/roundtrip", validateNumbers(doubles));
+
+    suite.run("numbers", "format-double/snprintf", COUNT, [&]()
+              {
+                  char buffer[64];
+                  size_t sink = 0;
+                  for (size_t i = 0; i < COUNT; i++)
+                      sink += std::snprintf(buffer, sizeof(buffer), "%.17g", doubles[i]);
+                  return sink; });
+    suite.run("numbers", "format-double/grisu2", COUNT, [&]()
+              {
+                  char buffer[NUMBER_BUFFER_SIZE];
+                  size_t sink = 0;
+                  for (size_t i = 0; i < COUNT; i++)
+                      sink += formatDouble(buffer, doubles[i]);
+                  return sink; });
+    suite.run("numbers", "format-long/snprintf", COUNT, [&]()
+              {
+                  char buffer[64];
+                  size_t sink = 0;
+                  for (size_t i = 0; i < COUNT; i++)
+                      sink += std::snprintf(buffer, sizeof(buffer), "%ld", longs[i]);
+                  return sink; });
+    suite.run("numbers", "format-long/formatLong", COUNT, [&]()
+              {
+                  char buffer[NUMBER_BUFFER_SIZE];
+                  size_t sink = 0;
+                  for (size_t i = 0; i < COUNT; i++)
+                      sink += formatLong(buffer, longs[i]);
+                  return sink; });
+
+    // Parse: o texto que o formatDouble escreveu
+    std::vector<char> text(COUNT * NUMBER_BUFFER_SIZE);
+    std::vector<int> lengths(COUNT);
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        char *slot = &text[i * NUMBER_BUFFER_SIZE];
+        lengths[i] = formatDouble(slot, doubles[i]);
+        slot[lengths[i]] = '\0';
+    }
+
+    suite.run("numbers", "parse-double/strtod", COUNT, [&]()
+              {
+                  double total = 0.0;
+                  for (size_t i = 0; i < COUNT; i++)
+                      total += std::strtod(&text[i * NUMBER_BUFFER_SIZE], nullptr);
+                  return total != 0.0; });
+    suite.run("numbers", "parse-double/parseDouble", COUNT, [&]()
+              {
+                  double total = 0.0;
+                  for (size_t i = 0; i < COUNT; i++)
+                  {
+                      const char *slot = &text[i * NUMBER_BUFFER_SIZE];
+                      double value;
+                      parseDouble(slot, slot + lengths[i], value);
+                      total += value;
+                  }
+                  return total != 0.0; });
+}
@@ -0,0 +1,75 @@
+#include "bench.hpp"
+#include "interpreter.hpp"
+#include "pool.hpp"
+#include <cstdlib>
+#include <vector>
+
+// ============================================
+// PROCESSPOOL (reciclagem) vs malloc/free
+// ============================================
+// Um frame tipico: LIVE processos morrem e nascem outros tantos. O pool
+// devolve os Process mortos (LIFO) em vez de ir ao allocator.
+
+static const size_t LIVE = 512;
+static const size_t FRAMES = 16;
+
+static bool validateProcessPool()
+{
+    ProcessPool &pool = ProcessPool::instance();
+    Process *first = pool.create();
+    pool.destory(first);
+    Process *again = pool.create();
+    bool ok = again == first;
+    pool.destory(again);
+    pool.clear();
+    return ok;
+}
+
+void benchProcesses(BenchSuite &suite)
+{
+    suite.section("processes");
+    suite.check("processes/recycle-lifo", validateProcessPool());
+
+    const size_t ops = LIVE * FRAMES;
+    std::vector<Process *> live(LIVE);
+
+    // Pool ja aquecido: o primeiro frame da warmup enche-o
+    suite.run("processes", "ProcessPool/recycle", ops, [&]()
+              {
+                  ProcessPool &pool = ProcessPool::instance();
+                  size_t total = 0;
+                  for (size_t f = 0; f < FRAMES; f++)
+                  {
+                      for (size_t i = 0; i < LIVE; i++)
+                      {
+                          live[i] = pool.create();
+                          live[i]->id = (uint32)i;
+                      }
+                      for (size_t i = 0; i < LIVE; i++)
+                      {
+                          total += live[i]->id;
+                          pool.destory(live[i]);
+                      }
+                  }
+                  return total; });
+
+    suite.run("processes", "malloc/recycle", ops, [&]()
+              {
+                  size_t total = 0;
+                  for (size_t f = 0; f < FRAMES; f++)
+                  {
+                      for (size_t i = 0; i < LIVE; i++)
+                      {
+                          live[i] = (Process *)std::malloc(sizeof(Process));
+                          live[i]->id = (uint32)i;
+                      }
+                      for (size_t i = 0; i < LIVE; i++)
+                      {
+                          total += live[i]->id;
+                          std::free(live[i]);
+                      }
+                  }
+                  return total; });
+
+    ProcessPool::instance().clear();
+}
@@ -0,0 +1,149 @@
+#include "bench.hpp"
+#include "pool.hpp"
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================
+// STRINGPOOL vs std::string
+// ============================================
+// create + destroy (pequena inline e longa com buffer), concat e hash.
+// Cada amostra liberta o que criou: o pool nao cresce entre repeticoes.
+
+static const size_t STRING_COUNT = 20000;
+
+static bool validateStrings()
+{
+    StringPool &pool = StringPool::instance();
+    String *a = pool.create("hello ");
+    String *b = pool.create("world");
+    String *joined = pool.concat(a, b);
+    String *same = pool.create("hello world");
+
+    bool ok = joined->length() == 11 && std::memcmp(joined->chars(), "hello world", 11) == 0 &&
+              joined->hashCode() == same->hashCode();
+
+    pool.destroy(a);
+    pool.destroy(b);
+    pool.destroy(joined);
+    pool.destroy(same);
+    return ok;
+}
+
+static void benchCreate(BenchSuite &suite, const char *label, const std::string &text)
+{
+    std::string name = std::string("StringPool/create/") + label;
+    std::vector<String *> created(STRING_COUNT);
+    suite.run("strings", name, STRING_COUNT, [&]()
+              {
+                  StringPool &pool = StringPool::instance();
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                      created[i] = pool.create(text.data(), (uint32)text.size());
+                  size_t total = 0;
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                  {
+                      total += created[i]->length();
+                      pool.destroy(created[i]);
+                  }
+                  return total; });
+
+    name = std::string("std::string/create/") + label;
+    std::vector<std::string> stdCreated(STRING_COUNT);
+    suite.run("strings", name, STRING_COUNT, [&]()
+              {
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                      stdCreated[i] = std::string(text.data(), text.size());
+                  size_t total = 0;
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                  {
+                      total += stdCreated[i].size();
+                      std::string().swap(stdCreated[i]);
+                  }
+                  return total; });
+}
+
+static void benchConcat(BenchSuite &suite, const char *label, const std::string &left, const std::string &right)
+{
+    StringPool &pool = StringPool::instance();
+    String *a = pool.create(left.data(), (uint32)left.size());
+    String *b = pool.create(right.data(), (uint32)right.size());
+
+    std::vector<String *> created(STRING_COUNT);
+    suite.run("strings", std::string("StringPool/concat/") + label, STRING_COUNT, [&]()
+              {
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                      created[i] = pool.concat(a, b);
+                  size_t total = 0;
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                  {
+                      total += created[i]->length();
+                      pool.destroy(created[i]);
+                  }
+                  return total; });
+
+    std::vector<std::string> stdCreated(STRING_COUNT);
+    suite.run("strings", std::string("std::string/concat/") + label, STRING_COUNT, [&]()
+              {
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                      stdCreated[i] = left + right;
+                  size_t total = 0;
+                  for (size_t i = 0; i < STRING_COUNT; i++)
+                  {
+                      total += stdCreated[i].size();
+                      std::string().swap(stdCreated[i]);
+                  }
+                  return total; });
+
+    pool.destroy(a);
+    pool.destroy(b);
+}
+
+static void benchHash(BenchSuite &suite, const char *label, size_t length)
+{
+    // Textos diferentes (o hash nao fica em cache no CPU)
+    std::vector<std::string> texts(256);
+    for (size_t i = 0; i < texts.size(); i++)
+    {
+        texts[i].assign(length, 'a');
+        for (size_t c = 0; c < length; c++)
+            texts[i][c] = (char)('a' + (i * 31 + c * 7) % 26);
+    }
+
+    const size_t rounds = STRING_COUNT / texts.size();
+    const size_t ops = rounds * texts.size();
+
+    suite.run("strings", std::string("hashString/") + label, ops, [&]()
+              {
+                  size_t total = 0;
+                  for (size_t r = 0; r < rounds; r++)
+                      for (size_t i = 0; i < texts.size(); i++)
+                          total += hashString(texts[i].data(), (uint32)texts[i].size());
+                  return total; });
+    suite.run("strings", std::string("std::hash/") + label, ops, [&]()
+              {
+                  std::hash<std::string> hasher;
+                  size_t total = 0;
+                  for (size_t r = 0; r < rounds; r++)
+                      for (size_t i = 0; i < texts.size(); i++)
+                          total += hasher(texts[i]);
+                  return total; });
+}
+
+void benchStrings(BenchSuite &suite)
+{
+    suite.section("strings");
+    suite.check("strings/concat-hash", validateStrings());
+
+    benchCreate(suite, "small", "player_x");
+    benchCreate(suite, "long", std::string(100, 'x'));
+
+    benchConcat(suite, "small", "score: ", "1234");
+    benchConcat(suite, "long", std::string(60, 'a'), std::string(60, 'b'));
+
+    benchHash(suite, "8", 8);
+    benchHash(suite, "32", 32);
+    benchHash(suite, "256", 256);
+
+    StringPool::instance().clear();
+}
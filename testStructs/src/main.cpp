@@ -1,27 +1,63 @@
- 
-#include "arena.hpp"
-#include "array.hpp"
-#include "value.hpp"
-#include "code.hpp"
-#include "string.hpp"
-#include "pool.hpp"
-#include "map.hpp"
-#include "vector.hpp"
-#include <iostream>
-#include <algorithm>  
-#include <cassert>
+#include "bench.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <random>
-#include <vector>
-#include <unordered_map>
-#include <limits>
 
- 
-int main()
+// testStructs [--json ficheiro] [--filter texto] [--reps N] [--warmup N]
+//   --json    escreve os resultados (mediana/p99/min por caso) para comparar
+//             entre commits
+//   --filter  so casos cujo "grupo/nome" contem o texto (ex: maps/FlatMap)
+//   exit code != 0 se alguma validacao falhar
+
+static void usage()
+{
+    std::cout << "usage: testStructs [--json file] [--filter text] [--reps N] [--warmup N]\n";
+}
+
+int main(int argc, char **argv)
 {
-    std::cout << "Running structure validation tests...\n\n";
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--json") == 0 && hasValue)
+            options.jsonPath = argv[++i];
+        else if (std::strcmp(arg, "--filter") == 0 && hasValue)
+            options.filter = argv[++i];
+        else if (std::strcmp(arg, "--reps") == 0 && hasValue)
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--warmup") == 0 && hasValue)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    std::cout << "Running structure validation and benchmarks (warmup " << options.warmup
+              << ", " << options.repetitions << " repetitions, ns/op)\n";
+
+    BenchSuite suite(options);
+    benchNumbers(suite);
+    benchMaps(suite);
+    benchContainers(suite);
+    benchAllocator(suite);
+    benchStrings(suite);
+    benchProcesses(suite);
+
+    if (!options.jsonPath.empty())
+    {
+        if (!suite.writeJson(options.jsonPath))
+        {
+            std::cerr << "cannot write " << options.jsonPath << "\n";
+            return 2;
+        }
+        std::cout << "\nresults written to " << options.jsonPath << "\n";
+    }
 
-   
-    return 0;
+    std::cout << (suite.ok() ? "\nall checks passed\n" : "\nSOME CHECKS FAILED\n");
+    return suite.ok() ? 0 : 1;
 }
@@ -83,8 +83,14 @@ std::string valueToString(const Value &value)
         return "<native>";
     case ValueType::PROCESS:
         return "<process>";
+    case ValueType::STRUCT:
+        return value.asStruct()->def->name->chars();
+    case ValueType::ARRAY:
+        return "<array>";
+    case ValueType::MAP:
+        return "<map>";
     }
-    return "<?>)";
+    return "<?>";
 }
 
 static Value native_pass(Interpreter *vm, int argc, Value *args)
@@ -178,6 +184,27 @@ static Value native_assert(Interpreter *vm, int argc, Value *args)
     return Value::makeNil();
 }
 
+// tier_of(f): 0 baseline, 1 na fila, 2 optimizado (-1 se nao e um def)
+static Value native_tier_of(Interpreter *vm, int argc, Value *args)
+{
+    return Value::makeInt(argc < 1 ? -1 : vm->getFunctionTier(args[0]));
+}
+
+// tier_wait(): espera pela thread de tiering e troca os chunks prontos
+static Value native_tier_wait(Interpreter *vm, int argc, Value *args)
+{
+    vm->waitTiering();
+    return Value::makeNil();
+}
+
+// Directiva numa linha propria do ficheiro, p.ex. "// @tiering"
+static bool hasDirective(const std::string &code, const char *name)
+{
+    std::string line = std::string("// @") + name + "\n";
+    size_t at = code.find(line);
+    return at != std::string::npos && (at == 0 || code[at - 1] == '\n');
+}
+
 int main(int argc, char **argv)
 {
     Interpreter vm;
@@ -187,6 +214,8 @@ int main(int argc, char **argv)
     vm.registerNative("fail", native_fail, 1);
     vm.registerNative("assert", native_assert, 2);
     vm.registerNative("assert_eq", native_assert_eq, 3);
+    vm.registerNative("tier_of", native_tier_of, 1);
+    vm.registerNative("tier_wait", native_tier_wait, 0);
 
     int totalPassed = 0;
     int totalFailed = 0;
@@ -231,6 +260,11 @@ int main(int argc, char **argv)
         beginTestFile(filename.c_str());
         filesRun++;
 
+        // "// @tiering": defs deste ficheiro comecam no baseline;
+        // "// @no-inlining": nenhum call site e inlined
+        vm.setTiering(hasDirective(code, "tiering"));
+        vm.setInlining(!hasDirective(code, "no-inlining"));
+
         // Compila
         if (!vm.run(code.c_str(), false))
         {